@@ -21,7 +21,8 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include <array>
 #include <cstdio>
 #include <filesystem>
-
+#include <fstream>
+#include <thread>
 
 #include "src/external/argparse/argparse.h"
 #include "src/external/ipasir.h"
@@ -29,39 +30,126 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "src/identify/GBDHash.h"
 #include "src/identify/ISOHash.h"
 #include "src/identify/ISOHash2.h"
+#include "src/identify/Analyze.h"
+#include "src/identify/Incremental.h"
 
 #include "src/util/SolverTypes.h"
+#include "src/util/StreamBuffer.h"
 
 #include "src/transform/IndependentSet.h"
 #include "src/transform/Normalize.h"
 #include "src/util/ResourceLimits.h"
 #include "src/transform/cnf2bip.h"
+#include "src/transform/Pack.h"
 
 #include "src/extract/CNFGateFeatures.h"
 #include "src/extract/CNFBaseFeatures.h"
+#include "src/extract/CNFApproxFeatures.h"
 #include "src/extract/WCNFBaseFeatures.h"
 #include "src/extract/OPBBaseFeatures.h"
 
 #include "src/util/StreamCompressor.h"
+#include "src/util/Batch.h"
+#include "src/util/Server.h"
+#include "src/util/ResultCache.h"
+#include "src/util/Profile.h"
+
+#ifndef GBDC_VERSION
+#define GBDC_VERSION "unknown"
+#endif
+
+// file extension of instance, ignoring compression and packing
+static std::string instance_type(const std::string& filename) {
+    std::string ext = std::filesystem::path(filename).extension();
+    if (ext == ".xz" || ext == ".lzma" || ext == ".bz2" || ext == ".gz" || ext == ".zst" || ext == ".pack") {
+        ext = std::filesystem::path(filename).stem().extension();
+    }
+    return ext;
+}
+
+template <typename Extractor>
+static void batch_features(const std::string& filename, BatchRecord& record) {
+    Extractor stats(filename.c_str());
+    stats.extract();
+    std::vector<double> features = stats.getFeatures();
+    std::vector<std::string> names = stats.getNames();
+    for (unsigned i = 0; i < features.size(); i++) {
+        record.emplace_back(names[i], features[i]);
+    }
+}
+
+static const std::vector<std::string> batch_tasks = { "extract", "gates", "id", "isohash", "wlhash", "analyze" };
+
+// tools which print the same record as the batch task of the same name
+static const std::vector<std::string> cached_tools = { "extract", "gates", "id", "identify", "isohash", "analyze" };
+
+static BatchRecord batch_task(const std::string& task, const std::string& filename) {
+    const std::string ext = instance_type(filename);
+    BatchRecord record;
+    if (task == "extract") {
+        if (ext == ".cnf") batch_features<CNF::BaseFeatures>(filename, record);
+        else if (ext == ".wcnf") batch_features<WCNF::BaseFeatures>(filename, record);
+        else if (ext == ".opb") batch_features<OPB::BaseFeatures>(filename, record);
+        else throw std::runtime_error("unsupported instance type");
+    } else if (task == "gates") {
+        batch_features<CNF::GateFeatures>(filename, record);
+    } else if (task == "id") {
+        if (ext == ".cnf" || ext == ".wecnf") record.emplace_back("hash", CNF::gbdhash(filename.c_str()));
+        else if (ext == ".opb") record.emplace_back("hash", OPB::gbdhash(filename.c_str()));
+        else if (ext == ".qcnf" || ext == ".qdimacs") record.emplace_back("hash", PQBF::gbdhash(filename.c_str()));
+        else if (ext == ".wcnf") record.emplace_back("hash", WCNF::gbdhash(filename.c_str()));
+        else throw std::runtime_error("unsupported instance type");
+    } else if (task == "isohash") {
+        if (ext == ".cnf") record.emplace_back("isohash", CNF::isohash(filename.c_str()));
+        else if (ext == ".wcnf") record.emplace_back("isohash", WCNF::isohash(filename.c_str()));
+        else throw std::runtime_error("unsupported instance type");
+    } else if (task == "wlhash") {
+        record.emplace_back("wlhash", CNF::weisfeiler_leman_hash(filename.c_str(), 1, true, true, false, 13, true, true, true, 6, false, false, false));
+    } else if (task == "analyze") {
+        CNF::Analysis analysis = CNF::analyze(filename.c_str());
+        record.emplace_back("gbdhash", analysis.gbdhash);
+        record.emplace_back("isohash", analysis.isohash);
+        record.emplace_back("wlhash", analysis.wlhash);
+        for (unsigned i = 0; i < analysis.features.size(); i++) {
+            record.emplace_back(analysis.names[i], analysis.features[i]);
+        }
+    }
+    return record;
+}
 
 int main(int argc, char** argv) {
     argparse::ArgumentParser argparse("CNF Tools");
 
-    argparse.add_argument("tool").help("Select Tool: solve, id|identify (gbdhash, opbhash, pqbfhash), isohash, wlhash, normalize, sanitize, checksani, cnf2kis, cnf2bip, extract, gates")
+    argparse.add_argument("tool").help("Select Tool: solve, id|identify (gbdhash, opbhash, pqbfhash), gbdhash2, isohash, wlhash, analyze, incremental, batch, serve, normalize, sanitize, checksani, cnf2kis, cnf2bip, pack, unpack, extract, gates")
         .default_value("identify")
         .action([](const std::string& value) {
-            static const std::vector<std::string> choices = { "solve", "id", "identify", "gbdhash", "opbhash", "pqbfhash", "isohash", "wlhash", "normalize", "sanitize", "checksani", "cnf2kis", "cnf2bip", "extract", "gates", "test" };
+            static const std::vector<std::string> choices = { "solve", "id", "identify", "gbdhash", "gbdhash2", "opbhash", "pqbfhash", "isohash", "wlhash", "analyze", "incremental", "batch", "serve", "normalize", "sanitize", "checksani", "cnf2kis", "cnf2bip", "pack", "unpack", "extract", "gates", "test" };
             if (std::find(choices.begin(), choices.end(), value) != choices.end()) {
                 return value;
             }
             return std::string{ "identify" };
         });
 
-    argparse.add_argument("file").help("Path to Input File");
-    argparse.add_argument("-o", "--output").default_value(std::string("-")).help("Path to Output File (used by cnf2* transformers, default is stdout)");
+    argparse.add_argument("file").help("Path to Input File (batch: directory or file list, serve: unix socket or - for stdin)");
+    argparse.add_argument("-o", "--output").default_value(std::string("-")).help("Path to Output File (used by cnf2* transformers, normalize, sanitize, pack and unpack, default is stdout)");
+    argparse.add_argument("--csr").default_value(false).implicit_value(true).help("Write graph of cnf2kis and cnf2bip in binary CSR format");
+    argparse.add_argument("--index").default_value(false).implicit_value(true).help("Append clause offset index to packed file");
     argparse.add_argument("-t", "--timeout").default_value(0).scan<'i', int>().help("Time limit in seconds");
     argparse.add_argument("-m", "--memout").default_value(0).scan<'i', int>().help("Memory limit in MB");
     argparse.add_argument("-f", "--fileout").default_value(0).scan<'i', int>().help("File size limit in MB");
+    argparse.add_argument("-b", "--buffer").default_value(1024).scan<'i', int>().help("Read buffer size in KB");
+    argparse.add_argument("--decode-thread").default_value(false).implicit_value(true).help("Decompress input files on a separate thread");
+    argparse.add_argument("--compress-threads").default_value(1).scan<'i', int>().help("Compression threads for .xz and .zst output files, 0 for number of cores");
+    argparse.add_argument("--compress-level").default_value(-1).scan<'i', int>().help("Compression level for .xz and .zst output files, -1 for the default");
+    argparse.add_argument("--fixed-buffer").default_value(false).implicit_value(true).help("Fail on tokens longer than read buffer instead of growing it");
+    argparse.add_argument("-j", "--jobs").default_value(0).scan<'i', int>().help("Number of worker threads (batch and serve: default is number of cores, wlhash, gates, gbdhash2, cnf2kis, sanitize and checksani: default is 1)");
+    argparse.add_argument("--task").default_value(std::string("extract")).help("Tool run by batch on every file: extract, gates, id, isohash, wlhash, analyze");
+    argparse.add_argument("--format").default_value(std::string("jsonl")).help("Output format of batch: jsonl or csv");
+    argparse.add_argument("--cache").default_value(std::string("")).help("Directory of persistent result cache (extract, gates, id, isohash, analyze, batch)");
+    argparse.add_argument("--external").default_value(false).implicit_value(true).help("Keep the clauses of wlhash and cnf2kis in a temporary file instead of memory (see $TMPDIR)");
+    argparse.add_argument("--state").default_value(std::string("")).help("State file of incremental, which only parses what was appended since its last run (default is <file>.gbdstate)");
+    argparse.add_argument("--sample").default_value(0.0).scan<'g', double>().help("Approximate CNF base features of extract from the given fraction of the input, estimates are followed by their standard error (0 for exact features)");
+    argparse.add_argument("--profile").default_value(false).implicit_value(true).help("Print wall time, cpu time and peak memory of tool phases and processed bytes and clauses to stderr");
     argparse.add_argument("-v", "--verbose").default_value(0).scan<'i', int>().help("Verbosity");
 
     try {
@@ -78,16 +166,44 @@ int main(int argc, char** argv) {
     std::string output = argparse.get("output");
     int verbose = argparse.get<int>("verbose");
 
-    ResourceLimits limits(argparse.get<int>("timeout"), argparse.get<int>("memout"), argparse.get<int>("fileout"));
+    StreamBuffer::default_buffer_size = static_cast<size_t>(std::max(argparse.get<int>("buffer"), 1)) * 1024;
+    StreamBuffer::default_adaptive = !argparse.get<bool>("fixed-buffer");
+    StreamBuffer::default_threaded = argparse.get<bool>("decode-thread");
+    StreamCompressor::default_threads = std::max(argparse.get<int>("compress-threads"), 0);
+    StreamCompressor::default_level = argparse.get<int>("compress-level");
+
+    // batch and serve enforce time and memory limits per instance with cooperative budgets
+    const bool batch = toolname == "batch" || toolname == "serve";
+    ResourceLimits limits(batch ? 0 : argparse.get<int>("timeout"), batch ? 0 : argparse.get<int>("memout"), argparse.get<int>("fileout"));
     limits.set_rlimits();
     std::cerr << "c Running: " << toolname << " " << filename << std::endl;
 
+    // the report is printed on every exit path, after the total phase has been recorded
+    struct ProfileReport {
+        ~ProfileReport() { if (Profile::enabled()) Profile::print(std::cerr); }
+    } report;
+    Profile::enable(argparse.get<bool>("profile"));
+    Profile::Scope total("total");
+
+    std::unique_ptr<ResultCache> cache;
+    if (!argparse.get("cache").empty()) cache = std::make_unique<ResultCache>(argparse.get("cache"));
+    auto cached_task = [&cache] (const std::string& task, const std::string& instance) {
+        if (!cache) return batch_task(task, instance);
+        return cache->get_or_compute(instance, task, [&] () { return batch_task(task, instance); });
+    };
+
     try {
-        if (toolname == "id" || toolname == "identify") {
-            std::string ext = std::filesystem::path(filename).extension();
-            if (ext == ".xz" || ext == ".lzma" || ext == ".bz2" || ext == ".gz") {
-                ext = std::filesystem::path(filename).stem().extension();
+        // approximate features are not cached
+        const double sample = argparse.get<double>("sample");
+        if (cache && sample == 0 && std::find(cached_tools.begin(), cached_tools.end(), toolname) != cached_tools.end()) {
+            const BatchRecord record = cached_task(toolname == "identify" ? "id" : toolname, filename);
+            for (const auto& [name, value] : record) {
+                if (record.size() > 1) std::cout << name << "=";
+                std::visit([] (const auto& v) { std::cout << v; }, value);
+                std::cout << std::endl;
             }
+        } else if (toolname == "id" || toolname == "identify") {
+            const std::string ext = instance_type(filename);
             if (ext == ".cnf" || ext == ".wecnf") {
                 std::cerr << "Detected CNF, using CNF hash" << std::endl;
                 std::cout << CNF::gbdhash(filename.c_str()) << std::endl;
@@ -106,11 +222,11 @@ int main(int argc, char** argv) {
             }
         } else if (toolname == "gbdhash") {
             std::cout << CNF::gbdhash(filename.c_str()) << std::endl;
+        } else if (toolname == "gbdhash2") {
+            const unsigned threads = std::max(argparse.get<int>("jobs"), 1);
+            std::cout << CNF::gbdhash2(filename.c_str(), threads) << std::endl;
         } else if (toolname == "isohash") {
-            std::string ext = std::filesystem::path(filename).extension();
-            if (ext == ".xz" || ext == ".lzma" || ext == ".bz2" || ext == ".gz") {
-                ext = std::filesystem::path(filename).stem().extension();
-            }
+            const std::string ext = instance_type(filename);
             if (ext == ".cnf") {
                 std::cerr << "Detected CNF, using CNF isohash" << std::endl;
                 std::cout << CNF::isohash(filename.c_str()) << std::endl;
@@ -119,34 +235,97 @@ int main(int argc, char** argv) {
                 std::cout << WCNF::isohash(filename.c_str()) << std::endl;
             }
         } else if (toolname == "wlhash") {
-            std::cout << CNF::weisfeiler_leman_hash(filename.c_str()) << std::endl;
+            const unsigned threads = std::max(argparse.get<int>("jobs"), 1);
+            const unsigned level = argparse.get<bool>("external") ? 4 : 1;
+            std::cout << CNF::weisfeiler_leman_hash(filename.c_str(), level, true, true, false, 13, true, true, true, 6, false, true, false, threads) << std::endl;
+        } else if (toolname == "analyze") {
+            CNF::Analysis analysis = CNF::analyze(filename.c_str());
+            std::cout << "gbdhash=" << analysis.gbdhash << std::endl;
+            std::cout << "isohash=" << analysis.isohash << std::endl;
+            std::cout << "wlhash=" << analysis.wlhash << std::endl;
+            for (unsigned i = 0; i < analysis.features.size(); i++) {
+                std::cout << analysis.names[i] << "=" << analysis.features[i] << std::endl;
+            }
+        } else if (toolname == "incremental") {
+            const std::string state = argparse.get("state");
+            CNF::IncrementalResult result = CNF::incremental(filename.c_str(), state.empty() ? filename + ".gbdstate" : state);
+            std::cerr << "c parsed " << result.bytes_parsed << " bytes" << (result.resumed ? " after stored state" : "") << std::endl;
+            std::cout << "gbdhash=" << result.gbdhash << std::endl;
+            for (unsigned i = 0; i < result.features.size(); i++) {
+                std::cout << result.names[i] << "=" << result.features[i] << std::endl;
+            }
+        } else if (toolname == "batch") {
+            std::string task = argparse.get("task");
+            if (std::find(batch_tasks.begin(), batch_tasks.end(), task) == batch_tasks.end()) {
+                std::cerr << "Unknown batch task: " << task << std::endl;
+                return 1;
+            }
+            std::ofstream file;
+            if (output != "-") file.open(output);
+            BatchWriter writer(output == "-" ? std::cout : file, argparse.get("format") != "csv");
+            int jobs = argparse.get<int>("jobs");
+            run_batch(batch_inputs(filename), [&task, &cached_task] (const std::string& instance) { return cached_task(task, instance); },
+                writer, jobs > 0 ? jobs : std::thread::hardware_concurrency(), argparse.get<int>("timeout"), argparse.get<int>("memout"));
+        } else if (toolname == "serve") {
+            // timeout and memout are defaults of requests without limits
+            const Server::Handler handler = [&cached_task] (const std::string& task, const std::string& instance) {
+                if (task == "version") return BatchRecord { { "version", std::string(GBDC_VERSION) } };
+                if (std::find(batch_tasks.begin(), batch_tasks.end(), task) == batch_tasks.end()) {
+                    throw std::runtime_error("Unknown task: " + task);
+                }
+                return cached_task(task, instance);
+            };
+            int jobs = argparse.get<int>("jobs");
+            const unsigned threads = jobs > 0 ? jobs : std::thread::hardware_concurrency();
+            if (filename == "-") {
+                std::ios::sync_with_stdio(false);
+                Server::serve_stream(std::cin, std::cout, threads, handler, argparse.get<int>("timeout"), argparse.get<int>("memout"));
+            } else {
+                std::cerr << "c Listening on " << filename << std::endl;
+                Server::serve_socket(filename, threads, handler, argparse.get<int>("timeout"), argparse.get<int>("memout"));
+            }
         } else if (toolname == "opbhash") {
             std::cout << OPB::gbdhash(filename.c_str()) << std::endl;
         } else if (toolname == "pqbfhash") {
             std::cout << PQBF::gbdhash(filename.c_str()) << std::endl;
         } else if (toolname == "normalize") {
             std::cerr << "Normalizing " << filename << std::endl;
-            normalize(filename.c_str());
+            normalize(filename.c_str(), output == "-" ? nullptr : output.c_str());
         } else if (toolname == "checksani") {
-            if (!check_sanitized(filename.c_str())) {
+            if (!check_sanitized(filename.c_str(), std::max(argparse.get<int>("jobs"), 1))) {
                 std::cerr << filename << " needs sanitization" << std::endl;
             }
         } else if (toolname == "sanitize") {
-            sanitize(filename.c_str());
+            sanitize(filename.c_str(), output == "-" ? nullptr : output.c_str(), std::max(argparse.get<int>("jobs"), 1));
         } else if (toolname == "cnf2kis") {
             std::cerr << "Generating Independent Set Problem " << filename << std::endl;
-            IndependentSetFromCNF gen(filename.c_str());
-            gen.generate_independent_set_problem(output == "-" ? nullptr : output.c_str());
+            IndependentSetFromCNF gen(filename.c_str(), argparse.get<bool>("external"));
+            gen.generate_independent_set_problem(output == "-" ? nullptr : output.c_str(), argparse.get<bool>("csr"), std::max(argparse.get<int>("jobs"), 1));
         } else if (toolname == "cnf2bip") {
             std::cerr << "Generating Bipartite Graph " << filename << std::endl;
             BipartiteGraphFromCNF gen(filename.c_str());
-            gen.generate_bipartite_graph(output == "-" ? nullptr : output.c_str());
-        } else if (toolname == "extract") {
-            std::string ext = std::filesystem::path(filename).extension();
-            if (ext == ".xz" || ext == ".lzma" || ext == ".bz2" || ext == ".gz") {
-                ext = std::filesystem::path(filename).stem().extension();
+            gen.generate_bipartite_graph(output == "-" ? nullptr : output.c_str(), argparse.get<bool>("csr"));
+        } else if (toolname == "pack") {
+            if (output == "-") {
+                std::cerr << "pack requires an output file" << std::endl;
+                return 1;
             }
-            if (ext == ".cnf") {
+            BinaryCNF::Header header = pack(filename.c_str(), output.c_str(), argparse.get<bool>("index"));
+            std::cerr << "Packed " << header.n_clauses << " clauses with " << header.n_literals << " literals over " << header.n_vars << " variables" << std::endl;
+        } else if (toolname == "unpack") {
+            unpack(filename.c_str(), output == "-" ? nullptr : output.c_str());
+        } else if (toolname == "extract") {
+            const std::string ext = instance_type(filename);
+            if (ext == ".cnf" && sample > 0) {
+                std::cerr << "Detected CNF, approximating CNF base features" << std::endl;
+                CNF::ApproxFeatures stats(filename.c_str(), sample);
+                stats.extract();
+                std::vector<double> record = stats.getFeatures();
+                std::vector<std::string> names = stats.getNames();
+                for (unsigned i = 0; i < record.size(); i++) {
+                    std::cout << names[i] << "=" << record[i] << std::endl;
+                }
+            } else if (ext == ".cnf") {
                 std::cerr << "Detected CNF, extracting CNF base features" << std::endl;
                 CNF::BaseFeatures stats(filename.c_str());
                 stats.extract();
@@ -175,7 +354,7 @@ int main(int argc, char** argv) {
                 }
             }
         } else if (toolname == "gates") {
-            CNF::GateFeatures stats(filename.c_str());
+            CNF::GateFeatures stats(filename.c_str(), std::max(argparse.get<int>("jobs"), 1));
             stats.extract();
             std::vector<double> record = stats.getFeatures();
             std::vector<std::string> names = stats.getNames();
@@ -201,6 +380,10 @@ int main(int argc, char** argv) {
         std::cerr << "Time Limit Exceeded" << std::endl;
         return 1;
     }
+    catch (std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
     catch (FileSizeLimitExceeded& e) {
         std::remove(output.c_str());
         std::cerr << "File Size Limit Exceeded" << std::endl;
@@ -0,0 +1,330 @@
+/**
+ * MIT License
+ * Copyright (c) 2024 Markus Iser
+ */
+
+#include "src/extract/CNFApproxFeatures.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+#include "src/extract/CNFBaseFeatures.h"
+#include "src/util/BinaryCNF.h"
+#include "src/util/CaptureDistribution.h"
+#include "src/util/FormulaLoader.h"
+#include "src/util/ParallelDimacs.h"
+#include "src/util/Profile.h"
+#include "src/util/ResourceBudget.h"
+#include "src/util/Sketches.h"
+#include "src/util/SolverTypes.h"
+#include "src/util/StreamBuffer.h"
+
+namespace {
+
+// sums over the sampled units of a value x and its denominator n, for ratio estimates x / n
+struct Moments {
+    double x = 0, n = 0, xx = 0, xn = 0, nn = 0;
+
+    void add(double x_, double n_) {
+        x += x_;
+        n += n_;
+        xx += x_ * x_;
+        xn += x_ * n_;
+        nn += n_ * n_;
+    }
+
+    double ratio() const {
+        return n > 0 ? x / n : 0;
+    }
+
+    // standard error of ratio() for k units sampled without replacement, fpc is the finite population correction 1 - k / N
+    double ratio_se(double k, double fpc) const {
+        if (k < 2 || n <= 0) return 0;
+        const double r = ratio();
+        const double mean_n = n / k;
+        const double ss = std::max(0.0, xx - 2 * r * xn + r * r * nn);
+        return std::sqrt(fpc * ss / (k - 1) / k) / mean_n;
+    }
+};
+
+// per clause quantities: number of literals, clause sizes 1 to 10+, horn, inverted horn, positive and negative clauses
+enum Quantity { Literals = 0, Size1 = 1, Horn = 11, InvHorn, Positive, Negative, n_quantities };
+
+// accumulators of the sampled units
+class Sampler {
+    std::array<double, n_quantities> unit_;
+    double unit_clauses_ = 0, unit_balance_ = 0, unit_nonempty_ = 0;
+
+  public:
+    std::array<Moments, n_quantities> quantities;
+    Moments clauses;  // clauses per unit
+    Moments balance;  // balance sum per nonempty clauses
+    uint64_t units = 0, sampled_clauses = 0;
+    unsigned max_var = 0;
+    Sketch::HyperLogLog distinct;
+    Sketch::Reservoir<double> balances;
+    Sketch::VariableSample degrees;
+
+    explicit Sampler(uint64_t seed) : balances(1 << 16, seed) {
+        unit_.fill(0);
+    }
+
+    inline void consume(const Cl& clause) {
+        ++unit_clauses_;
+        ++sampled_clauses;
+        unsigned n_neg = 0;
+        for (Lit lit : clause) {
+            if (lit.sign()) ++n_neg;
+            const unsigned var = lit.var();
+            max_var = std::max(max_var, var);
+            distinct.add(var);
+            degrees.add(var);
+        }
+        const unsigned n_pos = clause.size() - n_neg;
+        unit_[Literals] += clause.size();
+        if (clause.size() > 0) unit_[std::min<size_t>(clause.size(), 10)] += 1;
+        if (n_neg <= 1) {
+            ++unit_[Horn];
+            if (n_neg == 0) ++unit_[Positive];
+        }
+        if (n_pos <= 1) {
+            ++unit_[InvHorn];
+            if (n_pos == 0) ++unit_[Negative];
+        }
+        if (clause.size() > 0) {
+            const double b = (double)std::min(n_pos, n_neg) / (double)std::max(n_pos, n_neg);
+            unit_balance_ += b;
+            ++unit_nonempty_;
+            balances.add(b);
+        }
+    }
+
+    void end_unit() {
+        for (unsigned q = 0; q < n_quantities; ++q) {
+            quantities[q].add(unit_[q], unit_clauses_);
+        }
+        clauses.add(unit_clauses_, 1);
+        balance.add(unit_balance_, unit_nonempty_);
+        unit_.fill(0);
+        unit_clauses_ = unit_balance_ = unit_nonempty_ = 0;
+        ++units;
+    }
+};
+
+// clauses of an uncompressed DIMACS file which start on lines beginning in [begin, end), the last clause can continue after end
+class BlockParser {
+    std::FILE* file_;
+    std::vector<char> buffer_;
+    size_t pos_ = 0, len_ = 0;
+    uint64_t offset_ = 0;  // file position of buffer_[0]
+
+    inline int peek() {
+        if (pos_ == len_) {
+            offset_ += len_;
+            pos_ = 0;
+            len_ = std::fread(buffer_.data(), 1, buffer_.size(), file_);
+            if (len_ == 0) return EOF;
+        }
+        return static_cast<unsigned char>(buffer_[pos_]);
+    }
+
+    inline void skip_line() {
+        int c;
+        while ((c = peek()) != EOF && c != '\n') ++pos_;
+        if (c == '\n') ++pos_;
+    }
+
+  public:
+    explicit BlockParser(const char* filename) : file_(std::fopen(filename, "rb")), buffer_(1 << 16) {
+        if (file_ == nullptr) throw ParserException(std::string("Error opening file: ") + filename);
+    }
+
+    ~BlockParser() {
+        std::fclose(file_);
+    }
+
+    template <typename Consumer>
+    void parse(uint64_t begin, uint64_t end, Consumer&& consume) {
+        const uint64_t start = begin > 0 ? begin - 1 : 0;
+        if (fseeko(file_, start, SEEK_SET) != 0) throw ParserException("Error seeking in file");
+        offset_ = start;
+        pos_ = len_ = 0;
+        if (begin > 0) skip_line();  // the line which starts before begin belongs to the previous block
+        Cl clause;
+        bool open = false;  // clause continues on the next line
+        int c;
+        while ((c = peek()) != EOF) {
+            if (!open && offset_ + pos_ >= end) return;
+            ResourceBudget::poll();
+            if (c == 'c' || c == 'p') {
+                skip_line();
+                continue;
+            }
+            while ((c = peek()) != EOF && c != '\n') {
+                if (c == ' ' || c == '\t' || c == '\r') {
+                    ++pos_;
+                    continue;
+                }
+                const bool sign = c == '-';
+                if (sign) {
+                    ++pos_;
+                    c = peek();
+                }
+                if (c < '0' || c > '9') throw ParserException(std::string("Unexpected character in clause: ") + static_cast<char>(c));
+                uint64_t value = 0;
+                while ((c = peek()) >= '0' && c <= '9') {
+                    value = 10 * value + (c - '0');
+                    if (value > INT32_MAX) throw ParserException("Literal out of range");
+                    ++pos_;
+                }
+                if (value == 0) {
+                    consume(clause);
+                    clause.clear();
+                    open = false;
+                } else {
+                    clause.push_back(Lit(static_cast<unsigned>(value), sign));
+                    open = true;
+                }
+            }
+            if (c == '\n') ++pos_;
+        }
+        if (open) consume(clause);  // unterminated last clause
+    }
+};
+
+// sorted sample of ceil(fraction * n) of the numbers 0 to n - 1, at least two for a standard error
+std::vector<uint64_t> pick(uint64_t n, double fraction, std::mt19937_64& rng) {
+    const uint64_t k = std::min<uint64_t>(n, std::max<uint64_t>(2, std::ceil(fraction * n)));
+    std::vector<uint64_t> all(n);
+    std::iota(all.begin(), all.end(), 0);
+    if (k == n) return all;
+    std::vector<uint64_t> picked;
+    picked.reserve(k);
+    std::sample(all.begin(), all.end(), std::back_inserter(picked), k, rng);
+    return picked;
+}
+
+}  // namespace
+
+void CNF::ApproxFeatures::extract() {
+    if (!(fraction_ > 0 && fraction_ <= 1)) {
+        throw std::runtime_error("Sampling fraction must be in (0, 1]");
+    }
+    Profile::Scope scope("extract");
+    std::mt19937_64 rng(seed_);
+    Sampler sample(seed_);
+    const FormulaHint hint = formula_hint(filename_);
+    double total_units = 0;
+    double known_clauses = -1;  // exact number of clauses if known
+    Cl clause;
+
+    const bool packed = BinaryCNF::is_packed(filename_);
+    std::unique_ptr<BinaryCNF::Reader> indexed;
+    if (packed) {
+        indexed = std::make_unique<BinaryCNF::Reader>(filename_);
+        if (indexed->index_size() == 0) indexed.reset();
+    }
+    if (indexed) {
+        known_clauses = indexed->header().n_clauses;
+        total_units = indexed->index_size();
+        const uint64_t stride = indexed->header().index_stride;
+        for (uint64_t entry : pick(indexed->index_size(), fraction_, rng)) {
+            indexed->seek(entry);
+            for (uint64_t i = 0; i < stride && indexed->readClause(clause); ++i) {
+                sample.consume(clause);
+            }
+            sample.end_unit();
+        }
+    } else if (!packed && ParallelDimacs::supported(filename_)) {
+        const uint64_t size = std::filesystem::file_size(filename_);
+        const uint64_t n_blocks = std::max<uint64_t>(1, (size + block_size_ - 1) / block_size_);
+        total_units = n_blocks;
+        BlockParser parser(filename_);
+        for (uint64_t block : pick(n_blocks, fraction_, rng)) {
+            parser.parse(block * block_size_, std::min(size, (block + 1) * block_size_), [&sample] (const Cl& clause) { sample.consume(clause); });
+            sample.end_unit();
+        }
+    } else {
+        // no random access, every k-th clause starting at a random offset
+        const uint64_t k = std::max<uint64_t>(1, std::llround(1 / fraction_));
+        const uint64_t offset = rng() % k;
+        ClauseReader in(filename_);
+        uint64_t n = 0;
+        while (in.readClause(clause)) {
+            if (n % k == offset) {
+                sample.consume(clause);
+                sample.end_unit();
+            }
+            ++n;
+        }
+        known_clauses = n;
+        total_units = n;
+    }
+    Profile::count("clauses", sample.sampled_clauses);
+
+    const double k = sample.units;
+    const double fpc = total_units > 0 ? std::max(0.0, 1 - k / total_units) : 0;
+    double n_clauses = known_clauses, clauses_se = 0;
+    if (known_clauses < 0) {
+        n_clauses = total_units * sample.clauses.ratio();
+        clauses_se = total_units * sample.clauses.ratio_se(k, fpc);
+    }
+    // header is only trusted if not all clauses are read
+    const double n_vars = fpc > 0 ? std::max<double>(hint.vars, sample.max_var) : sample.max_var;
+    const double distinct = sample.distinct.estimate();
+    features.clear();
+    features.insert(features.end(), { n_clauses, clauses_se, n_vars, distinct, distinct * sample.distinct.relative_error() });
+
+    // extrapolated totals of the per clause quantities
+    std::array<double, n_quantities> totals, totals_se;
+    for (unsigned q = 0; q < n_quantities; ++q) {
+        const double r = sample.quantities[q].ratio();
+        const double r_se = sample.quantities[q].ratio_se(k, fpc);
+        totals[q] = r * n_clauses;
+        totals_se[q] = std::sqrt(n_clauses * n_clauses * r_se * r_se + r * r * clauses_se * clauses_se);
+    }
+    for (unsigned q = Size1; q < n_quantities; ++q) {
+        features.insert(features.end(), { totals[q], totals_se[q] });
+    }
+
+    features.insert(features.end(), { sample.quantities[Literals].ratio(), sample.quantities[Literals].ratio_se(k, fpc) });
+    features.insert(features.end(), { n_vars > 0 ? totals[Literals] / n_vars : 0, n_vars > 0 ? totals_se[Literals] / n_vars : 0 });
+    // sampled occurrence counts are scaled to all clauses
+    const double scale = sample.sampled_clauses > 0 ? n_clauses / sample.sampled_clauses : 0;
+    for (double q : { 0.5, 0.9, 0.99 }) {
+        features.push_back(scale * sample.degrees.quantile(q));
+    }
+
+    std::vector<double> balance;
+    push_distribution(balance, sample.balances.sample());
+    balance[0] = sample.balance.ratio();  // mean of all sampled clauses instead of the reservoir
+    features.insert(features.end(), { balance[0], sample.balance.ratio_se(k, fpc), balance[1], balance[2], balance[3], balance[4] });
+
+    features.insert(features.end(), { (double)sample.sampled_clauses, total_units > 0 ? k / total_units : 0 });
+}
+
+std::vector<double> CNF::ApproxFeatures::getFeatures() const {
+    return features;
+}
+
+std::vector<std::string> CNF::ApproxFeatures::getNames() const {
+    std::vector<std::string> names = { "clauses", "clauses_se", "variables", "distinct_vars", "distinct_vars_se" };
+    for (const char* name : { "cls1", "cls2", "cls3", "cls4", "cls5", "cls6", "cls7", "cls8", "cls9", "cls10p", "horn", "invhorn", "positive", "negative" }) {
+        names.push_back(name);
+        names.push_back(std::string(name) + "_se");
+    }
+    names.insert(names.end(), { "vcg_cdegree_mean", "vcg_cdegree_mean_se", "vcg_vdegree_mean", "vcg_vdegree_mean_se" });
+    names.insert(names.end(), { "vcg_vdegree_q50", "vcg_vdegree_q90", "vcg_vdegree_q99" });
+    names.insert(names.end(), { "balancecls_mean", "balancecls_mean_se", "balancecls_variance", "balancecls_min", "balancecls_max", "balancecls_entropy" });
+    names.insert(names.end(), { "sampled_clauses", "sampled_fraction" });
+    return names;
+}
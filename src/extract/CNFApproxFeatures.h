@@ -0,0 +1,54 @@
+/**
+ * MIT License
+ * Copyright (c) 2024 Markus Iser 
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "IExtractor.h"
+
+namespace CNF {
+
+/**
+ * @brief Approximate base features from a random sample of the clauses, for triage of huge instances
+ * Sampling units are
+ * - blocks of block_size bytes at random positions of uncompressed DIMACS files (clauses are assumed to start at line starts),
+ * - groups of index_stride clauses at random entries of the clause index of packed files (see pack --index),
+ * - every k-th clause (k = 1 / fraction) of all other inputs, which are still decompressed and parsed completely.
+ * Counts are extrapolated from the sampled units, estimates are followed by their standard error (<name>_se).
+ * Distinct variables of the sample are counted with HyperLogLog, the clause balance distribution is summarized
+ * from a reservoir sample and variable degree quantiles from a hash-selected subset of the variables.
+ * With fraction 1 all counts are exact and all standard errors are 0.
+ */
+class ApproxFeatures : public IExtractor {
+    const char* filename_;
+    double fraction_;
+    uint64_t seed_;
+    size_t block_size_;
+    std::vector<double> features;
+
+  public:
+    static constexpr size_t default_block_size = 1 << 16;
+
+    /**
+     * @param fraction of sampling units to read, in (0, 1]
+     * @param seed of the selection of sampling units
+     * @param block_size size of sampled byte blocks of uncompressed DIMACS files
+     */
+    explicit ApproxFeatures(const char* filename, double fraction = 0.01, uint64_t seed = 0, size_t block_size = default_block_size)
+        : filename_(filename), fraction_(fraction), seed_(seed), block_size_(block_size) { }
+
+    void extract() override;
+    std::vector<double> getFeatures() const override;
+    std::vector<std::string> getNames() const override;
+
+    std::string getRuntimeDesc() override {
+        return "approx_features_runtime";
+    }
+};
+
+}; // namespace CNF
@@ -6,77 +6,306 @@
 #pragma once
 
 #include "IExtractor.h"
+#include "src/extract/Pipeline.h"
+#include "src/util/SolverTypes.h"
+#include "src/util/StateFile.h"
+#include "src/util/ExternalCNFFormula.h"
+#include "src/util/ResourceBudget.h"
+#include "src/util/UnionFind.h"
+#include "src/util/CaptureDistribution.h"
+#include <algorithm>
 #include <array>
+#include <cmath>
 
 namespace CNF {
 
-class BaseFeatures : public IExtractor {
-    const char* filename_;
-    std::vector<double> features;
-    std::vector<std::string> names;
+// feature groups of the base features, see Pipeline
+namespace Group {
 
-    void extractBaseFeatures1();
-    void extractBaseFeatures2();
+// number of clauses, variables and bytes of the normalized file
+class Counts {
+    unsigned n_vars = 0, n_clauses = 0, bytes = 0;
 
   public:
-    BaseFeatures(const char* filename);
-    virtual ~BaseFeatures();
-    virtual void extract();
-    virtual std::vector<double> getFeatures() const;
-    virtual std::vector<std::string> getNames() const;
+    explicit Counts(const char*) { }
+
+    inline void consume(const Cl& clause) {
+        ++n_clauses;
+        bytes += 2;
+        for (Lit lit : clause) {
+            bytes += lit.sign() + ceil(log10((float)lit.var())) + 1;
+            n_vars = std::max(n_vars, static_cast<unsigned>(lit.var()));
+        }
+    }
+    void finalize(std::vector<double>& features);
+    static void names(std::vector<std::string>& names);
+    void save(StateFile::Writer& out) const;
+    void load(StateFile::Reader& in);
 };
 
-class BaseFeatures1 : public IExtractor {
-    const char* filename_;
-    std::vector<double> features;
-    std::vector<std::string> names;
-    unsigned n_vars = 0, n_clauses = 0, bytes = 0, ccs = 0;
-    // count occurences of clauses of small size
+// number of connected components
+class Components {
+    UnionFind uf;
+
+  public:
+    explicit Components(const char* filename);
+
+    inline void consume(const Cl& clause) {
+        uf.insert(clause);
+    }
+    void finalize(std::vector<double>& features);
+    static void names(std::vector<std::string>& names);
+    void save(StateFile::Writer& out) const;
+    void load(StateFile::Reader& in);
+};
+
+// count occurences of clauses of small size
+class ClauseSizes {
     std::array<unsigned, 11> clause_sizes;
-    // numbers of (inverted) horn clauses
+
+  public:
+    explicit ClauseSizes(const char*) {
+        clause_sizes.fill(0);
+    }
+
+    inline void consume(const Cl& clause) {
+        ++clause_sizes[std::min(clause.size(), 10UL)];
+    }
+    void finalize(std::vector<double>& features);
+    static void names(std::vector<std::string>& names);
+    void save(StateFile::Writer& out) const;
+    void load(StateFile::Reader& in);
+};
+
+// (inverted) horn and positive / negative clauses, occurrence counts in horn clauses (per variable)
+class Horn {
+    unsigned n_vars = 0;
     unsigned horn = 0, inv_horn = 0;
-    // number of positive and negative clauses
     unsigned positive = 0, negative = 0;
-    // occurrence counts in horn clauses (per variable)
     std::vector<unsigned> variable_horn, variable_inv_horn;
-    // pos-neg literal balance (per clause)
-    std::vector<double> balance_clause;
-    // pos-neg literal balance (per variable)
-    std::vector<double> balance_variable;
-    // Literal Occurrences
+
+  public:
+    explicit Horn(const char*) { }
+
+    inline void consume(const Cl& clause) {
+        unsigned n_neg = 0;
+        for (Lit lit : clause) {
+            if (static_cast<unsigned>(lit.var()) > n_vars) {
+                n_vars = lit.var();
+                variable_horn.resize(n_vars + 1);
+                variable_inv_horn.resize(n_vars + 1);
+            }
+            if (lit.sign()) ++n_neg;
+        }
+        unsigned n_pos = clause.size() - n_neg;
+        if (n_neg <= 1) {
+            if (n_neg == 0) ++positive;
+            ++horn;
+            for (Lit lit : clause) {
+                ++variable_horn[lit.var()];
+            }
+        }
+        if (n_pos <= 1) {
+            if (n_pos == 0) ++negative;
+            ++inv_horn;
+            for (Lit lit : clause) {
+                ++variable_inv_horn[lit.var()];
+            }
+        }
+    }
+    void finalize(std::vector<double>& features);
+    static void names(std::vector<std::string>& names);
+    void save(StateFile::Writer& out) const;
+    void load(StateFile::Reader& in);
+};
+
+// pos-neg literal balance (per clause and per variable)
+class Balance {
+    unsigned n_vars = 0;
+    Histogram<double> balance_clause;
     std::vector<unsigned> literal_occurrences;
 
-    void load_feature_record();
+  public:
+    explicit Balance(const char*) { }
+
+    inline void consume(const Cl& clause) {
+        unsigned n_neg = 0;
+        for (Lit lit : clause) {
+            if (static_cast<unsigned>(lit.var()) > n_vars) {
+                n_vars = lit.var();
+                literal_occurrences.resize(2 * n_vars + 2);
+            }
+            if (lit.sign()) ++n_neg;
+            ++literal_occurrences[lit];
+        }
+        unsigned n_pos = clause.size() - n_neg;
+        if (clause.size() > 0) {
+            balance_clause.add((double)std::min(n_pos, n_neg) / (double)std::max(n_pos, n_neg));
+        }
+    }
+    void finalize(std::vector<double>& features);
+    static void names(std::vector<std::string>& names);
+    void save(StateFile::Writer& out) const;
+    void load(StateFile::Reader& in);
+};
+
+// VCG Degree Distribution: occurence counts and clause sizes
+class VCGDegrees {
+    unsigned n_vars = 0;
+    Histogram<unsigned> vcg_cdegree;
+    std::vector<unsigned> vcg_vdegree;
+
+  public:
+    explicit VCGDegrees(const char*) { }
+
+    inline void consume(const Cl& clause) {
+        vcg_cdegree.add(clause.size());
+        for (Lit lit : clause) {
+            if (static_cast<unsigned>(lit.var()) > n_vars) {
+                n_vars = lit.var();
+                vcg_vdegree.resize(n_vars + 1);
+            }
+            ++vcg_vdegree[lit.var()];
+        }
+    }
+    void finalize(std::vector<double>& features);
+    static void names(std::vector<std::string>& names);
+};
+
+// VIG Degree Distribution
+class VGDegrees {
+    unsigned n_vars = 0;
+    std::vector<unsigned> vg_degree;
 
   public:
-    BaseFeatures1(const char* filename);
-    virtual ~BaseFeatures1();
-    virtual void extract();
-    virtual std::vector<double> getFeatures() const;
-    virtual std::vector<std::string> getNames() const;
+    explicit VGDegrees(const char*) { }
+
+    inline void consume(const Cl& clause) {
+        for (Lit lit : clause) {
+            if (static_cast<unsigned>(lit.var()) > n_vars) {
+                n_vars = lit.var();
+                vg_degree.resize(n_vars + 1);
+            }
+            vg_degree[lit.var()] += clause.size();
+        }
+    }
+    void finalize(std::vector<double>& features);
+    static void names(std::vector<std::string>& names);
 };
 
-class BaseFeatures2 : public IExtractor {
+// CG Degree Distribution, clause degrees depend on final variable occurrence counts
+class CGDegrees {
     const char* filename_;
-    std::vector<double> features;
-    std::vector<std::string> names;
-    unsigned n_vars = 0, n_clauses = 0;
-    // VCG Degree Distribution:
-    std::vector<unsigned> vcg_cdegree; // clause sizes
-    std::vector<unsigned> vcg_vdegree; // occurence counts
-    // VIG Degree Distribution:
-    std::vector<unsigned> vg_degree;
-    // CG Degree Distribution:
-    std::vector<unsigned> clause_degree;
+    unsigned n_vars = 0;
+    std::vector<unsigned> occurrences;
+    Histogram<unsigned> clause_degree;
+    // variables and lengths of all clauses for the clause degree pass
+    std::vector<unsigned> clause_vars;
+    std::vector<unsigned> clause_sizes;
+    std::unique_ptr<ClauseSpill> spill;  // clauses which do not fit into memory
+    bool store_clauses_ = true;
+
+    /**
+     * @brief decides whether the clause is stored in memory, called whenever the store has to grow
+     * The grown store may take a fraction of the memory still available under the budget or RLIMIT_AS,
+     * such that a tight memory limit spills early but never runs out of memory because of the store.
+     */
+    bool fits_in_memory(size_t size) const {
+        if (clause_vars.size() + size > max_stored_literals) return false;
+        const size_t vars = std::max(clause_vars.size() + size, 2 * clause_vars.capacity());
+        const size_t sizes = std::max(clause_sizes.size() + 1, 2 * clause_sizes.capacity());
+        const size_t grown = (clause_vars.size() + size > clause_vars.capacity() ? vars : 0)
+            + (clause_sizes.size() + 1 > clause_sizes.capacity() ? sizes : 0);
+        return grown == 0 || static_cast<int64_t>(grown * sizeof(unsigned)) <= ResourceBudget::available_memory() / available_fraction;
+    }
 
-    void load_feature_records();
+    void start_spill() {
+        const int64_t window = ResourceBudget::available_memory() / available_fraction;
+        spill = std::make_unique<ClauseSpill>(std::clamp<int64_t>(window, 1 << 20, ClauseSpill::default_window_size));
+    }
 
   public:
-    BaseFeatures2(const char* filename);
-    virtual ~BaseFeatures2();
-    virtual void extract();
-    virtual std::vector<double> getFeatures() const;
-    virtual std::vector<std::string> getNames() const;
+    // maximum number of literals stored in memory, further clauses are spilled to a temporary file
+    static constexpr size_t max_stored_literals = 1UL << 27;
+    // the store and the spill windows take at most this fraction of the available memory
+    static constexpr int64_t available_fraction = 4;
+
+    explicit CGDegrees(const char* filename) : filename_(filename) { }
+
+    /**
+     * @param store keep the variables of all clauses, such that clause degrees are computed without a second parse
+     */
+    void store_clauses(bool store) {
+        store_clauses_ = store;
+    }
+
+    inline void consume(const Cl& clause) {
+        for (Lit lit : clause) {
+            if (static_cast<unsigned>(lit.var()) > n_vars) {
+                n_vars = lit.var();
+                occurrences.resize(n_vars + 1);
+            }
+            ++occurrences[lit.var()];
+        }
+        if (!store_clauses_) return;
+        if (spill) {
+            spill->add(clause);
+        } else if (!fits_in_memory(clause.size())) {
+            try {
+                start_spill();
+                spill->add(clause);
+            } catch (const std::runtime_error&) {
+                // no temporary file, read the formula a second time
+                store_clauses_ = false;
+                std::vector<unsigned>().swap(clause_vars);
+                std::vector<unsigned>().swap(clause_sizes);
+            }
+        } else {
+            for (Lit lit : clause) clause_vars.push_back(lit.var());
+            clause_sizes.push_back(clause.size());
+        }
+    }
+
+    // second pass, if called for each clause before finalize() no clauses need to be stored
+    template <typename Clause>
+    void consume_degree(const Clause& clause) {
+        unsigned degree = 0;
+        for (Lit lit : clause) {
+            degree += occurrences[lit.var()];
+        }
+        clause_degree.add(degree);
+    }
+    void finalize(std::vector<double>& features);
+    static void names(std::vector<std::string>& names);
+};
+
+} // namespace Group
+
+class BaseFeatures : public Pipeline<Group::Counts, Group::Components, Group::ClauseSizes, Group::Horn, Group::Balance,
+                                     Group::VCGDegrees, Group::VGDegrees, Group::CGDegrees> {
+  public:
+    explicit BaseFeatures(const char* filename) : Pipeline(filename) { }
+};
+
+class BaseFeatures1 : public Pipeline<Group::Counts, Group::Components, Group::ClauseSizes, Group::Horn, Group::Balance> {
+  public:
+    explicit BaseFeatures1(const char* filename) : Pipeline(filename) { }
+};
+
+class BaseFeatures2 : public Pipeline<Group::VCGDegrees, Group::VGDegrees, Group::CGDegrees> {
+  public:
+    /**
+     * @param store_clauses keep the variables of all clauses, such that clause degrees are computed without a second parse
+     */
+    explicit BaseFeatures2(const char* filename, bool store_clauses = true) : Pipeline(filename) {
+        get<Group::CGDegrees>().store_clauses(store_clauses);
+    }
+
+    // clause degrees are computed from stored clauses (or a second parse) unless consume_degree() is called for each clause before finalize()
+    template <typename Clause>
+    void consume_degree(const Clause& clause) {
+        get<Group::CGDegrees>().consume_degree(clause);
+    }
 };
 
-}; // namespace CNF
\ No newline at end of file
+}; // namespace CNF
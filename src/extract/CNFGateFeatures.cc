@@ -5,12 +5,22 @@
 
 #include "src/extract/CNFGateFeatures.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+
 #include "src/util/SolverTypes.h"
 #include "src/extract/gates/GateFormula.h"
 #include "src/extract/gates/GateAnalyzer.h"
 #include "src/util/CaptureDistribution.h"
+#include "src/util/Profile.h"
+#include "src/util/ResourceBudget.h"
+#include "src/util/UnionFind.h"
 
-CNF::GateFeatures::GateFeatures(const char* filename) : filename_(filename), features(), names() { 
+CNF::GateFeatures::GateFeatures(const char* filename, unsigned threads) : filename_(filename), threads_(threads), features(), names() { 
     names.insert(names.end(), { "n_vars", "n_gates", "n_roots" });
     names.insert(names.end(), { "n_none", "n_generic", "n_mono" });
     names.insert(names.end(), { "n_and", "n_or", "n_triv", "n_equiv", "n_full" });
@@ -27,12 +37,120 @@ CNF::GateFeatures::GateFeatures(const char* filename) : filename_(filename), fea
 
 CNF::GateFeatures::~GateFeatures() { }
 
+/**
+ * @brief distributes the clauses of variable-disjoint components over at most n formulas of similar size,
+ * largest components first to the least loaded formula, the first formula gets the largest share
+ * Components with unit clauses stay together, as they share the first root selection of the analysis.
+ */
+static std::vector<std::unique_ptr<CNFFormula>> split_components(const CNFFormula& formula, unsigned n) {
+    UnionFind uf;
+    Cl units;
+    for (const Clause* clause : formula) {
+        if (clause->size() > 0) uf.insert(Cl(clause->begin(), clause->end()));
+        if (clause->size() == 1) units.push_back(clause->front());
+    }
+    if (units.size() > 1) uf.insert(units);
+    std::vector<unsigned> size(formula.nVars() + 1, 0);  // number of clauses by component representative
+    for (const Clause* clause : formula) {
+        if (clause->size() > 0) ++size[uf.find(clause->front().var())];
+    }
+    // components in order of their smallest variable
+    std::vector<unsigned> components;
+    std::vector<bool> listed(formula.nVars() + 1, false);
+    for (unsigned var = 1; var <= formula.nVars(); ++var) {
+        const unsigned rep = uf.find(Var(var));
+        if (size[rep] > 0 && !listed[rep]) {
+            listed[rep] = true;
+            components.push_back(rep);
+        }
+    }
+    std::stable_sort(components.begin(), components.end(), [&size] (unsigned a, unsigned b) { return size[a] > size[b]; });
+    std::vector<unsigned> part(formula.nVars() + 1, 0);
+    std::vector<size_t> load(std::max(1u, std::min<unsigned>(n, components.size())), 0);
+    for (unsigned component : components) {
+        const size_t p = std::min_element(load.begin(), load.end()) - load.begin();
+        part[component] = p;
+        load[p] += size[component];
+    }
+    std::vector<std::unique_ptr<CNFFormula>> parts;
+    for (size_t p = 0; p < load.size(); ++p) {
+        parts.push_back(std::make_unique<CNFFormula>());
+    }
+    for (const Clause* clause : formula) {
+        const unsigned p = clause->size() > 0 ? part[uf.find(clause->front().var())] : 0;
+        parts[p]->readClause(clause->begin(), clause->end());
+    }
+    return parts;
+}
+
 void CNF::GateFeatures::extract() {
-    CNFFormula formula(filename_);
-    GateAnalyzer analyzer(formula, true, true, formula.nVars() / 3, false);
-    analyzer.analyze();
-    GateFormula gates = analyzer.getGateFormula();
-    n_vars = formula.nVars();
+    GateFormula gates(0);
+    std::vector<std::unique_ptr<CNFFormula>> parts;  // clauses referenced by gates
+    auto analyze_serial = [&] () {
+        parts.clear();
+        parts.push_back(std::make_unique<CNFFormula>(filename_, threads_));
+        n_vars = parts[0]->nVars();
+        Profile::Scope scope("analyze");
+        GateAnalyzer analyzer(*parts[0], true, true, n_vars / 3, false);
+        analyzer.analyze();
+        gates = analyzer.getGateFormula();
+    };
+    if (threads_ > 1) {
+        // gate recognition does not cross component borders, analyze groups of components in parallel
+        {
+            CNFFormula formula(filename_, threads_);
+            n_vars = formula.nVars();
+            parts = split_components(formula, threads_);
+        }
+        std::vector<GateFormula> results(parts.size(), GateFormula(0));
+        std::vector<std::exception_ptr> errors(parts.size());
+        std::vector<char> complete(parts.size(), false);
+        // root selections of all groups share the budget of the serial analysis
+        std::atomic<unsigned> selections(0);
+        // workers share the limits of the calling thread's resource budget
+        std::vector<std::unique_ptr<ResourceBudget>> budgets;
+        for (size_t p = 0; p < parts.size(); ++p) {
+            budgets.push_back(std::make_unique<ResourceBudget>(ResourceBudget::current()));
+        }
+        auto job = [&] (size_t p) {
+            try {
+                Profile::Scope scope("analyze");
+                GateAnalyzer analyzer(*parts[p], true, true, n_vars / 3, false);
+                complete[p] = analyzer.analyze(&selections);
+                if (complete[p]) results[p] = analyzer.getGateFormula();
+            } catch (...) {
+                errors[p] = std::current_exception();
+            }
+        };
+        // first part on calling thread which owns the resource budget
+        std::vector<std::thread> workers;
+        for (size_t p = 1; p < parts.size(); ++p) {
+            workers.emplace_back([&job, &budgets, p] () {
+                ResourceBudget::Scope budget(*budgets[p]);
+                job(p);
+            });
+        }
+        job(0);
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        for (const std::exception_ptr& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+        if (std::all_of(complete.begin(), complete.end(), [] (char c) { return c; })) {
+            gates = GateFormula(n_vars, 0);
+            for (GateFormula& result : results) {
+                gates.merge(result);
+            }
+        } else {
+            // the serial analysis stops at a root selection which depends on the order across groups
+            results.clear();
+            analyze_serial();
+        }
+    } else {
+        analyze_serial();
+    }
+    Profile::Scope scope("summarize");
     n_gates = gates.nGates();
     n_roots = gates.nRoots();
     levels.resize(n_vars + 1, 0);
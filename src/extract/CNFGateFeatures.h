@@ -18,6 +18,7 @@ namespace CNF {
 
 class GateFeatures : public IExtractor {
     const char *filename_;
+    unsigned threads_;
     std::vector<double> features;
     std::vector<std::string> names;
 
@@ -32,7 +33,10 @@ class GateFeatures : public IExtractor {
     void load_feature_records();
 
 public:
-    GateFeatures(const char* filename);
+    /**
+     * @param threads parse plain DIMACS files and analyze variable-disjoint components with this many threads
+     */
+    GateFeatures(const char* filename, unsigned threads = 1);
     virtual ~GateFeatures();
     virtual void extract();
     virtual std::vector<double> getFeatures() const;
@@ -5,103 +5,84 @@
 
 #include "OPBBaseFeatures.h"
 
-#include "src/util/StreamBuffer.h"
+#include <cmath>
+#include <limits>
+
+#include "src/util/OPBReader.h"
+#include "src/util/Profile.h"
 #include "src/util/CaptureDistribution.h"
 
-OPB::TermSum::TermSum(StreamBuffer &in) {
-    for (in.skipWhitespace(); *in != ';' && *in != '>' && *in != '='; in.skipWhitespace()) {
-        std::string coeffstr;
-        in.readNumber(&coeffstr);
-        double coeff = std::stod(coeffstr);
-        in.skipWhitespace();
-        if (*in == 'x') {
-            in.skip();
-        } else {
-            assert(*in == '~');
-            in.skip();
-            in.skipWhitespace();
-            in.skip();
+namespace {
+    /**
+     * @brief value range of the left hand side of a constraint, coefficients are stored in a reused vector
+     */
+    struct TermSum {
+        std::vector<double> coeffs;
+        double max = 0;
+        double min = 0;
+        double abs_min_coeff = std::numeric_limits<double>::max();
+        unsigned max_var = 0;
+
+        void reset(const OPB::Reader& in, const OPB::Constraint& constr) {
+            coeffs.clear();
+            max = min = 0;
+            abs_min_coeff = std::numeric_limits<double>::max();
+            max_var = 0;
+            for (const OPB::Token& token : constr.terms) {
+                if (token.kind == OPB::Token::NUMBER) {
+                    const double coeff = in.toDouble(token);
+                    if (coeff < 0) {
+                        min += coeff;
+                    } else {
+                        max += coeff;
+                    }
+                    abs_min_coeff = std::min(std::abs(coeff), abs_min_coeff);
+                    coeffs.push_back(coeff);
+                } else if (!token.big && token.value >= 0 && static_cast<uint64_t>(token.value) + 1 > max_var) {
+                    max_var = token.value + 1;
+                }
+            }
         }
-        if (coeff < 0) {
-            min += coeff;
-        } else {
-            max += coeff;
+    };
+
+    struct Analysis {
+        bool tautology : 1;
+        bool unsat : 1;
+        bool assignment : 1;
+        bool clause : 1;
+        bool card : 1;
+    };
+
+    // relation is GE or EQ, LE constraints are negated beforehand
+    Analysis analyse(const TermSum& terms, OPB::Constraint::Rel rel, double bound) {
+        Analysis a {};
+        if (terms.coeffs.size()) {
+            const double multiplier = std::trunc(std::abs(terms.coeffs.front()));
+            a.card = true;
+            for (double coeff : terms.coeffs) {
+                if (std::trunc(std::abs(coeff)) != multiplier) {
+                    a.card = false;
+                    break;
+                }
+            }
         }
-        abs_min_coeff = std::min(std::abs(coeff), abs_min_coeff);
-        int var;
-        in.readInteger(&var);
-        if (Var(var + 1) > max_var) max_var = Var(var + 1);
-        coeffs.push_back(coeff);
-    }
-}
-
-size_t OPB::TermSum::nTerms() {
-    return coeffs.size();
-}
-
-double const OPB::TermSum::minVal() {
-    return min;
-}
-
-double const OPB::TermSum::maxVal() {
-    return max;
-}
-
-Var const OPB::TermSum::maxVar() {
-    return max_var;
-}
-
-double const OPB::TermSum::minCoeff() {
-    return abs_min_coeff;
-}
-
-OPB::Constr::Constr(StreamBuffer &in) : terms(in) {
-    if (*in == '>') {
-        rel = GE;
-        in.skipString(">=");
-    } else {
-        assert(*in == '=');
-        in.skip();
-    }
-    in.readNumber(&strbound);
-    bound = std::stod(strbound);
-    in.skipWhitespace();
-    if (*in == ';') in.skip();
-}
-
-typename OPB::Constr::Analysis OPB::Constr::analyse() {
-    Analysis a {};
-    if (terms.nTerms()) {
-        int multiplier = abs(terms.coeffs.front());
-        a.card = true;
-        for (int coeff: terms.coeffs) {
-            if (std::abs(coeff) != multiplier) {
-                a.card = false;
+        switch (rel) {
+            case OPB::Constraint::GE:
+                a.tautology = terms.min >= bound;
+                a.unsat = terms.max < bound;
+                a.assignment = terms.max - terms.abs_min_coeff < bound && terms.max > bound;
+                a.clause = bound > terms.min && bound <= terms.min + terms.abs_min_coeff;
                 break;
-            }
+            case OPB::Constraint::EQ:
+            default:
+                a.tautology = terms.min == terms.max && terms.min == bound;
+                a.unsat = terms.min > bound || terms.max < bound;
+                a.assignment = bound == terms.max || bound == terms.min;
+                a.clause = false;
         }
+        return a;
     }
-    switch (rel) {
-        case GE:
-            a.tautology = terms.minVal() >= bound;
-            a.unsat = terms.maxVal() < bound;
-            a.assignment = terms.maxVal() - terms.minCoeff() < bound && terms.maxVal() > bound;
-            a.clause = bound > terms.minVal() && bound <= terms.minVal() + terms.minCoeff();
-            break;
-        case EQ:
-        default:
-            a.tautology = terms.minVal() == terms.maxVal() && terms.minVal() == bound;
-            a.unsat = terms.minVal() > bound || terms.maxVal() < bound;
-            a.assignment = bound == terms.maxVal() || bound == terms.minVal();
-            a.clause = false;
-    }
-
-    return a;
-}
-
-Var OPB::Constr::maxVar() {
-    return terms.maxVar();
-}
+}  // namespace
 
 OPB::BaseFeatures::BaseFeatures(const char* filename) : filename_(filename), features(), names() { 
     names.insert(names.end(), { "constraints", "variables" });
@@ -115,62 +96,69 @@ OPB::BaseFeatures::BaseFeatures(const char* filename) : filename_(filename), fea
 OPB::BaseFeatures::~BaseFeatures() { }
 
 void OPB::BaseFeatures::extract() {
-    StreamBuffer in(filename_);
+    Profile::Scope scope("extract");
+    Reader in(filename_);
 
+    TermSum terms;
     bool seen_obj = false;
-    while (in.skipWhitespace()) {
-        if (*in == '*') {
-            in.skipLine();
-        } else if (*in == 'm') {
-            in.skipString("min:");
+    while (in.next()) {
+        const Constraint& constr = in.constraint();
+        if (constr.objective) {
             // if multiple objective lines are encountered, the first will be used
-            if (seen_obj) {
-                in.skipLine();
-                continue;
-            }
+            if (seen_obj) continue;
             seen_obj = true;
-            TermSum obj(in);
-            obj_terms = obj.nTerms();
-            obj_max_val = obj.maxVal();
-            obj_min_val = obj.minVal();
-            obj_coeffs = obj.coeffs;
-            if (static_cast<unsigned>(obj.maxVar()) > n_vars) n_vars = obj.maxVar();
-            in.skipWhitespace();
-            if (*in == ';') in.skip();
-        } else {
-            n_constraints++;
-            
-            Constr constr(in);
-            if (static_cast<unsigned>(constr.maxVar()) > n_vars) n_vars = constr.maxVar();
-            auto a = constr.analyse();
-            if (a.unsat) {
-                trivially_unsat = true;
-            }
-            if (a.assignment) {
-                n_assignments++;
+            terms.reset(in, constr);
+            obj_terms = terms.coeffs.size();
+            obj_max_val = terms.max;
+            obj_min_val = terms.min;
+            obj_coeffs = terms.coeffs;
+            if (terms.max_var > n_vars) n_vars = terms.max_var;
+            continue;
+        }
+
+        n_constraints++;
+
+        terms.reset(in, constr);
+        if (terms.max_var > n_vars) n_vars = terms.max_var;
+        Constraint::Rel rel = constr.rel;
+        double bound = in.toDouble(constr.bound);
+        if (rel == Constraint::LE) {
+            // sum a_i l_i <= b is equivalent to sum -a_i l_i >= -b
+            for (double& coeff : terms.coeffs) coeff = -coeff;
+            std::swap(terms.min, terms.max);
+            terms.min = -terms.min;
+            terms.max = -terms.max;
+            bound = -bound;
+            rel = Constraint::GE;
+        }
+        auto a = analyse(terms, rel, bound);
+        if (a.unsat) {
+            trivially_unsat = true;
+        }
+        if (a.assignment) {
+            n_assignments++;
+        }
+        if (a.clause) {
+            n_clauses++;
+        } else if (a.card) {
+            switch (rel) {
+                case Constraint::GE:
+                    n_cards_ge++;
+                    break;
+                default:
+                    n_cards_eq++;
             }
-            if (a.clause) {
-                n_clauses++;
-            } else if (a.card) {
-                switch (constr.rel) {
-                    case Constr::GE:
-                        n_cards_ge++;
-                        break;                        
-                    case Constr::EQ:
-                        n_cards_eq++;
-                }
-            } else {
-                switch (constr.rel) {
-                    case Constr::GE:
-                        n_pbs_ge++;
-                        break;
-                    case Constr::EQ:
-                        n_pbs_eq++;
-                }
+        } else {
+            switch (rel) {
+                case Constraint::GE:
+                    n_pbs_ge++;
+                    break;
+                default:
+                    n_pbs_eq++;
             }
         }
     }
-    
+
     load_feature_record();
 }
 
@@ -7,58 +7,10 @@
 
 #include "IExtractor.h"
 
-#include "src/util/StreamBuffer.h"
+#include "src/util/OPBReader.h"
 
 namespace OPB {
 
-class Constr;
-class BaseFeatures;
-
-class TermSum {
-    friend Constr;
-    friend BaseFeatures;
-
-    std::vector<double> coeffs{};
-    double max = 0;
-    double min = 0;
-    double abs_min_coeff = std::numeric_limits<double>::max();
-    Var max_var{0};
-
-  public:
-    TermSum(StreamBuffer &in);
-    
-    inline size_t nTerms();
-    inline double const minVal();
-    inline double const maxVal();
-    inline Var const maxVar();
-    inline double const minCoeff();
-};
-
-class Constr {
-    friend BaseFeatures;
-    
-  public:
-    enum Rel { GE, EQ };
-    struct Analysis {
-        bool tautology : 1;
-        bool unsat : 1;
-        bool assignment : 1;
-        bool clause : 1;
-        bool card : 1;
-    };
-
-  private:
-    TermSum terms;
-    Rel rel;
-    std::string strbound;
-    double bound;
-
-  public:
-    Constr(StreamBuffer &in);
-    inline Analysis analyse();
-    inline Var maxVar();
-};
-
 class BaseFeatures : public IExtractor {
     const char* filename_;
     std::vector<double> features;
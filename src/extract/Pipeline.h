@@ -0,0 +1,92 @@
+/**
+ * MIT License
+ * Copyright (c) 2024 Markus Iser 
+ */
+
+#pragma once
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/extract/IExtractor.h"
+#include "src/util/BinaryCNF.h"
+#include "src/util/Profile.h"
+#include "src/util/SolverTypes.h"
+#include "src/util/StateFile.h"
+
+namespace CNF {
+
+/**
+ * @brief Extractor composed of feature groups at compile time
+ * A feature group is a small class with
+ * - constructor Group(const char* filename),
+ * - void consume(const Cl& clause), called for each clause of a single parse,
+ * - void finalize(std::vector<double>& features), appends its features,
+ * - static void names(std::vector<std::string>& names), appends its feature names,
+ * - optionally save(StateFile::Writer&) const and load(StateFile::Reader&) of its accumulators, required by Pipeline::save() and load().
+ * The per-clause loop calls consume() of all groups directly, such that it can be inlined.
+ * Callers only pay for the groups they select, e.g., Pipeline<Group::Counts, Group::ClauseSizes>.
+ */
+template <typename... Groups>
+class Pipeline : public IExtractor {
+ protected:
+    const char* filename_;
+    std::tuple<Groups...> groups_;
+    std::vector<double> features;
+
+ public:
+    explicit Pipeline(const char* filename) : filename_(filename), groups_(Groups(filename)...), features() { }
+    virtual ~Pipeline() { }
+
+    virtual void extract() {
+        {
+            Profile::Scope scope("extract");
+            ClauseReader in(filename_);
+            Cl clause;
+            uint64_t n_clauses = 0;
+            while (in.readClause(clause)) {
+                consume(clause);
+                ++n_clauses;
+            }
+            Profile::count("clauses", n_clauses);
+        }
+        finalize();
+    }
+
+    // streaming interface, extract() is consume() for each clause followed by finalize()
+    inline void consume(const Cl& clause) {
+        std::apply([&clause] (Groups&... group) { (group.consume(clause), ...); }, groups_);
+    }
+
+    void finalize() {
+        Profile::Scope scope("summarize");
+        std::apply([this] (Groups&... group) { (group.finalize(features), ...); }, groups_);
+    }
+
+    // accumulators of all groups, such that consume() can be continued later (e.g., in another process)
+    void save(StateFile::Writer& out) const {
+        std::apply([&out] (const Groups&... group) { (group.save(out), ...); }, groups_);
+    }
+
+    void load(StateFile::Reader& in) {
+        std::apply([&in] (Groups&... group) { (group.load(in), ...); }, groups_);
+    }
+
+    template <typename Group>
+    Group& get() {
+        return std::get<Group>(groups_);
+    }
+
+    virtual std::vector<double> getFeatures() const {
+        return features;
+    }
+
+    virtual std::vector<std::string> getNames() const {
+        std::vector<std::string> names;
+        (Groups::names(names), ...);
+        return names;
+    }
+};
+
+}; // namespace CNF
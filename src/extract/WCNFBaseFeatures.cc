@@ -8,6 +8,9 @@
 #include <cassert>
 #include <algorithm>
 
+#include "src/util/Profile.h"
+#include "src/extract/CNFBaseFeatures.h"
+
 WCNF::BaseFeatures1::BaseFeatures1(const char* filename) : filename_(filename), features(), names() { 
     hard_clause_sizes.fill(0);
     soft_clause_sizes.fill(0);
@@ -25,104 +28,74 @@ WCNF::BaseFeatures1::BaseFeatures1(const char* filename) : filename_(filename),
 
 WCNF::BaseFeatures1::~BaseFeatures1() { }
 
-void WCNF::BaseFeatures1::extract() {
-    StreamBuffer in(filename_);
+// header claims beyond this are not trusted for pre-sizing, vectors grow geometrically instead
+static constexpr uint64_t max_presized_vars = 1UL << 26;
 
+/**
+ * @brief single pass over both WCNF formats, reuses one clause buffer
+ * @param header called with number of variables and clauses of an old format problem line
+ * @param consume called with clause, weight, top (zero in new format) and whether it is an 'h' clause (weight zero)
+ */
+template <typename Header, typename Consumer>
+static void parse_wcnf(const char* filename, Header&& header, Consumer&& consume) {
+    StreamBuffer in(filename);
     Cl clause;
-    uint64_t top = 0; // if top is 0, parsing new file format
-    uint64_t weight = 0; // if weight is 0, parsing hard clause
+    uint64_t top = 0;  // if top is 0, parsing new file format
+    uint64_t weight = 0;
     while (in.skipWhitespace()) {
+        bool hard = false;
         if (*in == 'c') {
             if (!in.skipLine()) break;
             continue;
         } else if (*in == 'p') {
             // old format: extract top
+            uint64_t vars = 0, clauses = 0;
             in.skip();
             in.skipWhitespace();
             in.skipString("wcnf");
-            // skip vars
-            in.skipNumber();
-            // skip clauses
-            in.skipNumber();
-            // extract top
+            in.readUInt64(&vars);
+            in.readUInt64(&clauses);
             in.readUInt64(&top);
             in.skipLine();
+            header(vars, clauses);
             continue;
         } else if (*in == 'h') {
             assert(top == 0);
-            weight = 0;
-            
             in.skip();
-            in.readClause(clause);
+            weight = 0;
+            hard = true;
         } else {
             in.readUInt64(&weight);
-            if (top > 0 && weight >= top) {
-                // old hard clause
-                weight = 0;
-            }
-            in.readClause(clause);
-        }
-        
-        for (Lit lit : clause) {
-            if (static_cast<unsigned>(lit.var()) > n_vars) {
-                n_vars = lit.var();
-                variable_horn.resize(n_vars + 1);
-                variable_inv_horn.resize(n_vars + 1);
-                literal_occurrences.resize(2 * n_vars + 2);
-            }
         }
+        in.readClause(clause);
+        consume(clause, weight, top, hard);
+    }
+}
 
-        // record statistics
-        if (!weight) {
-            ++n_hard_clauses;
-            
-            if (clause.size() < 10) {
-                ++hard_clause_sizes[clause.size()];
-            } else {
-                ++hard_clause_sizes[10];
-            }
-
-            unsigned n_neg = 0;
-            for (Lit lit : clause) {
-                // count negative literals
-                if (lit.sign()) ++n_neg;
-                ++literal_occurrences[lit];
-            }
-
-            // horn statistics
-            unsigned n_pos = clause.size() - n_neg;
-            if (n_neg <= 1) {
-                if (n_neg == 0) ++positive;
-                ++horn;
-                for (Lit lit : clause) {
-                    ++variable_horn[lit.var()];
-                }
-            }
-            if (n_pos <= 1) {
-                if (n_pos == 0) ++negative;
-                ++inv_horn;
-                for (Lit lit : clause) {
-                    ++variable_inv_horn[lit.var()];
-                }
-            }
-
-            // balance of positive and negative literals per clause
-            if (clause.size() > 0) {
-                balance_clause.push_back((double)std::min(n_pos, n_neg) / (double)std::max(n_pos, n_neg));
-            }
-        } else {
-            ++n_soft_clauses;
-            weight_sum += weight;
-
-            if (clause.size() < 10) {
-                ++soft_clause_sizes[clause.size()];
-            } else {
-                ++soft_clause_sizes[10];
-            }
+// grows vectors to at least size n, at least doubling
+template <typename... Vectors>
+static void grow(size_t n, Vectors&... vectors) {
+    ((vectors.size() < n ? vectors.resize(std::max(n, 2 * vectors.size())) : void()), ...);
+}
 
-            weights.push_back(weight);
+void WCNF::BaseFeatures1::extract() {
+    Profile::Scope scope("extract");
+    auto header = [this] (uint64_t vars, uint64_t) {
+        const size_t n = std::min(vars, max_presized_vars) + 1;
+        grow(n, variable_horn, variable_inv_horn);
+        grow(2 * n, literal_occurrences);
+    };
+    parse_wcnf(filename_, header, [this] (const Cl& clause, uint64_t weight, uint64_t top, bool) {
+        if (top > 0 && weight >= top) {
+            // old hard clause
+            weight = 0;
         }
-    }
+        consume(clause, weight);
+    });
+    // exact sizes, distributions range over all variables
+    variable_horn.resize(n_vars + 1);
+    variable_inv_horn.resize(n_vars + 1);
+    literal_occurrences.resize(2 * n_vars + 2);
 
     // balance of positive and negative literals per variable
     for (unsigned v = 0; v < n_vars; v++) {
@@ -136,6 +109,67 @@ void WCNF::BaseFeatures1::extract() {
     load_feature_record();
 }
 
+void WCNF::BaseFeatures1::consume(const Cl& clause, uint64_t weight) {
+    for (Lit lit : clause) {
+        if (static_cast<unsigned>(lit.var()) > n_vars) {
+            n_vars = lit.var();
+            grow(n_vars + 1, variable_horn, variable_inv_horn);
+            grow(2 * n_vars + 2, literal_occurrences);
+        }
+    }
+
+    // record statistics
+    if (!weight) {
+        ++n_hard_clauses;
+
+        if (clause.size() < 10) {
+            ++hard_clause_sizes[clause.size()];
+        } else {
+            ++hard_clause_sizes[10];
+        }
+
+        unsigned n_neg = 0;
+        for (Lit lit : clause) {
+            // count negative literals
+            if (lit.sign()) ++n_neg;
+            ++literal_occurrences[lit];
+        }
+
+        // horn statistics
+        unsigned n_pos = clause.size() - n_neg;
+        if (n_neg <= 1) {
+            if (n_neg == 0) ++positive;
+            ++horn;
+            for (Lit lit : clause) {
+                ++variable_horn[lit.var()];
+            }
+        }
+        if (n_pos <= 1) {
+            if (n_pos == 0) ++negative;
+            ++inv_horn;
+            for (Lit lit : clause) {
+                ++variable_inv_horn[lit.var()];
+            }
+        }
+
+        // balance of positive and negative literals per clause
+        if (clause.size() > 0) {
+            balance_clause.add((double)std::min(n_pos, n_neg) / (double)std::max(n_pos, n_neg));
+        }
+    } else {
+        ++n_soft_clauses;
+        weight_sum += weight;
+
+        if (clause.size() < 10) {
+            ++soft_clause_sizes[clause.size()];
+        } else {
+            ++soft_clause_sizes[10];
+        }
+
+        weights.push_back(weight);
+    }
+}
+
 void WCNF::BaseFeatures1::load_feature_record() {
     features.insert(features.end(), { (double)n_hard_clauses, (double)n_vars });
     for (unsigned i = 1; i < 11; ++i) {
@@ -144,7 +178,7 @@ void WCNF::BaseFeatures1::load_feature_record() {
     features.insert(features.end(), { (double)horn, (double)inv_horn, (double)positive, (double)negative });
     push_distribution(features, variable_horn);
     push_distribution(features, variable_inv_horn);
-    push_distribution(features, balance_clause);
+    push_histogram(features, balance_clause);
     push_distribution(features, balance_variable);
     features.insert(features.end(), { (double)n_soft_clauses, (double)weight_sum });
     for (unsigned i = 1; i < 11; ++i) {
@@ -171,47 +205,22 @@ WCNF::BaseFeatures2::BaseFeatures2(const char* filename) : filename_(filename),
 WCNF::BaseFeatures2::~BaseFeatures2() { }
 
 void WCNF::BaseFeatures2::extract() {
-    StreamBuffer in(filename_);
-
-    Cl clause;
-    uint64_t top = 0; // if top is 0, parsing new file format
-    uint64_t weight;
-    while (in.skipWhitespace()) {
-        if (*in == 'c') {
-            if (!in.skipLine()) break;
-            continue;
-        } else if (*in == 'p') {
-            // old format: extract top
-            in.skip();
-            in.skipWhitespace();
-            in.skipString("wcnf");
-            // skip vars
-            in.skipNumber();
-            // skip clauses
-            in.skipNumber();
-            // extract top
-            in.readUInt64(&top);
-            in.skipLine();
-            continue;
-        } else if (*in == 'h') {
-            assert(top == 0);
-            in.skip();
-            in.readClause(clause);
-            weight = 0;
-        } else {
-            in.readUInt64(&weight);
-            in.readClause(clause);
-            // don't skip soft clause here since we need the true variable count
-        }
-        
-        vcg_cdegree.push_back(clause.size());
+    Profile::Scope scope("extract");
+    auto header = [this] (uint64_t vars, uint64_t) {
+        grow(std::min(vars, max_presized_vars) + 1, vcg_vdegree, vg_degree);
+    };
+    // variables of hard clauses for the clause degree pass, read a second time if too large
+    std::vector<unsigned> clause_vars;
+    std::vector<unsigned> clause_sizes;
+    bool stored = true;
+    parse_wcnf(filename_, header, [&, this] (const Cl& clause, uint64_t weight, uint64_t top, bool hard) {
+        vcg_cdegree.add(clause.size());
 
         for (Lit lit : clause) {
             // resize vectors if necessary
             if (static_cast<unsigned>(lit.var()) > n_vars) {
                 n_vars = lit.var();
-                vcg_vdegree.resize(n_vars + 1);
-                vg_degree.resize(n_vars + 1);
+                grow(n_vars + 1, vcg_vdegree, vg_degree);
             }
 
             // count variable occurrences (only for hard clauses)
@@ -220,30 +229,43 @@ void WCNF::BaseFeatures2::extract() {
                 vg_degree[lit.var()] += clause.size();
             }
         }
-    }
 
-    // clause graph features
-    StreamBuffer in2(filename_);
-    while (in2.skipWhitespace()) {
-        if (*in2 == 'c' || *in2 == 'p') {
-            if (!in2.skipLine()) break;
-            continue;
-        } else if (*in2 == 'h') {
-            assert(top == 0);
-            in2.skip();
-            in2.readClause(clause);
-        } else {
-            in2.readUInt64(&weight);
-            in2.readClause(clause);
-            // skip soft clauses
-            if (!top || weight < top) continue;
+        // clause graph of hard clauses (skip soft clauses)
+        if (stored && (hard || (top && weight >= top))) {
+            if (clause_vars.size() + clause.size() > CNF::Group::CGDegrees::max_stored_literals) {
+                stored = false;
+                std::vector<unsigned>().swap(clause_vars);
+                std::vector<unsigned>().swap(clause_sizes);
+                return;
+            }
+            for (Lit lit : clause) clause_vars.push_back(lit.var());
+            clause_sizes.push_back(clause.size());
         }
+    });
+    // exact sizes, distributions range over all variables
+    vcg_vdegree.resize(n_vars + 1);
+    vg_degree.resize(n_vars + 1);
 
-        unsigned degree = 0;
-        for (Lit lit : clause) {
-            degree += vcg_vdegree[lit.var()];
+    // clause graph features
+    if (stored) {
+        auto begin = clause_vars.cbegin();
+        for (unsigned size : clause_sizes) {
+            unsigned degree = 0;
+            for (auto it = begin; it != begin + size; ++it) {
+                degree += vcg_vdegree[*it];
+            }
+            clause_degree.add(degree);
+            begin += size;
         }
-        clause_degree.push_back(degree);
+    } else {
+        parse_wcnf(filename_, [] (uint64_t, uint64_t) { }, [this] (const Cl& clause, uint64_t weight, uint64_t top, bool hard) {
+            if (!hard && (!top || weight < top)) return;
+            unsigned degree = 0;
+            for (Lit lit : clause) {
+                degree += vcg_vdegree[lit.var()];
+            }
+            clause_degree.add(degree);
+        });
     }
 
     load_feature_records();
@@ -251,9 +273,9 @@ void WCNF::BaseFeatures2::extract() {
 
 void WCNF::BaseFeatures2::load_feature_records() {
     push_distribution(features, vcg_vdegree);
-    push_distribution(features, vcg_cdegree);
+    push_histogram(features, vcg_cdegree);
     push_distribution(features, vg_degree);
-    push_distribution(features, clause_degree);
+    push_histogram(features, clause_degree);
 }
 
 std::vector<double> WCNF::BaseFeatures2::getFeatures() const {
@@ -29,7 +29,7 @@ class BaseFeatures1 : public IExtractor {
     // occurrence counts in horn clauses (per variable)
     std::vector<unsigned> variable_horn, variable_inv_horn;
     // pos-neg literal balance (per clause)
-    std::vector<double> balance_clause;
+    Histogram<double> balance_clause;
     // pos-neg literal balance (per variable)
     std::vector<double> balance_variable;
     // Literal Occurrences
@@ -38,6 +38,7 @@ class BaseFeatures1 : public IExtractor {
     std::vector<uint64_t> weights;
 
     void load_feature_record();
+    void consume(const Cl& clause, uint64_t weight);
 
   public:
     BaseFeatures1(const char* filename);
@@ -53,12 +54,12 @@ class BaseFeatures2 : public IExtractor {
     std::vector<std::string> names;
     unsigned n_vars = 0;
     // VCG Degree Distribution
-    std::vector<unsigned> vcg_cdegree; // clause sizes
+    Histogram<unsigned> vcg_cdegree; // clause sizes
     std::vector<unsigned> vcg_vdegree; // occurence counts
     // VIG Degree Distribution
     std::vector<unsigned> vg_degree;
     // CG Degree Distribution
-    std::vector<unsigned> clause_degree;
+    Histogram<unsigned> clause_degree;
 
     void load_feature_records();
 
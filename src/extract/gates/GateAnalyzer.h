@@ -23,6 +23,7 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include <cstdlib>
 #include <cstdint>
 #include <algorithm>
+#include <atomic>
 #include <memory>
 #include <cmath>
 #include <vector>
@@ -32,6 +33,8 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "src/external/ipasir.h"
 
 #include "src/util/CNFFormula.h"
+#include "src/util/ResourceBudget.h"
+#include "src/util/Stamp.h"
 
 #include "src/extract/gates/GateFormula.h"
 #include "src/extract/gates/BlockList.h"
@@ -39,7 +42,11 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 
 
 class GateAnalyzer {
+    using Occurrences = OccurrenceList::Occurrences;
+
     void* S;  // solver
+    int activation = 0;  // last activation variable of semantic checks
+    std::vector<bool> semantic_failed;  // output literals whose semantic check failed
 
     const CNFFormula& formula_;
 
@@ -51,6 +58,9 @@ class GateAnalyzer {
     // So use OccurrenceList for now
     OccurrenceList index;  // occurence-list
 
+    // reused membership marks of input variables
+    Stamp<unsigned> fwd_vars, bwd_vars;
+
     // analyzer configuration:
     bool patterns = false;
     bool semantic = false;
@@ -60,8 +70,13 @@ class GateAnalyzer {
  public:
     GateAnalyzer(const CNFFormula& formula, bool patterns_, bool semantic_, unsigned max, unsigned verbose = 0) :
      formula_(formula), gate_formula(formula.nVars(), verbose), index(formula),
+     fwd_vars(1 + formula.nVars()), bwd_vars(1 + formula.nVars()),
      patterns(patterns_), semantic(semantic_), max_(max), verbose_(verbose) {
-        if (semantic) S = ipasir_init();
+        if (semantic) {
+            S = ipasir_init();
+            activation = formula.nVars();
+            semantic_failed.resize(2 + 2 * formula.nVars());
+        }
     }
 
     ~GateAnalyzer() {
@@ -74,13 +89,17 @@ class GateAnalyzer {
 
     /**
      * @brief Starting-point gate analysis: iterative root selection
+     * @param selections root selections of all analyzers of the variable-disjoint parts of one formula,
+     * such that max bounds their sum like in the analysis of the whole formula, nullptr for a single analyzer
+     * @return false if the analysis stopped because the shared budget of root selections is used up
      */
-    void analyze() {
-        std::vector<Cl*> root_clauses = index.estimateRoots();
+    bool analyze(std::atomic<unsigned>* selections = nullptr) {
+        std::vector<const Clause*> root_clauses = index.estimateRoots();
 
         for (unsigned count = 0; count < max_ && !root_clauses.empty(); count++) {
+            if (selections != nullptr && selections->fetch_add(1) >= max_) return false;
             std::vector<Lit> candidates;
-            for (Cl* clause : root_clauses) {
+            for (const Clause* clause : root_clauses) {
                 gate_formula.addRoot(clause);
                 candidates.insert(candidates.end(), clause->begin(), clause->end());
             }
@@ -90,11 +109,15 @@ class GateAnalyzer {
             root_clauses = index.estimateRoots();
         }
 
-        std::unordered_set<Cl*> remainder;
+        ClauseList& remainder = gate_formula.remainder;
+        const size_t first = remainder.size();
         for (size_t lit = 0; lit < index.size(); lit++) {
-            remainder.insert(index[lit].begin(), index[lit].end());
+            const Occurrences occurrences = index[lit];
+            remainder.insert(remainder.end(), occurrences.begin(), occurrences.end());
         }
-        gate_formula.remainder.insert(gate_formula.remainder.end(), remainder.begin(), remainder.end());
+        std::sort(remainder.begin() + first, remainder.end());
+        remainder.erase(std::unique(remainder.begin() + first, remainder.end()), remainder.end());
+        return true;
     }
 
  private:
@@ -106,10 +129,11 @@ class GateAnalyzer {
     void gate_recognition(std::vector<Lit> roots) {
         // std::cerr << "c Starting gate-recognition with roots: " << roots << std::endl;
         std::vector<Lit> candidates { roots.begin(), roots.end() };
-        std::unordered_set<Lit> frontier;
+        std::unordered_set<Lit> frontier;  // iteration order decides which polarity of a gate is recognized
         while (!candidates.empty()) {  // breadth_ first search is important here
             // std::cout << "Number of Candidates: " << candidates.size() << std::endl;
             for (Lit candidate : candidates) {
+                ResourceBudget::check();
                 if (checkAddGate(candidate)) {
                     Gate& gate = gate_formula.getGate(candidate);
                     index.remove(gate.fwd);
@@ -124,9 +148,9 @@ class GateAnalyzer {
         }
     }
 
-    std::vector<Lit> getInputLiterals(Lit output, const For& clauses) {
+    std::vector<Lit> getInputLiterals(Lit output, const Occurrences& clauses) {
         std::vector<Lit> inp;
-        for (Cl* clause : clauses) {
+        for (const Clause* clause : clauses) {
             unsigned pos = 0;  // reset insert position for each clause
             for (auto it = clause->begin(); it != clause->end(); ++it) {
                 if (*it != output) {
@@ -150,21 +174,24 @@ class GateAnalyzer {
         return inp;
     }
 
-    unsigned constrainSameInputVariables(Lit o, const For& fwd, const For& bwd) {
+    unsigned constrainSameInputVariables(Lit o, const Occurrences& fwd, const Occurrences& bwd) {
         // check if fwd and bwd constrain exactly the same inputs, return 0 on failure, otherwise return number of input variables
-        std::unordered_set<Var> fwd_vars;
-        std::unordered_set<Var> bwd_vars;
-        for (Cl* c : fwd) for (Lit l : *c) if (l != ~o) fwd_vars.insert(l.var());
-        for (Cl* c : bwd) for (Lit l : *c) if (l != o) {
-            bool inserted = std::get<1>(bwd_vars.insert(l.var()));
-            if (inserted && !fwd_vars.count(l.var())) {  // ensure: bwd_vars \subseteq fwd_vars
-                return 0;
+        fwd_vars.clear();
+        bwd_vars.clear();
+        unsigned n_fwd = 0, n_bwd = 0;
+        for (const Clause* c : fwd) for (Lit l : *c) if (l != ~o) n_fwd += fwd_vars.insert(l.var());
+        for (const Clause* c : bwd) for (Lit l : *c) if (l != o) {
+            if (bwd_vars.insert(l.var())) {
+                ++n_bwd;
+                if (!fwd_vars[l.var()]) {  // ensure: bwd_vars \subseteq fwd_vars
+                    return 0;
+                }
             }
         }
-        if (fwd_vars.size() > bwd_vars.size()) {  // ensure: fwd_vars \subseteq bwd_vars
+        if (n_fwd > n_bwd) {  // ensure: fwd_vars \subseteq bwd_vars
             return 0;
         }
-        return fwd_vars.size();
+        return n_fwd;
     }
 
     /**
@@ -187,12 +214,16 @@ class GateAnalyzer {
 
             if (type == NONE && semantic) {
                 if (index[~out].size() > 1 && index[out].size() > 1) {  // case excluded by patterns
-                    type = fSemantic(out, index[~out], index[out]);
+                    if (!fTruthTable(out, index[~out], index[out], &type)) {
+                        type = fSemantic(out, index[~out], index[out]);
+                    }
                 }
             }
 
             if (type != NONE) {
-                gate_formula.addGate(type, out, index[~out], index[out], getInputLiterals(~out, index[~out]));
+                const Occurrences fwd = index[~out];
+                const Occurrences bwd = index[out];
+                gate_formula.addGate(type, out, ClauseList(fwd.begin(), fwd.end()), ClauseList(bwd.begin(), bwd.end()), getInputLiterals(~out, fwd));
                 return true;
             }
         }
@@ -202,7 +233,7 @@ class GateAnalyzer {
     // clause patterns of full encoding
     // precondition: fwd blocks bwd on output literal o
     // fwd and bwd constrain same input variables
-    GateType fPattern(Lit o, const For& fwd, const For& bwd, unsigned input_size) {
+    GateType fPattern(Lit o, const Occurrences& fwd, const Occurrences& bwd, unsigned input_size) {
         // detect or gates
         if (fwd.size() == 1 && fixedClauseSize(bwd, 2)) {
             if (input_size == 1) return TRIV;
@@ -224,30 +255,68 @@ class GateAnalyzer {
         return NONE;
     }
 
-    GateType fSemantic(Lit o, const For& fwd, const For& bwd) {
-        // std::cout << "Semantic check for " << fwd.size() + bwd.size() << " clauses" << std::endl;
-        // std::cout << fwd << std::endl;
-        // std::cout << bwd << std::endl;
-        for (const For& f : { fwd, bwd }) {
-            for (Cl* cl : f) {
+    /**
+     * @brief same result as fSemantic() for at most 6 input variables, evaluated on a 64-bit truth table
+     * Bit k of a mask stands for the input assignment in which the i-th input variable is true iff bit i of k is set.
+     * @return false if there are too many input variables to decide
+     */
+    bool fTruthTable(Lit o, const Occurrences& fwd, const Occurrences& bwd, GateType* type) {
+        static constexpr std::uint64_t var_true[6] = {
+            0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+            0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull
+        };
+        Var inputs[6];
+        unsigned n_inputs = 0;
+        std::uint64_t falsified = 0;  // assignments which falsify at least one clause
+        for (const Occurrences& f : { fwd, bwd }) {
+            for (const Clause* cl : f) {
+                std::uint64_t mask = ~0ull;
                 for (Lit lit : *cl) {
-                    if (lit.var() != o.var()) {
-                        ipasir_add(S, lit.toDimacs());
-                    } else {
-                        ipasir_add(S, lit.positive().toDimacs());
+                    if (lit.var() == o.var()) continue;
+                    unsigned i = 0;
+                    while (i < n_inputs && inputs[i] != lit.var()) ++i;
+                    if (i == n_inputs) {
+                        if (n_inputs == 6) return false;
+                        inputs[n_inputs++] = lit.var();
                     }
+                    mask &= lit.sign() ? var_true[i] : ~var_true[i];
+                }
+                falsified |= mask;
+            }
+        }
+        const std::uint64_t all = n_inputs == 6 ? ~0ull : (1ull << (1u << n_inputs)) - 1;
+        *type = (falsified & all) == all ? GENERIC : NONE;
+        return true;
+    }
+
+    /**
+     * @brief checks if fwd and bwd are left-total on their inputs, i.e. unsatisfiable without the output literals
+     * Clauses of each candidate are guarded by a fresh activation variable a and solved under assumption ~a,
+     * afterwards the unit a permanently satisfies them such that the solver can drop them.
+     * Removing clauses preserves satisfiability, so a failed check is not repeated for the same output.
+     */
+    GateType fSemantic(Lit o, const Occurrences& fwd, const Occurrences& bwd) {
+        if (semantic_failed[o]) return NONE;
+        const int a = ++activation;
+        for (const Occurrences& f : { fwd, bwd }) {
+            for (const Clause* cl : f) {
+                for (Lit lit : *cl) {
+                    if (lit.var() != o.var()) ipasir_add(S, lit.toDimacs());
                 }
+                ipasir_add(S, a);
                 ipasir_add(S, 0);
             }
         }
-        ipasir_assume(S, o.negative().toDimacs());
+        ipasir_assume(S, -a);
         int result = ipasir_solve(S);
-        ipasir_add(S, o.positive().toDimacs());
+        ipasir_add(S, a);
+        ipasir_add(S, 0);
+        if (result != 20) semantic_failed[o] = true;
         return result == 20 ? GENERIC : NONE;
     }
 
-    bool fixedClauseSize(const For& f, unsigned int n) {
-        for (Cl* c : f) if (c->size() != n) return false;
+    bool fixedClauseSize(const Occurrences& f, unsigned int n) {
+        for (const Clause* c : f) if (c->size() != n) return false;
         return true;
     }
 };
@@ -23,6 +23,7 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include <cstdlib>
 #include <algorithm>
 #include <vector>
+#include <memory>
 #include <set>
 
 #include "src/util/CNFFormula.h"
@@ -44,7 +45,7 @@ enum GateType {
 struct Gate {
     GateType type = NONE;
     Lit out = lit_Undef;
-    For fwd, bwd;
+    ClauseList fwd, bwd;
     bool notMono = false;
     std::vector<Lit> inp;
 
@@ -55,12 +56,13 @@ struct Gate {
 
 class GateFormula {
  public:
-    std::vector<Cl*> roots;  // top-level clauses
+    std::vector<const Clause*> roots;  // top-level clauses
     std::vector<char> inputs;  // mark literals which are used as input to a gate (used in detection of monotonicity)
     std::vector<char> direct;  // non-transitive version of inputs
     std::vector<Gate> gates;  // stores gate-struct for every output
-    For remainder;  // stores clauses remaining outside of recognized gate-structure
+    ClauseList remainder;  // stores clauses remaining outside of recognized gate-structure
     bool artificialRoot;  // top-level unit-clause that can be generated by normalizeRoots()
+    std::shared_ptr<CNFFormula> artificial;  // storage of clauses generated by normalizeRoots(), shared by copies
     unsigned verbose_;
 
     explicit GateFormula(unsigned verbose) :
@@ -74,16 +76,7 @@ class GateFormula {
         gates.resize(2 + nVars);
     }
 
-    ~GateFormula() {
-        if (artificialRoot) {
-            for (Cl* clause : getGate(getRoot()).fwd) {
-                delete clause;
-            }
-            delete *roots.begin();
-        }
-    }
-
-    void addRoot(Cl* clause) {
+    void addRoot(const Clause* clause) {
         roots.push_back(clause);
         for (Lit l : *clause) inputs[l] = true;
     }
@@ -92,7 +85,7 @@ class GateFormula {
         return !inputs[lit] || !inputs[~lit];
     }
 
-    void addGate(GateType type, Lit o, For fwd, For bwd, std::vector<Lit> inp) {
+    void addGate(GateType type, Lit o, ClauseList fwd, ClauseList bwd, std::vector<Lit> inp) {
         Gate& gate = gates[o.var()];
         gate.type = type;
         gate.out = o;
@@ -110,13 +103,28 @@ class GateFormula {
         if (verbose_) {
             unsigned otype = gate.type == MONO ? 10 : gate.type == GENERIC ? 0 : gate.type == TRIV ? 1 : gate.type == AND ? 2 : gate.type == OR ? 3 : 4;
             std::cout << "GateType " << otype << " OutLit " << gate.out << std::endl;
-            for (Cl* cl : gate.fwd) std::cout << *cl << "0 ";
+            for (const Clause* cl : gate.fwd) std::cout << *cl << "0 ";
             std::cout << std::endl;
-            for (Cl* cl : gate.bwd) std::cout << *cl << "0 ";
+            for (const Clause* cl : gate.bwd) std::cout << *cl << "0 ";
             std::cout << std::endl << "endG" << std::endl;
         }
     }
 
+    /**
+     * @brief moves gates, roots and remainder of the analysis of a variable-disjoint part into this formula
+     */
+    void merge(GateFormula& part) {
+        roots.insert(roots.end(), part.roots.begin(), part.roots.end());
+        remainder.insert(remainder.end(), part.remainder.begin(), part.remainder.end());
+        for (size_t lit = 0; lit < std::min(inputs.size(), part.inputs.size()); ++lit) {
+            inputs[lit] |= part.inputs[lit];
+            direct[lit] |= part.direct[lit];
+        }
+        for (size_t var = 0; var < std::min(gates.size(), part.gates.size()); ++var) {
+            if (part.gates[var].isDefined()) std::swap(gates[var], part.gates[var]);
+        }
+    }
+
     Gate& getGate(Lit output) {
         return gates[output.var()];
     }
@@ -166,7 +174,7 @@ class GateFormula {
     template <template <typename> typename Alloc = std::allocator>
     std::vector<Lit, Alloc<Lit>> getRoots() {
         std::vector<Lit, Alloc<Lit>> result;
-        for (Cl* root : roots) {
+        for (const Clause* root : roots) {
             result.insert(result.end(), root->begin(), root->end());
         }
         return result;
@@ -190,14 +198,16 @@ class GateFormula {
         std::set<Lit> inp;
         roots.insert(roots.end(), remainder.begin(), remainder.end());
         remainder.clear();
-        for (Cl* c : roots) {
+        artificial = std::make_shared<CNFFormula>();
+        for (const Clause* c : roots) {
             inp.insert(c->begin(), c->end());
-            c->push_back(Lit(root, true));
-            gates[root].fwd.push_back(new Cl(*c));
+            Cl clause(c->begin(), c->end());
+            clause.push_back(Lit(root, true));
+            gates[root].fwd.push_back(artificial->readClause(clause.begin(), clause.end()));
         }
         gates[root].inp.insert(gates[root].inp.end(), inp.begin(), inp.end());
         roots.clear();
-        roots.push_back(new Cl({gates[root].out}));
+        roots.push_back(artificial->readClause({gates[root].out}));
         artificialRoot = true;
     }
 
@@ -206,11 +216,11 @@ class GateFormula {
      * @param model
      * @return clauses of all satisfied branches
      */
-    For getPrunedProblem(const std::vector<uint8_t>& model) {
-        For result(roots.begin(), roots.end());
+    ClauseList getPrunedProblem(const std::vector<uint8_t>& model) {
+        ClauseList result(roots.begin(), roots.end());
 
         std::vector<Lit> literals;
-        for (const Cl* c : roots) {
+        for (const Clause* c : roots) {
             literals.insert(literals.end(), c->begin(), c->end());
         }
         std::sort(literals.begin(), literals.end());
@@ -24,76 +24,193 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include <set>
 #include <limits>
 #include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
 
 #include "src/util/CNFFormula.h"
 
+/**
+ * @brief Occurrence index in compressed sparse row layout:
+ * occurrences of literal l are stored in entries[begin[l], begin[l] + length[l]) in original clause order,
+ * together with the clause numbers (position in formula) which are used to locate clauses in long segments by binary search.
+ * Removed clauses leave tombstones (nullptr) which are skipped on iteration and compacted (stable) lazily.
+ */
 class OccurrenceList {
     const CNFFormula& problem;
 
-    std::vector<For> index;
-    std::vector<Cl*> unitc;
+    std::vector<const Clause*> entries;
+    std::vector<unsigned> numbers;  // clause number of each entry, ascending in each segment
+    std::vector<unsigned> begin;
+    std::vector<unsigned> length;  // segment length including tombstones
+    std::vector<unsigned> live;    // number of clauses in segment
+
+    // open addressing hash map from clause to clause number
+    std::vector<std::pair<const Clause*, unsigned>> slots;
+    size_t slot_mask;
+
+    std::vector<const Clause*> unitc;
     Lit max_literal;
 
+    inline size_t findSlot(const Clause* clause) const {
+        size_t slot = static_cast<size_t>((reinterpret_cast<uintptr_t>(clause) >> 4) * 0x9E3779B97F4A7C15ull) & slot_mask;
+        while (slots[slot].first != nullptr && slots[slot].first != clause) {
+            slot = (slot + 1) & slot_mask;
+        }
+        return slot;
+    }
+
+    // remove tombstones from segment of literal o, preserving order
+    void compact(size_t o) {
+        unsigned j = begin[o];
+        for (unsigned i = begin[o]; i < begin[o] + length[o]; ++i) {
+            if (entries[i] != nullptr) {
+                entries[j] = entries[i];
+                numbers[j] = numbers[i];
+                ++j;
+            }
+        }
+        length[o] = live[o];
+    }
+
 #define CLAUSES_ARE_SORTED
 #ifdef CLAUSES_ARE_SORTED
-    bool isBlocked(Lit o, const Cl& c1, const Cl& c2) const {  // assert o \in c1 and ~o \in c2
+    bool isBlocked(Lit o, const Clause& c1, const Clause& c2) const {  // assert o \in c1 and ~o \in c2
         for (unsigned i = 0, j = 0; i < c1.size() && j < c2.size(); c1[i] < c2[j] ? ++i : ++j) {
             if (c1[i] != o && c1[i] == ~c2[j]) return true;
         }
         return false;
     }
 #else
-    bool isBlocked(Lit o, const Cl& c1, const Cl& c2) const {  // assert o \in c1 and ~o \in c2
+    bool isBlocked(Lit o, const Clause& c1, const Clause& c2) const {  // assert o \in c1 and ~o \in c2
         for (Lit l1 : c1) if (l1 != o) for (Lit l2 : c2) if (l1 == ~l2) return true;
         return false;
     }
 #endif
 
  public:
-    explicit OccurrenceList(const CNFFormula& problem_) : problem(problem_), unitc(), max_literal(problem.nVars(), true) {
-        index.resize(2 + 2 * problem.nVars());
+    /**
+     * @brief view of the clauses containing a literal, skips tombstones, valid until the next call to remove()
+     */
+    struct Occurrences {
+        struct Iterator {
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = const Clause*;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const Clause* const*;
+            using reference = const Clause* const&;
+
+            const Clause* const* pos;
+            const Clause* const* end;
+            inline Iterator& operator++ () {
+                do ++pos; while (pos != end && *pos == nullptr);
+                return *this;
+            }
+            inline const Clause* const& operator* () const { return *pos; }
+            inline bool operator== (const Iterator& o) const { return pos == o.pos; }
+            inline bool operator!= (const Iterator& o) const { return pos != o.pos; }
+        };
+
+        const Clause* const* first;
+        const Clause* const* last;
+        size_t count;
+
+        inline Iterator begin() const {
+            const Clause* const* pos = first;
+            while (pos != last && *pos == nullptr) ++pos;
+            return Iterator { pos, last };
+        }
+        inline Iterator end() const { return Iterator { last, last }; }
+        inline size_t size() const { return count; }
+        inline bool empty() const { return count == 0; }
+    };
 
-        for (Cl* clause : problem_) {
+    explicit OccurrenceList(const CNFFormula& problem_) : problem(problem_), unitc(), max_literal(problem.nVars(), true) {
+        const size_t n_literals = 2 + 2 * problem.nVars();
+        begin.resize(n_literals + 1);
+        length.resize(n_literals);
+        live.resize(n_literals);
+
+        size_t n_slots = 2;
+        while (n_slots < 2 * problem.nClauses()) n_slots *= 2;
+        slots.resize(n_slots, { nullptr, 0 });
+        slot_mask = n_slots - 1;
+
+        unsigned number = 0;
+        for (const Clause* clause : problem_) {
             if (clause->size() == 1) {
                 unitc.push_back(clause);
             } else {
+                slots[findSlot(clause)] = { clause, number++ };
                 for (Lit lit : *clause) {
-                    index[lit].push_back(clause);
+                    ++length[lit];
                 }
             }
         }
+        for (size_t lit = 0; lit < n_literals; ++lit) {
+            begin[lit + 1] = begin[lit] + length[lit];
+        }
+        entries.resize(begin[n_literals]);
+        numbers.resize(begin[n_literals]);
+
+        number = 0;
+        for (const Clause* clause : problem_) {
+            if (clause->size() == 1) continue;
+            for (Lit lit : *clause) {
+                const unsigned pos = begin[lit] + live[lit]++;
+                entries[pos] = clause;
+                numbers[pos] = number;
+            }
+            ++number;
+        }
     }
 
     ~OccurrenceList() { }
 
-    void remove(const For& list) {
-        for (Cl* clause : list) for (Lit lit : *clause) {
-            if (!index[lit].empty()) {
-                // assert(std::find(index[lit].begin(), index[lit].end(), clause) != index[lit].end());
-                auto it = index[lit].begin();
-                while (*it != clause && it != index[lit].end()) {
-                    ++it;
+    template <typename Clauses>
+    void remove(const Clauses& list) {
+        constexpr unsigned linear_search_limit = 32;
+        constexpr unsigned unknown = std::numeric_limits<unsigned>::max();
+        for (const Clause* clause : list) {
+            unsigned number = unknown;
+            for (Lit lit : *clause) {
+                const Clause** first = entries.data() + begin[lit];
+                const Clause** last = first + length[lit];
+                const Clause** it;
+                if (length[lit] <= linear_search_limit) {
+                    it = std::find(first, last, clause);
+                } else {
+                    if (number == unknown) {
+                        const auto& slot = slots[findSlot(clause)];
+                        if (slot.first == nullptr) break;  // unit clauses are not indexed
+                        number = slot.second;
+                    }
+                    auto nfirst = numbers.begin() + begin[lit];
+                    auto nit = std::lower_bound(nfirst, nfirst + length[lit], number);
+                    it = (nit != nfirst + length[lit] && *nit == number && first[nit - nfirst] == clause) ? first + (nit - nfirst) : last;
                 }
-                while (it+1 < index[lit].end()) {
-                    *it = *(it+1);
-                    ++it;
+                if (it != last) {
+                    *it = nullptr;
+                    --live[lit];
                 }
-                index[lit].erase(index[lit].end()-1, index[lit].end());
             }
         }
     }
 
-    inline const For& operator[] (size_t o) const {
-        return index[o];
+    inline Occurrences operator[] (size_t o) {
+        if (length[o] > 2 * live[o]) compact(o);
+        const Clause* const* first = entries.data() + begin[o];
+        return Occurrences { first, first + length[o], live[o] };
     }
 
     inline size_t size() const {
-        return index.size();
+        return length.size();
     }
 
     inline bool isBlockedSet(Lit o) {
-        for (Cl* c1 : index[o]) {
-            for (Cl* c2 : index[~o]) {
+        const Occurrences neg = (*this)[~o];
+        for (const Clause* c1 : (*this)[o]) {
+            for (const Clause* c2 : neg) {
                 if (!isBlocked(o, *c1, *c2)) {
                     return false;
                 }
@@ -102,17 +219,18 @@ class OccurrenceList {
         return true;
     }
 
-    For estimateRoots() {
-        For result {};
+    ClauseList estimateRoots() {
+        ClauseList result {};
 
         if (unitc.size() > 0) {
             std::swap(result, unitc);
         } else {
-            while (max_literal > 0 && index[max_literal].size() == 0) {
+            while (max_literal > 0 && live[max_literal] == 0) {
                 --max_literal;
             }
             if (max_literal > 0) {
-                result.swap(index[max_literal]);
+                const Occurrences roots = (*this)[max_literal];
+                result.assign(roots.begin(), roots.end());
                 remove(result);
             }
         }
@@ -21,19 +21,23 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include <cstdint>
 #include <string>
 #include <chrono>
-#include <regex>
 #include <fstream>
 #include <memory>
 #include <sstream>
 #include <future>
 #include <unordered_map>
 #include <variant>
+#include <limits>
+#include <algorithm>
 
 #include "src/identify/GBDHash.h"
 #include "src/identify/ISOHash.h"
 #include "src/identify/ISOHash2.h"
+#include "src/identify/Analyze.h"
+#include "src/identify/Incremental.h"
 
 #include "src/extract/CNFBaseFeatures.h"
+#include "src/extract/CNFApproxFeatures.h"
 #include "src/extract/CNFGateFeatures.h"
 #include "src/extract/WCNFBaseFeatures.h"
 #include "src/extract/OPBBaseFeatures.h"
@@ -41,6 +45,12 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "src/transform/IndependentSet.h"
 #include "src/transform/Normalize.h"
 #include "src/util/ResourceLimits.h"
+#include "src/util/ResourceBudget.h"
+#include "src/util/StreamBuffer.h"
+#include "src/util/StreamCompressor.h"
+#include "src/util/ResultCache.h"
+#include "src/util/Batch.h"
+#include "src/util/Profile.h"
 
 // #include "src/util/pybind11/include/pybind11/pybind11.h"
 // #include "src/util/pybind11/include/pybind11/stl.h"
@@ -48,73 +58,368 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "pybind11/pybind11.h"
 #include "pybind11/stl.h"
 #include "pybind11/functional.h"
+#include "pybind11/numpy.h"
 
 namespace py = pybind11;
 
+#ifndef GBDC_VERSION
+#define GBDC_VERSION "unknown"
+#endif
+
+// version of pyproject.toml at build time
 std::string version() {
-    std::ifstream file("setup.py");
-    if (!file.is_open()) {
-        return "Error: Could not open setup.py";
-    }
+    return GBDC_VERSION;
+}
 
-    std::string line;
-    std::regex version_regex(R"(version\s*=\s*['"]([^'"]+)['"])");
-    std::smatch match;
+/**
+ * @brief feature names followed by the runtime name, computed once per extractor type
+ */
+template <typename Extractor>
+const std::vector<std::string>& feature_names() {
+    static const std::vector<std::string> names = [] () {
+        auto ex = Extractor("");
+        auto names = ex.getNames();
+        names.push_back(ex.getRuntimeDesc());
+        return names;
+    }();
+    return names;
+}
 
-    while (std::getline(file, line)) {
-        if (std::regex_search(line, match, version_regex)) {
-            return match[1].str();
-        }
+py::dict cnf2kis(const std::string filename, const std::string output, const unsigned threads, const bool external) {
+    py::dict dict;
+    std::unique_ptr<IndependentSetFromCNF> gen;
+    std::string hash;
+    {
+        py::gil_scoped_release release;
+        gen = std::make_unique<IndependentSetFromCNF>(filename.c_str(), external);
+        gen->generate_independent_set_problem(output.c_str(), false, threads);
+        hash = CNF::gbdhash(output.c_str());
     }
+    dict[py::str("nodes")] = gen->numNodes();
+    dict[py::str("edges")] = gen->numEdges();
+    dict[py::str("k")] = gen->minK();
+    dict[py::str("local")] = output;
+    dict[py::str("hash")] = hash;
+    return dict;
+}
 
-    return "Error: Version not found in setup.py";
+// persistent result cache, disabled if null, calls keep their own reference while the GIL is released
+static std::shared_ptr<ResultCache> cache;
+
+void set_cache(const std::string directory) {
+    if (directory.empty()) cache.reset();
+    else cache = std::make_shared<ResultCache>(directory);
 }
 
-template <typename Extractor>
-auto feature_names() {
-    auto ex = Extractor("");
-    auto names = ex.getNames();
-    names.push_back(ex.getRuntimeDesc());
-    return names;
+void enable_profile(const bool enabled) {
+    Profile::enable(enabled);
 }
 
-py::dict cnf2kis(const std::string filename, const std::string output) {
+py::dict get_profile() {
     py::dict dict;
+    for (const auto& [name, value] : Profile::report()) {
+        dict[py::str(name)] = value;
+    }
+    return dict;
+}
 
-    IndependentSetFromCNF gen(filename.c_str());
+py::dict record_to_dict(const BatchRecord& record) {
+    py::dict dict;
+    for (const auto& [name, value] : record) {
+        std::visit([&dict, &name] (const auto& v) { dict[py::str(name)] = v; }, value);
+    }
+    return dict;
+}
 
-    dict[py::str("nodes")] = gen.numNodes();
-    dict[py::str("edges")] = gen.numEdges();
-    dict[py::str("k")] = gen.minK();
+std::string cached_hash(const ResultCache* cache, const std::string& filename, const std::string& task, std::string (*hash)(const char*)) {
+    if (!cache) return hash(filename.c_str());
+    const BatchRecord record = cache->get_or_compute(filename, task, [&] () {
+        return BatchRecord { { task, hash(filename.c_str()) } };
+    });
+    return std::get<std::string>(record.front().second);
+}
 
-    gen.generate_independent_set_problem(output.c_str());
-    dict[py::str("local")] = output;
-    dict[py::str("hash")] = CNF::gbdhash(output.c_str());
-    return dict;
+std::string cached_hash(const std::string& filename, const std::string& task, std::string (*hash)(const char*)) {
+    const std::shared_ptr<ResultCache> shared = cache;
+    py::gil_scoped_release release;
+    return cached_hash(shared.get(), filename, task, hash);
 }
 
+/**
+ * @brief extract features of a single file, does not touch python objects
+ * @return record of runtime and features, runtime is "timeout" or "memout" if the budget is exhausted
+ */
 template <typename Extractor>
-py::dict extract_features(const std::string filepath, const size_t rlim, const size_t mlim) {
-    py::dict dict;
+BatchRecord feature_record(const ResultCache* cache, const std::string& filepath, const size_t rlim, const size_t mlim) {
     Extractor stats(filepath.c_str());
-    ResourceLimits limits(rlim, mlim);
-    limits.set_rlimits();
+    BatchRecord record;
+    if (cache && cache->lookup(filepath, stats.getRuntimeDesc(), record)) {
+        return record;
+    }
+    // cooperative per-call budget, such that concurrent calls do not interfere
+    ResourceBudget budget(rlim, mlim);
     try {
-        stats.extract();
-        dict[py::str(stats.getRuntimeDesc())] = (double)limits.get_runtime();
+        {
+            ResourceBudget::Scope scope(budget);
+            stats.extract();
+        }
+        record.emplace_back(stats.getRuntimeDesc(), budget.get_runtime());
         const auto names = stats.getNames();
         const auto features = stats.getFeatures();
         for (size_t i = 0; i < features.size(); ++i) {
-            dict[py::str(names[i])] = features[i];
+            record.emplace_back(names[i], features[i]);
         }
+        if (cache) cache->store(filepath, stats.getRuntimeDesc(), record);
     }
     catch (TimeLimitExceeded &e) {
-        dict[py::str(stats.getRuntimeDesc())] = "timeout";
+        record.assign(1, { stats.getRuntimeDesc(), "timeout" });
     }
     catch (MemoryLimitExceeded &e) {
-        dict[py::str(stats.getRuntimeDesc())] = "memout";
+        record.assign(1, { stats.getRuntimeDesc(), "memout" });
     }
-    return dict;
+    return record;
+}
+
+template <typename Extractor>
+py::dict extract_features(const std::string filepath, const size_t rlim, const size_t mlim) {
+    const std::shared_ptr<ResultCache> shared = cache;
+    BatchRecord record;
+    {
+        py::gil_scoped_release release;
+        record = feature_record<Extractor>(shared.get(), filepath, rlim, mlim);
+    }
+    return record_to_dict(record);
+}
+
+/**
+ * @brief single parse analysis of a file, does not touch python objects
+ * @return record of runtime, hashes and base features, runtime is "timeout" or "memout" if the budget is exhausted
+ */
+BatchRecord analyze_record(const ResultCache* cache, const std::string& filepath, const size_t rlim, const size_t mlim) {
+    BatchRecord record;
+    if (cache && cache->lookup(filepath, "analyze_runtime", record)) {
+        return record;
+    }
+    ResourceBudget budget(rlim, mlim);
+    try {
+        CNF::Analysis analysis;
+        {
+            ResourceBudget::Scope scope(budget);
+            analysis = CNF::analyze(filepath.c_str());
+        }
+        record.emplace_back("analyze_runtime", budget.get_runtime());
+        record.emplace_back("gbdhash", analysis.gbdhash);
+        record.emplace_back("isohash", analysis.isohash);
+        record.emplace_back("wlhash", analysis.wlhash);
+        for (size_t i = 0; i < analysis.features.size(); ++i) {
+            record.emplace_back(analysis.names[i], analysis.features[i]);
+        }
+        if (cache) cache->store(filepath, "analyze_runtime", record);
+    }
+    catch (TimeLimitExceeded &e) {
+        record.assign(1, { "analyze_runtime", "timeout" });
+    }
+    catch (MemoryLimitExceeded &e) {
+        record.assign(1, { "analyze_runtime", "memout" });
+    }
+    return record;
+}
+
+py::dict analyze(const std::string filepath, const size_t rlim, const size_t mlim) {
+    const std::shared_ptr<ResultCache> shared = cache;
+    BatchRecord record;
+    {
+        py::gil_scoped_release release;
+        record = analyze_record(shared.get(), filepath, rlim, mlim);
+    }
+    return record_to_dict(record);
+}
+
+/**
+ * @brief approximate cnf base features from a sample of the input, never cached
+ */
+py::dict extract_base_features_approx(const std::string filepath, const double fraction, const size_t rlim, const size_t mlim, const uint64_t seed) {
+    BatchRecord record;
+    {
+        py::gil_scoped_release release;
+        CNF::ApproxFeatures stats(filepath.c_str(), fraction, seed);
+        ResourceBudget budget(rlim, mlim);
+        try {
+            {
+                ResourceBudget::Scope scope(budget);
+                stats.extract();
+            }
+            record.emplace_back(stats.getRuntimeDesc(), budget.get_runtime());
+            const auto names = stats.getNames();
+            const auto features = stats.getFeatures();
+            for (size_t i = 0; i < features.size(); ++i) {
+                record.emplace_back(names[i], features[i]);
+            }
+        }
+        catch (TimeLimitExceeded &e) {
+            record.assign(1, { stats.getRuntimeDesc(), "timeout" });
+        }
+        catch (MemoryLimitExceeded &e) {
+            record.assign(1, { stats.getRuntimeDesc(), "memout" });
+        }
+    }
+    return record_to_dict(record);
+}
+
+py::dict incremental(const std::string filepath, const std::string state) {
+    BatchRecord record;
+    {
+        py::gil_scoped_release release;
+        const CNF::IncrementalResult result = CNF::incremental(filepath.c_str(), state.empty() ? filepath + ".gbdstate" : state);
+        record.emplace_back("gbdhash", result.gbdhash);
+        for (size_t i = 0; i < result.features.size(); ++i) {
+            record.emplace_back(result.names[i], result.features[i]);
+        }
+        record.emplace_back("bytes_parsed", static_cast<double>(result.bytes_parsed));
+    }
+    return record_to_dict(record);
+}
+
+/**
+ * @brief run task on all files on a native thread pool, the GIL is only held to deliver results
+ * Each result is a dict which starts with the file name, failed tasks report the exception message under "error".
+ * @param threads number of worker threads, 0 for number of cores
+ * @param callback called with each result as it completes (if not None)
+ * @return results in completion order
+ */
+py::list python_batch(const std::vector<std::string>& paths, const unsigned threads, const BatchTask& task, const py::object& callback) {
+    py::list results;
+    std::exception_ptr callback_error;
+    {
+        py::gil_scoped_release release;
+        run_workers(paths.size(), threads > 0 ? threads : std::thread::hardware_concurrency(), [&] (size_t i) {
+            BatchRecord record { { "file", paths[i] } };
+            try {
+                const BatchRecord result = task(paths[i]);
+                record.insert(record.end(), result.begin(), result.end());
+            }
+            catch (std::exception& e) {
+                record.emplace_back("error", e.what());
+            }
+            py::gil_scoped_acquire acquire;
+            py::dict dict = record_to_dict(record);
+            results.append(dict);
+            if (callback.is_none() || callback_error) return;
+            try {
+                callback(dict);
+            }
+            catch (...) {  // rethrown on the calling thread, later results are only collected
+                callback_error = std::current_exception();
+            }
+        });
+    }
+    if (callback_error) std::rethrow_exception(callback_error);
+    return results;
+}
+
+template <typename Extractor>
+py::list extract_features_batch(const std::vector<std::string> paths, const unsigned threads, const size_t rlim, const size_t mlim, const py::object callback) {
+    const std::shared_ptr<ResultCache> shared = cache;
+    return python_batch(paths, threads, [&] (const std::string& path) { return feature_record<Extractor>(shared.get(), path, rlim, mlim); }, callback);
+}
+
+/**
+ * @brief extract features of all files into a single contiguous matrix, avoids one python object per feature
+ * Row i holds the features of paths[i] in the order of feature_names<Extractor>(), i.e., runtime last.
+ * Rows of failed tasks are NaN, the reason is given by the status list ("ok", "timeout", "memout" or "error").
+ * @param threads number of worker threads, 0 for number of cores
+ * @return tuple of numpy.ndarray of shape (len(paths), len(names)) and status list
+ */
+template <typename Extractor>
+py::tuple extract_features_array(const std::vector<std::string> paths, const unsigned threads, const size_t rlim, const size_t mlim) {
+    const std::shared_ptr<ResultCache> shared = cache;
+    const size_t cols = feature_names<Extractor>().size();
+    std::unique_ptr<double[]> buffer(new double[paths.size() * cols]);
+    double* data = buffer.get();
+    std::vector<std::string> status(paths.size(), "ok");
+    {
+        py::gil_scoped_release release;
+        run_workers(paths.size(), threads > 0 ? threads : std::thread::hardware_concurrency(), [&] (size_t i) {
+            double* row = data + i * cols;
+            std::fill(row, row + cols, std::numeric_limits<double>::quiet_NaN());
+            try {
+                const BatchRecord record = feature_record<Extractor>(shared.get(), paths[i], rlim, mlim);
+                if (const std::string* reason = std::get_if<std::string>(&record.front().second)) {
+                    status[i] = *reason;
+                    return;
+                }
+                // record is runtime followed by features
+                for (size_t j = 1; j < record.size() && j < cols; ++j) {
+                    row[j - 1] = std::get<double>(record[j].second);
+                }
+                row[cols - 1] = std::get<double>(record.front().second);
+            }
+            catch (std::exception& e) {
+                status[i] = "error";
+            }
+        });
+    }
+    py::capsule owner(buffer.release(), [] (void* ptr) { delete[] static_cast<double*>(ptr); });
+    py::array_t<double> matrix({ paths.size(), cols }, { cols * sizeof(double), sizeof(double) }, data, owner);
+    return py::make_tuple(matrix, status);
+}
+
+py::list analyze_batch(const std::vector<std::string> paths, const unsigned threads, const size_t rlim, const size_t mlim, const py::object callback) {
+    const std::shared_ptr<ResultCache> shared = cache;
+    return python_batch(paths, threads, [&] (const std::string& path) { return analyze_record(shared.get(), path, rlim, mlim); }, callback);
+}
+
+py::list hash_batch(const std::vector<std::string>& paths, const unsigned threads, const std::string& task, std::string (*hash)(const char*), const py::object& callback) {
+    const std::shared_ptr<ResultCache> shared = cache;
+    return python_batch(paths, threads, [&] (const std::string& path) { return BatchRecord { { task, cached_hash(shared.get(), path, task, hash) } }; }, callback);
+}
+
+/**
+ * @brief GBD-Hash of all files with multi-buffer md5, each thread interleaves the files of its share
+ * @return list of hashes, None for files which could not be read
+ */
+py::list gbdhash_many(const std::vector<std::string> paths, const unsigned threads) {
+    const std::shared_ptr<ResultCache> shared = cache;
+    std::vector<std::string> hashes(paths.size());
+    {
+        py::gil_scoped_release release;
+        std::vector<size_t> missing;
+        for (size_t i = 0; i < paths.size(); ++i) {
+            BatchRecord record;
+            if (shared && shared->lookup(paths[i], "gbdhash", record)) hashes[i] = std::get<std::string>(record.front().second);
+            else missing.push_back(i);
+        }
+        const unsigned jobs = std::max(1u, std::min<unsigned>(threads > 0 ? threads : std::thread::hardware_concurrency(), missing.size()));
+        run_workers(jobs, jobs, [&] (size_t job) {
+            std::vector<std::string> share;
+            for (size_t k = job; k < missing.size(); k += jobs) share.push_back(paths[missing[k]]);
+            const std::vector<std::string> result = CNF::gbdhash_many(share);
+            for (size_t k = job, r = 0; k < missing.size(); k += jobs, ++r) {
+                hashes[missing[k]] = result[r];
+                if (shared && !result[r].empty()) shared->store(paths[missing[k]], "gbdhash", BatchRecord { { "gbdhash", result[r] } });
+            }
+        });
+    }
+    py::list list;
+    for (const std::string& hash : hashes) {
+        if (hash.empty()) list.append(py::none());
+        else list.append(hash);
+    }
+    return list;
+}
+
+void set_buffer_size(const size_t size, const bool adaptive) {
+    StreamBuffer::default_buffer_size = size;
+    StreamBuffer::default_adaptive = adaptive;
+}
+
+void set_decode_thread(const bool enabled) {
+    StreamBuffer::default_threaded = enabled;
+}
+
+void set_compression(const unsigned threads, const int level) {
+    StreamCompressor::default_threads = threads;
+    StreamCompressor::default_level = level;
 }
 
 PYBIND11_MODULE(gbdc, m) {
@@ -123,18 +428,46 @@ PYBIND11_MODULE(gbdc, m) {
     m.def("extract_gate_features", &extract_features<CNF::GateFeatures>, "Extract cnf gate features", py::arg("filepath"), py::arg("rlim"), py::arg("mlim"));
     m.def("extract_wcnf_base_features", &extract_features<WCNF::BaseFeatures>, "Extract wcnf base features", py::arg("filepath"), py::arg("rlim"), py::arg("mlim"));
     m.def("extract_opb_base_features", &extract_features<OPB::BaseFeatures>, "Extract opb base features", py::arg("filepath"), py::arg("rlim"), py::arg("mlim"));
+    m.def("extract_base_features_approx", &extract_base_features_approx, "Approximate cnf base features from a random sample of the given fraction of the input (block seeks in uncompressed and indexed packed files, every k-th clause otherwise), estimates are followed by their standard error <name>_se", py::arg("filepath"), py::arg("fraction") = 0.01, py::arg("rlim") = 0, py::arg("mlim") = 0, py::arg("seed") = 0);
+    m.def("incremental", &incremental, "Calculate gbdhash and cnf base features of a plain DIMACS file which grows by appending clauses, only the bytes appended since the last call are parsed (state in <filepath>.gbdstate by default)", py::arg("filepath"), py::arg("state") = "");
+    m.def("analyze", &analyze, "Calculate gbdhash, isohash, wlhash and cnf base features with a single parse", py::arg("filepath"), py::arg("rlim"), py::arg("mlim"));
+    m.def("extract_base_features_batch", &extract_features_batch<CNF::BaseFeatures>, "Extract cnf base features of all files on a native thread pool (0 threads for number of cores), results are passed to callback as they complete and returned in completion order.", py::arg("paths"), py::arg("threads"), py::arg("rlim"), py::arg("mlim"), py::arg("callback") = py::none());
+    m.def("extract_gate_features_batch", &extract_features_batch<CNF::GateFeatures>, "Extract cnf gate features of all files on a native thread pool (0 threads for number of cores), results are passed to callback as they complete and returned in completion order.", py::arg("paths"), py::arg("threads"), py::arg("rlim"), py::arg("mlim"), py::arg("callback") = py::none());
+    m.def("extract_wcnf_base_features_batch", &extract_features_batch<WCNF::BaseFeatures>, "Extract wcnf base features of all files on a native thread pool (0 threads for number of cores), results are passed to callback as they complete and returned in completion order.", py::arg("paths"), py::arg("threads"), py::arg("rlim"), py::arg("mlim"), py::arg("callback") = py::none());
+    m.def("extract_opb_base_features_batch", &extract_features_batch<OPB::BaseFeatures>, "Extract opb base features of all files on a native thread pool (0 threads for number of cores), results are passed to callback as they complete and returned in completion order.", py::arg("paths"), py::arg("threads"), py::arg("rlim"), py::arg("mlim"), py::arg("callback") = py::none());
+    m.def("extract_base_features_array", &extract_features_array<CNF::BaseFeatures>, "Extract cnf base features of all files into a numpy matrix (columns as in base_feature_names), returns tuple of matrix and status list.", py::arg("paths"), py::arg("threads"), py::arg("rlim"), py::arg("mlim"));
+    m.def("extract_gate_features_array", &extract_features_array<CNF::GateFeatures>, "Extract cnf gate features of all files into a numpy matrix (columns as in gate_feature_names), returns tuple of matrix and status list.", py::arg("paths"), py::arg("threads"), py::arg("rlim"), py::arg("mlim"));
+    m.def("extract_wcnf_base_features_array", &extract_features_array<WCNF::BaseFeatures>, "Extract wcnf base features of all files into a numpy matrix (columns as in wcnf_base_feature_names), returns tuple of matrix and status list.", py::arg("paths"), py::arg("threads"), py::arg("rlim"), py::arg("mlim"));
+    m.def("extract_opb_base_features_array", &extract_features_array<OPB::BaseFeatures>, "Extract opb base features of all files into a numpy matrix (columns as in opb_base_feature_names), returns tuple of matrix and status list.", py::arg("paths"), py::arg("threads"), py::arg("rlim"), py::arg("mlim"));
+    m.def("analyze_batch", &analyze_batch, "Analyze all files on a native thread pool (0 threads for number of cores), results are passed to callback as they complete and returned in completion order.", py::arg("paths"), py::arg("threads"), py::arg("rlim"), py::arg("mlim"), py::arg("callback") = py::none());
+    m.def("set_buffer_size", &set_buffer_size, "Set read buffer size in bytes for all subsequent calls, adaptive buffers grow on long tokens.", py::arg("size"), py::arg("adaptive") = true);
+    m.def("set_cache", &set_cache, "Persist hashes and features in the given directory and reuse them for unchanged files, empty string disables the cache.", py::arg("directory"));
+    m.def("enable_profile", &enable_profile, "Record wall time, cpu time and peak memory of phases and processed bytes and clauses in all subsequent calls.", py::arg("enabled") = true);
+    m.def("get_profile", &get_profile, "Return recorded measurements as dict, keys are <phase>.calls, <phase>.wall_ns, <phase>.cpu_ns, <phase>.peak_rss_kb and counter names.");
+    m.def("reset_profile", &Profile::reset, "Discard recorded measurements.");
+    m.def("set_decode_thread", &set_decode_thread, "Decompress input files on a separate thread in all subsequent calls.", py::arg("enabled"));
+    m.def("set_compression", &set_compression, "Set threads (0 for number of cores) and level (-1 for default) of compressed output files in all subsequent calls.", py::arg("threads"), py::arg("level") = -1);
     m.def("version", &version, "Return current version of gbdc.");
-    m.def("cnf2kis", &cnf2kis, "Create k-ISP Instance from given CNF Instance.", py::arg("filename"), py::arg("output"));
-    m.def("sanitize", &sanitize, "Print sanitized, i.e., no duplicate literals in clauses and no tautologic clauses, CNF to stdout.", py::arg("filename"));
+    m.def("cnf2kis", &cnf2kis, "Create k-ISP Instance from given CNF Instance, external keeps the clauses in a temporary file instead of parsing the input in every pass.", py::arg("filename"), py::arg("output"), py::arg("threads") = 1, py::arg("external") = false);
+    m.def("sanitize", [] (const std::string filename, const std::string output, const unsigned threads) { sanitize(filename.c_str(), output.empty() ? nullptr : output.c_str(), threads); },
+        "Print sanitized, i.e., no duplicate literals in clauses and no tautologic clauses, CNF to stdout or to output file (compressed if it ends with .xz or .zst).", py::arg("filename"), py::arg("output") = "", py::arg("threads") = 1, py::call_guard<py::gil_scoped_release>());
+    m.def("check_sanitized", &check_sanitized, "Check if CNF contains neither duplicate literals in clauses nor tautologic clauses, stops at the first violation.", py::arg("filename"), py::arg("threads") = 1, py::call_guard<py::gil_scoped_release>());
     m.def("base_feature_names", &feature_names<CNF::BaseFeatures>, "Get Base Feature Names");
+    m.def("approx_base_feature_names", &feature_names<CNF::ApproxFeatures>, "Get Approximate Base Feature Names");
     m.def("gate_feature_names", &feature_names<CNF::GateFeatures>, "Get Gate Feature Names");
     m.def("wcnf_base_feature_names", &feature_names<WCNF::BaseFeatures>, "Get WCNF Base Feature Names");
     m.def("opb_base_feature_names", &feature_names<OPB::BaseFeatures>, "Get OPB Base Feature Names");
-    m.def("gbdhash", &CNF::gbdhash, "Calculates GBD-Hash (md5 of normalized file) of given DIMACS CNF file.", py::arg("filename"));
-    m.def("isohash", &CNF::isohash, "Calculates ISO-Hash (md5 of sorted degree sequence) of given DIMACS CNF file.", py::arg("filename"));
-    m.def("weisfeiler_leman_hash", &CNF::weisfeiler_leman_hash, "Calculates fixed depth Weisfeiler-Leman-Hash of given DIMACS CNF file.", py::arg("filename"), py::arg("formula_optimization_level"), py::arg("use_xxh3"), py::arg("use_half_word_hash"), py::arg("use_prime_ring"), py::arg("depth"), py::arg("cross_reference_literals"), py::arg("rehash_clauses"), py::arg("optimize_first_iteration"), py::arg("progress_check_iteration"), py::arg("shrink_to_fit"), py::arg("return_measurements"), py::arg("sort_for_clause_hash"));
-    m.def("opbhash", &OPB::gbdhash, "Calculates OPB-Hash (md5 of normalized file) of given OPB file.", py::arg("filename"));
-    m.def("pqbfhash", &PQBF::gbdhash, "Calculates PQBF-Hash (md5 of normalized file) of given PQBF file.", py::arg("filename"));
-    m.def("wcnfhash", &WCNF::gbdhash, "Calculates WCNF-Hash (md5 of normalized file) of given WCNF file.", py::arg("filename"));
-    m.def("wcnfisohash", &WCNF::isohash, "Calculates WCNF ISO-Hash of given WCNF file.", py::arg("filename"));
+    m.def("gbdhash", [] (const std::string filename) { return cached_hash(filename, "gbdhash", &CNF::gbdhash); }, "Calculates GBD-Hash (md5 of normalized file) of given DIMACS CNF file.", py::arg("filename"));
+    m.def("gbdhash_batch", [] (const std::vector<std::string> paths, const unsigned threads, const py::object callback) { return hash_batch(paths, threads, "gbdhash", &CNF::gbdhash, callback); },
+        "Calculates GBD-Hash of all files on a native thread pool (0 threads for number of cores), results are passed to callback as they complete and returned in completion order.", py::arg("paths"), py::arg("threads"), py::arg("callback") = py::none());
+    m.def("gbdhash_many", &gbdhash_many, "Calculates GBD-Hash of all files, interleaving up to 8 files per thread in the lanes of a vectorized md5 (None for unreadable files).", py::arg("paths"), py::arg("threads") = 1);
+    m.def("gbdhash2", &CNF::gbdhash2, "Calculates GBD-Hash 2 (tree of XXH3 hashes of clause blocks, not compatible with gbdhash) of given DIMACS CNF file.", py::arg("filename"), py::arg("threads") = 1, py::call_guard<py::gil_scoped_release>());
+    m.def("isohash", [] (const std::string filename) { return cached_hash(filename, "isohash", &CNF::isohash); }, "Calculates ISO-Hash (md5 of sorted degree sequence) of given DIMACS CNF file.", py::arg("filename"));
+    m.def("isohash_batch", [] (const std::vector<std::string> paths, const unsigned threads, const py::object callback) { return hash_batch(paths, threads, "isohash", &CNF::isohash, callback); },
+        "Calculates ISO-Hash of all files on a native thread pool (0 threads for number of cores), results are passed to callback as they complete and returned in completion order.", py::arg("paths"), py::arg("threads"), py::arg("callback") = py::none());
+    m.def("weisfeiler_leman_hash", &CNF::weisfeiler_leman_hash, "Calculates fixed depth Weisfeiler-Leman-Hash of given DIMACS CNF file.", py::arg("filename"), py::arg("formula_optimization_level"), py::arg("use_xxh3"), py::arg("use_half_word_hash"), py::arg("use_prime_ring"), py::arg("depth"), py::arg("cross_reference_literals"), py::arg("rehash_clauses"), py::arg("optimize_first_iteration"), py::arg("progress_check_iteration"), py::arg("shrink_to_fit"), py::arg("return_measurements"), py::arg("sort_for_clause_hash"), py::arg("threads") = 1, py::call_guard<py::gil_scoped_release>());
+    m.def("opbhash", &OPB::gbdhash, "Calculates OPB-Hash (md5 of normalized file) of given OPB file.", py::arg("filename"), py::call_guard<py::gil_scoped_release>());
+    m.def("pqbfhash", &PQBF::gbdhash, "Calculates PQBF-Hash (md5 of normalized file) of given PQBF file.", py::arg("filename"), py::call_guard<py::gil_scoped_release>());
+    m.def("wcnfhash", &WCNF::gbdhash, "Calculates WCNF-Hash (md5 of normalized file) of given WCNF file.", py::arg("filename"), py::call_guard<py::gil_scoped_release>());
+    m.def("wcnfisohash", &WCNF::isohash, "Calculates WCNF ISO-Hash of given WCNF file.", py::arg("filename"), py::call_guard<py::gil_scoped_release>());
 }
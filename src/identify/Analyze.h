@@ -0,0 +1,239 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef ANALYZE_H_
+#define ANALYZE_H_
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/external/md5/md5.h"
+
+#include "src/util/BinaryCNF.h"
+#include "src/util/SolverTypes.h"
+#include "src/util/IntervalCNFFormula.h"
+#include "src/util/Profile.h"
+
+#include "src/identify/GBDHash.h"
+#include "src/identify/ISOHash.h"
+#include "src/identify/ISOHash2.h"
+
+#include "src/extract/CNFBaseFeatures.h"
+
+namespace CNF {
+    /**
+     * @brief Receives every clause of a single parse of the input file
+     */
+    class ClauseConsumer {
+     public:
+        virtual ~ClauseConsumer() { }
+        virtual void consume(const Cl& clause) = 0;
+    };
+
+    /**
+     * @brief Feeds the normalized clause text (see NormalizedText) to md5, same result as gbdhash()
+     */
+    class GBDHashConsumer {
+        MD5 md5;
+
+     public:
+        void consume(const std::string& text) {
+            md5.consume(text.data(), text.size());
+        }
+
+        std::string produce() {
+            return md5.produce();
+        }
+    };
+
+    /**
+     * @brief Parses the given file once and passes each clause to all registered consumers
+     * and the normalized text of DIMACS files to the text consumer
+     */
+    class ClauseDispatcher {
+        std::vector<ClauseConsumer*> consumers;
+        GBDHashConsumer* text_ = nullptr;
+
+        void dispatch(const Cl& clause) {
+            for (ClauseConsumer* consumer : consumers) {
+                consumer->consume(clause);
+            }
+        }
+
+     public:
+        void add(ClauseConsumer& consumer) {
+            consumers.push_back(&consumer);
+        }
+
+        void add(GBDHashConsumer& text) {
+            text_ = &text;
+        }
+
+        /**
+         * @return header of packed file or nullptr for DIMACS files
+         */
+        std::unique_ptr<BinaryCNF::Header> run(const char* filename) {
+            Profile::Scope scope("parse");
+            Cl clause;
+            uint64_t n_clauses = 0;
+            std::unique_ptr<BinaryCNF::Header> header;
+            if (BinaryCNF::is_packed(filename)) {
+                BinaryCNF::Reader in(filename);
+                while (in.readClause(clause)) {
+                    dispatch(clause);
+                    ++n_clauses;
+                }
+                header = std::make_unique<BinaryCNF::Header>(in.header());
+            } else {
+                // the hashed text is the token text of the file, which the literals do not preserve
+                constexpr size_t stage_size = 1 << 16;
+                NormalizedText in(filename);
+                std::string stage;
+                stage.reserve(stage_size + 32);
+                while (in.readClause(stage, clause)) {
+                    dispatch(clause);
+                    ++n_clauses;
+                    if (stage.size() >= stage_size) {
+                        if (text_ != nullptr) text_->consume(stage);
+                        stage.clear();
+                    }
+                }
+                if (text_ != nullptr) text_->consume(stage);
+            }
+            Profile::count("clauses", n_clauses);
+            return header;
+        }
+    };
+
+    /**
+     * @brief Counts literal degrees, same result as isohash()
+     */
+    class ISOHashConsumer : public ClauseConsumer {
+        std::vector<IsoDegree> degrees;
+
+     public:
+        void consume(const Cl& clause) override {
+            for (Lit lit : clause) {
+                const size_t var = lit.var();
+                if (var > degrees.size()) degrees.resize(std::max(var, 2 * degrees.size()));
+                if (lit.sign()) ++degrees[var - 1].neg;
+                else ++degrees[var - 1].pos;
+            }
+        }
+
+        std::string produce() {
+            return isohash_from_degrees(degrees);
+        }
+    };
+
+    /**
+     * @brief Forwards clauses to an extractor which implements the streaming interface
+     */
+    template <typename Extractor>
+    class ExtractorConsumer : public ClauseConsumer {
+        Extractor& extractor;
+
+     public:
+        explicit ExtractorConsumer(Extractor& extractor_) : extractor(extractor_) { }
+
+        void consume(const Cl& clause) override {
+            extractor.consume(clause);
+        }
+    };
+
+    /**
+     * @brief Keeps the formula in memory for analyses which need more than one pass
+     */
+    class FormulaConsumer : public ClauseConsumer {
+     public:
+        IntervalCNFFormula formula;
+        unsigned n_empty = 0;  // empty clauses are not stored in formula
+
+        void consume(const Cl& clause) override {
+            if (clause.empty()) ++n_empty;
+            else formula.addClause(clause);
+        }
+    };
+
+    struct Analysis {
+        std::string gbdhash;
+        std::string isohash;
+        std::string wlhash;
+        std::vector<std::string> names;
+        std::vector<double> features;
+    };
+
+    /**
+     * @brief Computes gbdhash, isohash, wlhash (default configuration) and base features
+     * with a single parse (and decompression) of the given file
+     * @param filename benchmark instance
+     * @return Analysis all results
+     */
+    Analysis analyze(const char* filename) {
+        GBDHashConsumer gbd;
+        ISOHashConsumer iso;
+        FormulaConsumer store;
+        BaseFeatures1 base1(filename);
+        BaseFeatures2 base2(filename, false);  // clause degrees are computed from store
+        ExtractorConsumer<BaseFeatures1> consumer1(base1);
+        ExtractorConsumer<BaseFeatures2> consumer2(base2);
+
+        ClauseDispatcher dispatcher;
+        dispatcher.add(gbd);
+        dispatcher.add(iso);
+        dispatcher.add(consumer1);
+        dispatcher.add(consumer2);
+        dispatcher.add(store);
+        const auto packed = dispatcher.run(filename);
+
+        // clause graph features depend on final variable degrees, use original variable names
+        for (const auto clause : store.formula.clauses()) {
+            base2.consume_degree(clause);
+        }
+        for (unsigned i = 0; i < store.n_empty; ++i) {
+            base2.consume_degree(Cl());
+        }
+        base1.finalize();
+        base2.finalize();
+
+        Analysis result;
+        // text of packed files is not available, use precomputed hash
+        result.gbdhash = packed ? packed->gbdhash : gbd.produce();
+        result.isohash = iso.produce();
+
+        result.names = base1.getNames();
+        const auto names2 = base2.getNames();
+        result.names.insert(result.names.end(), names2.begin(), names2.end());
+        result.features = base1.getFeatures();
+        const auto features2 = base2.getFeatures();
+        result.features.insert(result.features.end(), features2.begin(), features2.end());
+
+        // default configuration of weisfeiler_leman_hash() without measurements
+        store.formula.finalize(false);
+        const WLHRuntimeConfig cfg { 13, true, true, true, 6, false, false, false };
+        const auto hasher = std::make_unique<WeisfeilerLemanHasher<IntervalCNFFormula, true, true, false>>(std::move(store.formula), cfg);
+        result.wlhash = (*hasher)();
+
+        return result;
+    }
+} // namespace CNF
+
+#endif  // ANALYZE_H_
@@ -20,33 +20,307 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #ifndef GBDHASH_H_
 #define GBDHASH_H_
 
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <future>
+#include <limits>
+#include <memory>
 #include <string>
 #include <sstream>
+#include <vector>
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
 
 #include "src/external/md5/md5.h"
 #include "src/util/StreamBuffer.h"
+#include "src/util/BinaryCNF.h"
+#include "src/util/MultiMD5.h"
+#include "src/util/OPBReader.h"
 
 namespace CNF {
+    /**
+     * @brief Normalized text of all clauses of a DIMACS file (the input of md5 in gbdhash()), produced in pieces
+     * such that several files can be hashed in an interleaved fashion (see gbdhash_many())
+     */
+    class NormalizedText {
+     public:
+        // position in the text at the beginning of a line
+        struct State {
+            bool in_clause = false;  // the clause of the previous line continues
+            bool notfirst = false;  // a clause was started before
+        };
+
+     private:
+        StreamBuffer in;
+        State state_;
+        bool last_ = true;  // the input ends with the file
+        const char* filename_;
+
+     public:
+        explicit NormalizedText(const char* filename) : in(filename), filename_(filename) { }
+
+        /**
+         * @brief normalized text of the lines [first, last) of a mapped file, continuing the text of the lines before
+         * @pre first is the beginning of a line, last is the beginning of a line or the end of the file (followed by a zero byte)
+         * @param state state() of the text of the lines before first
+         * @param ends_file whether last is the end of the file, otherwise the open clause continues behind last
+         */
+        NormalizedText(const char* first, const char* last, const char* filename, const State& state, bool ends_file)
+         : in(first, last, filename), state_(state), last_(ends_file), filename_(filename) { }
+
+        const State& state() const {
+            return state_;
+        }
+
+        /**
+         * @brief Appends normalized text to stage until it holds at least size bytes or the input is exhausted
+         * @return false if the input is exhausted
+         */
+        bool read(std::string& stage, size_t size) {
+            while (stage.size() < size) {
+                if (!state_.in_clause) {
+                    if (!in.skipWhitespace()) return false;
+                    if (*in == 'p' || *in == 'c') {
+                        if (!in.skipLine()) return false;
+                        continue;
+                    }
+                    if (state_.notfirst) stage.push_back(' ');
+                    state_.in_clause = true;
+                    state_.notfirst = true;
+                }
+                const size_t token = stage.size();
+                if (!in.appendNumber(stage)) {
+                    if (!last_) return false;  // clause continues behind the input
+                    stage.push_back('0');  // terminate last clause
+                    state_.in_clause = false;
+                } else if (stage.size() == token + 1 && stage[token] == '0') {
+                    state_.in_clause = false;
+                } else {
+                    stage.push_back(' ');
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Appends the normalized text of the next clause to stage and decodes its literals to out,
+         * clauses end at tokens of value zero as by StreamBuffer::readClause()
+         * @throw ParserException if a number is out of int32 range
+         * @return false if the input is exhausted, stage may still receive the end of the text then
+         */
+        bool readClause(std::string& stage, Cl& out) {
+            out.clear();
+            bool found = false;  // a token of out was read
+            for (;;) {
+                if (!state_.in_clause) {
+                    if (!in.skipWhitespace()) return found;
+                    if (*in == 'p' || *in == 'c') {
+                        if (!in.skipLine()) return found;
+                        continue;
+                    }
+                    if (state_.notfirst) stage.push_back(' ');
+                    state_.in_clause = true;
+                    state_.notfirst = true;
+                    ResourceBudget::poll();
+                }
+                const size_t token = stage.size();
+                if (!in.appendNumber(stage)) {
+                    if (!last_) return false;  // clause continues behind the input
+                    stage.push_back('0');  // terminate last clause
+                    state_.in_clause = false;
+                    return found;
+                }
+                found = true;
+                const bool negative = stage[token] == '-';
+                uint64_t number = 0;
+                for (size_t i = token + negative; i < stage.size() && number <= static_cast<uint64_t>(std::numeric_limits<int32_t>::max()); ++i) {
+                    number = number * 10 + (stage[i] - '0');
+                }
+                if (number > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) {
+                    throw ParserException(std::string(filename_) + ": number out of int32 range");
+                }
+                if (stage.size() == token + 1 && stage[token] == '0') {
+                    state_.in_clause = false;
+                } else {
+                    stage.push_back(' ');
+                }
+                if (number == 0) return true;
+                out.push_back(Lit(static_cast<unsigned>(number), negative));
+            }
+        }
+    };
+
+    /**
+     * @brief MD5 of the normalized text of all clauses
+     * The normalized text is staged in a local buffer and fed to md5 in large blocks.
+     * @param filename benchmark instance
+     * @return std::string gbdhash
+     */
     std::string gbdhash(const char* filename) {
+        if (BinaryCNF::is_packed(filename)) {
+            return BinaryCNF::Reader(filename).header().gbdhash;
+        }
+        constexpr size_t stage_size = 1 << 16;
         MD5 md5;
-        StreamBuffer in(filename);
-        bool notfirst = false;
-        while (in.skipWhitespace()) {
-            if (*in == 'p' || *in == 'c') {
-                if (!in.skipLine()) break;
-            } else {
-                if (notfirst) md5.consume(" ", 1);
-                std::string plit;
-                while (in.readNumber(&plit)) {
-                    if (plit == "0") break;
-                    md5.consume(plit.c_str(), plit.length());
-                    md5.consume(" ", 1);
+        NormalizedText text(filename);
+        std::string stage;
+        stage.reserve(stage_size + 32);
+        bool more = true;
+        while (more) {
+            more = text.read(stage, stage_size);
+            md5.consume(stage.data(), stage.size());
+            stage.clear();
+        }
+        return md5.produce();
+    }
+
+    /**
+     * @brief gbdhash() of many files, the md5 computations of up to MultiMD5::Engine::lanes files share
+     * the vector registers of one core (multi-buffer hashing)
+     * @param paths benchmark instances
+     * @return gbdhash of each file, empty string if the file could not be read
+     */
+    std::vector<std::string> gbdhash_many(const std::vector<std::string>& paths) {
+        constexpr unsigned lanes = MultiMD5::Engine::lanes;
+        constexpr size_t stage_size = 1 << 16;
+        std::vector<std::string> result(paths.size());
+        MultiMD5::Engine md5;
+        std::unique_ptr<NormalizedText> text[lanes];
+        size_t file[lanes];
+        std::string stage[lanes];
+        size_t next = 0;
+
+        // assigns the next unpacked file to an idle lane, packed files are answered from their header
+        auto assign = [&] (unsigned lane) {
+            while (next < paths.size()) {
+                const size_t i = next++;
+                try {
+                    if (BinaryCNF::is_packed(paths[i].c_str())) {
+                        result[i] = BinaryCNF::Reader(paths[i].c_str()).header().gbdhash;
+                        continue;
+                    }
+                    text[lane] = std::make_unique<NormalizedText>(paths[i].c_str());
+                    md5.reset(lane);
+                    file[lane] = i;
+                    return;
+                } catch (const std::exception&) { }
+            }
+        };
+
+        for (unsigned lane = 0; lane < lanes; ++lane) {
+            stage[lane].reserve(stage_size + 32);
+            assign(lane);
+        }
+        for (;;) {
+            const char* data[lanes];
+            size_t size[lanes];
+            bool done[lanes] = { };
+            bool active = false;
+            for (unsigned lane = 0; lane < lanes; ++lane) {
+                stage[lane].clear();
+                if (text[lane]) {
+                    active = true;
+                    try {
+                        done[lane] = !text[lane]->read(stage[lane], stage_size);
+                    } catch (const std::exception&) {
+                        text[lane].reset();  // result stays empty
+                        stage[lane].clear();
+                    }
+                }
+                data[lane] = stage[lane].data();
+                size[lane] = stage[lane].size();
+            }
+            if (!active) break;
+            md5.update(data, size);
+            for (unsigned lane = 0; lane < lanes; ++lane) {
+                if (text[lane] && done[lane]) {
+                    result[file[lane]] = md5.finish(lane);
+                    text[lane].reset();
+                    assign(lane);
+                } else if (!text[lane]) {
+                    assign(lane);
                 }
-                md5.consume("0", 1);
-                notfirst = true;
             }
         }
-        return md5.produce();
+        return result;
+    }
+
+    /**
+     * @brief Tree hash of the clauses, not compatible with gbdhash()
+     * - leaves: XXH3-128 of blocks of 2^14 clauses, each clause as "lit ... lit 0\n" in canonical decimal
+     * - root: XXH3-128 of the canonical (big endian) leaf digests in file order
+     * The value does not depend on the number of threads, nor on the formatting of the file (or packing).
+     * @param filename benchmark instance
+     * @param threads threads hashing the leaves while the caller parses the next blocks, 1 hashes sequentially
+     * @return std::string 32 hex digits
+     */
+    std::string gbdhash2(const char* filename, unsigned threads = 1) {
+        constexpr size_t block_clauses = 1 << 14;
+        const size_t batch_blocks = threads > 1 ? 4 * threads : 1;
+
+        std::vector<XXH128_hash_t> digests;
+        std::vector<std::string> filling(batch_blocks), hashing(batch_blocks);
+        std::vector<std::future<void>> workers;  // declared last, joined first on exceptions
+
+        auto join = [&workers] () {
+            for (auto& worker : workers) worker.get();
+            workers.clear();
+        };
+        // hash the first n blocks of filling, concurrently to parsing if threads > 1
+        auto launch = [&] (size_t n) {
+            join();
+            hashing.swap(filling);
+            for (std::string& block : filling) block.clear();
+            const size_t offset = digests.size();
+            digests.resize(offset + n);
+            if (threads <= 1) {
+                for (size_t i = 0; i < n; ++i) digests[offset + i] = XXH3_128bits(hashing[i].data(), hashing[i].size());
+                return;
+            }
+            for (unsigned t = 0; t < threads; ++t) {
+                workers.push_back(std::async(std::launch::async, [&, t, n, offset] () {
+                    for (size_t i = t; i < n; i += threads) digests[offset + i] = XXH3_128bits(hashing[i].data(), hashing[i].size());
+                }));
+            }
+        };
+
+        ClauseReader in(filename);
+        Cl clause;
+        char buffer[16];
+        size_t n_clauses = 0;
+        size_t current = 0;
+        while (in.readClause(clause)) {
+            std::string& text = filling[current];
+            for (Lit lit : clause) {
+                char* end = buffer;
+                if (lit.sign()) *end++ = '-';
+                end = std::to_chars(end, buffer + sizeof(buffer), static_cast<unsigned>(lit.var())).ptr;
+                *end++ = ' ';
+                text.append(buffer, end - buffer);
+            }
+            text.append("0\n", 2);
+            if (++n_clauses % block_clauses == 0 && ++current == batch_blocks) {
+                launch(current);
+                current = 0;
+            }
+        }
+        if (n_clauses % block_clauses != 0) ++current;
+        launch(current);
+        join();
+
+        std::vector<unsigned char> canonical(16 * digests.size());
+        for (size_t i = 0; i < digests.size(); ++i) {
+            for (unsigned b = 0; b < 8; ++b) {
+                canonical[16 * i + b] = digests[i].high64 >> (56 - 8 * b);
+                canonical[16 * i + 8 + b] = digests[i].low64 >> (56 - 8 * b);
+            }
+        }
+        const XXH128_hash_t root = XXH3_128bits(canonical.data(), canonical.size());
+        char hex[33];
+        snprintf(hex, sizeof(hex), "%016llx%016llx", static_cast<unsigned long long>(root.high64), static_cast<unsigned long long>(root.low64));
+        return hex;
     }
 } // namespace CNF 
 
@@ -80,65 +354,43 @@ namespace PQBF {
 } // namespace PQBF
 
 namespace OPB {
+    /**
+     * @brief MD5 of the normalized text of objective and constraints
+     * The text is rebuilt from the tokens of OPB::Reader and fed to md5 in large blocks.
+     * @param filename benchmark instance
+     * @return std::string gbdhash
+     */
     std::string gbdhash(const char* filename) {
+        constexpr size_t stage_size = 1 << 16;
         MD5 md5;
-        StreamBuffer in(filename);
-        std::string num;
-        while (in.skipWhitespace()) {
-            if (*in == '*') {
-                if (!in.skipLine()) break;
-            } 
-            else if (*in == 'm') {
-                md5.consume("min:", 4);
-                in.skipString("min:");
-                in.skipWhitespace();
-                while (*in != ';') {
-                    if (*in == 'x') {
-                        md5.consume(" x", 2);
-                        in.skip();
-                    } else if (*in == '~') {
-                        md5.consume(" ~x", 3);
-                        in.skip();
-                        in.skipWhitespace();
-                        in.skip();
-                    } else {
-                        md5.consume(" ", 1);
-                    }
-                    in.readNumber(&num);
-                    md5.consume(num.c_str(), num.length());
-                    in.skipWhitespace();
-                }
-                md5.consume(";", 1);
-            }
-            else {
-                while (*in != '>' && *in != '<' && *in != '=') {
-                    if (*in == 'x') {
-                        md5.consume("x", 1);
-                        in.skip();
-                    } else if (*in == '~') {
-                        md5.consume("~x", 2);
-                        in.skip();
-                        in.skipWhitespace();
-                        in.skip();
-                    }
-                    in.readNumber(&num);
-                    md5.consume(num.c_str(), num.length());
-                    md5.consume(" ", 1);
-                    in.skipWhitespace();
+        Reader in(filename);
+        std::string stage;
+        stage.reserve(2 * stage_size);
+        while (in.next()) {
+            const Constraint& constraint = in.constraint();
+            if (constraint.objective) {
+                stage.append("min:");
+                for (const Token& token : constraint.terms) {
+                    stage.append(token.kind == Token::POSITIVE ? " x" : token.kind == Token::NEGATIVE ? " ~x" : " ");
+                    stage.append(in.text(token.text));
                 }
-                while (*in == '>' || *in == '<' || *in == '=') {
-                    const char c = *in;
-                    md5.consume(&c, 1);
-                    in.skip();
+            } else {
+                for (const Token& token : constraint.terms) {
+                    stage.append(token.kind == Token::POSITIVE ? "x" : token.kind == Token::NEGATIVE ? "~x" : "");
+                    stage.append(in.text(token.text));
+                    stage.push_back(' ');
                 }
-                in.readNumber(&num);
-                md5.consume(" ", 1);
-                md5.consume(num.c_str(), num.length());
-                md5.consume(";", 1);
-                in.skipWhitespace();
+                stage.append(in.text(constraint.relation));
+                stage.push_back(' ');
+                stage.append(in.text(constraint.bound.text));
+            }
+            stage.push_back(';');
+            if (stage.size() >= stage_size) {
+                md5.consume(stage.data(), stage.size());
+                stage.clear();
             }
-            if (*in == ';') in.skip();
         }
+        md5.consume(stage.data(), stage.size());
         return md5.produce();
     }
 } // namespace OPB
@@ -22,15 +22,92 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 
 #include <vector>
 #include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
 #include <stdio.h>
 
 #include "src/external/md5/md5.h"
 
 #include "src/util/StreamBuffer.h"
+#include "src/util/BinaryCNF.h"
 #include "src/util/SolverTypes.h"
 
 
 namespace CNF {
+    struct IsoDegree { unsigned neg; unsigned pos; };
+
+    /**
+     * @brief Number of occurrences of each polarity-normalized degree pair
+     * - pairs with small degrees are counted in a dense table which is already in lexicographic order
+     * - all other pairs are counted in a hash map and sorted by key, they are few in practice
+     */
+    class IsoHistogram {
+        static constexpr unsigned dense_neg = 32;
+        static constexpr unsigned dense_pos = 512;
+
+        std::vector<uint64_t> dense;
+        std::unordered_map<uint64_t, uint64_t> sparse;  // key (neg << 32) | pos has lexicographic order
+
+     public:
+        IsoHistogram() : dense(dense_neg * dense_pos, 0) { }
+
+        void add(IsoDegree degree, uint64_t count = 1) {
+            if (degree.pos < degree.neg) std::swap(degree.pos, degree.neg);
+            if (degree.neg < dense_neg && degree.pos < dense_pos) {
+                dense[degree.neg * dense_pos + degree.pos] += count;
+            } else {
+                sparse[static_cast<uint64_t>(degree.neg) << 32 | degree.pos] += count;
+            }
+        }
+
+        /**
+         * @brief Hashsum of the degree sequence, same as formatting and hashing each node of the sorted sequence
+         * @return std::string isohash
+         */
+        std::string produce() const {
+            std::vector<std::pair<uint64_t, uint64_t>> entries;
+            for (unsigned i = 1; i < dense.size(); ++i) {  // skip (0, 0), get invariant against variable gaps
+                if (dense[i] > 0) entries.emplace_back(static_cast<uint64_t>(i / dense_pos) << 32 | i % dense_pos, dense[i]);
+            }
+            entries.insert(entries.end(), sparse.begin(), sparse.end());
+            std::sort(entries.begin(), entries.end());
+
+            MD5 md5;
+            char text[32];
+            char buffer[4096];
+            size_t used = 0;
+            for (const auto& [key, count] : entries) {
+                // format once per distinct pair, repeat for each node
+                const size_t length = snprintf(text, sizeof(text), "%u %u ",
+                    static_cast<unsigned>(key >> 32), static_cast<unsigned>(key & 0xFFFFFFFF));
+                for (uint64_t i = 0; i < count; ++i) {
+                    if (used + length > sizeof(buffer)) {
+                        md5.consume(buffer, used);
+                        used = 0;
+                    }
+                    std::memcpy(buffer + used, text, length);
+                    used += length;
+                }
+            }
+            md5.consume(buffer, used);
+            return md5.produce();
+        }
+    };
+
+    /**
+     * @brief Hashsum of ordered degree sequence given literal degrees per variable
+     * @param degrees literal degrees
+     * @return std::string isohash
+     */
+    std::string isohash_from_degrees(const std::vector<IsoDegree>& degrees) {
+        IsoHistogram histogram;
+        for (IsoDegree degree : degrees) {
+            histogram.add(degree);
+        }
+        return histogram.produce();
+    }
+
     /**
      * @brief Hashsum of ordered degree sequence of literal incidence graph
      * - literal nodes are grouped pairwise and sorted lexicographically
@@ -39,39 +116,45 @@ namespace CNF {
      * @return std::string isohash
      */
     std::string isohash(const char* filename) {
+        std::vector<IsoDegree> degrees;
+        if (BinaryCNF::is_packed(filename)) {
+            BinaryCNF::Reader in(filename);
+            // header is only a hint, bound allocation for bogus headers, variables are checked by the reader
+            degrees.resize(std::min<uint64_t>(in.header().n_vars, 1 << 26));
+            Cl clause;
+            while (in.readClause(clause)) {
+                for (Lit lit : clause) {
+                    const size_t var = lit.var();
+                    if (var > degrees.size()) degrees.resize(std::max(var, 2 * degrees.size()));
+                    if (lit.sign()) ++degrees[lit.var() - 1].neg;
+                    else ++degrees[lit.var() - 1].pos;
+                }
+            }
+            return isohash_from_degrees(degrees);
+        }
         StreamBuffer in(filename);
-        struct Node { unsigned neg; unsigned pos; };
-        std::vector<Node> degrees;
         while (in.skipWhitespace()) {
-            if (*in == 'p' || *in == 'c') {
+            if (*in == 'p') {
+                uint64_t vars, clauses;
+                // header is only a hint, bound allocation for bogus headers
+                if (in.readHeader("cnf", &vars, &clauses) && vars > degrees.size()) {
+                    degrees.resize(std::min<uint64_t>(vars, 1 << 26));
+                }
+            } else if (*in == 'c') {
                 if (!in.skipLine()) break;
             } else {
                 int plit;
                 while (in.readInteger(&plit)) {
-                    if (static_cast<size_t>(abs(plit)) >= degrees.size()) degrees.resize(abs(plit));
+                    const size_t var = abs(plit);
+                    // grow geometrically, unused entries are ignored like variable gaps
+                    if (var > degrees.size()) degrees.resize(std::max(var, 2 * degrees.size()));
                     if (plit == 0) break;
-                    else if (plit < 0) ++degrees[abs(plit) - 1].neg;
-                    else ++degrees[abs(plit) - 1].pos;
+                    else if (plit < 0) ++degrees[var - 1].neg;
+                    else ++degrees[var - 1].pos;
                 }
             }
         }
-        // get invariant w.r.t. polarity flips
-        for (Node& degree : degrees) {
-            if (degree.pos < degree.neg) std::swap(degree.pos, degree.neg);
-        }
-        // sort lexicographically by degree
-        std::sort(degrees.begin(), degrees.end(), [](const Node& one, const Node& two) { 
-            return one.neg != two.neg ? one.neg < two.neg : one.pos < two.pos; 
-        } );
-        // hash
-        MD5 md5;
-        char buffer[64];
-        for (Node node : degrees) {
-            if (node.neg == 0 && node.pos == 0) continue;  // get invariant against variable gaps
-            int n = snprintf(buffer, sizeof(buffer), "%u %u ", node.neg, node.pos);
-            md5.consume(buffer, n);
-        }
-        return md5.produce();
+        return isohash_from_degrees(degrees);
     }
 } // namespace CNF
 
@@ -23,10 +23,14 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cstring>
+#include <exception>
 #include <functional>
 #include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <type_traits>
-#include <unordered_set>
 #include <vector>
 #include <memory>
 #include <fstream>  // Include the fstream header for file operations
@@ -38,6 +42,10 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "src/util/NaiveCNFFormula.h"
 #include "src/util/IntervalCNFFormula.h"
 #include "src/util/SizeGroupedCNFFormula.h"
+#include "src/util/ReorderedCNFFormula.h"
+#include "src/util/ExternalCNFFormula.h"
+#include "src/util/Profile.h"
+#include "src/util/ResourceBudget.h"
 
 //in KB
 long get_mem_usage()
@@ -61,6 +69,7 @@ namespace CNF {
         bool shrink_to_fit;
         bool return_measurements;
         bool sort_for_clause_hash;
+        unsigned threads = 1;
     };
     template < // compile time config
         typename CNF,
@@ -104,16 +113,77 @@ namespace CNF {
         };
         // old and new color function, swapping in each iteration
         ColorFunction color_functions[2];
+        // clause ranges and color accumulators of worker threads (only if cfg.threads > 1)
+        using ClauseIt = decltype(std::declval<const CNF&>().clauses().begin());
+        std::vector<ClauseIt> splits;
+        std::vector<std::vector<Hash>> partial_colors;
         unsigned iteration = 0;
-        std::unordered_set<Hash> unique_hashes;
-        unsigned previous_unique_hashes = 1;
+        // counts distinct variable colors in a flat open addressing table which is reused in every check,
+        // colors are hashes already and serve as their own slot index, 0 marks empty slots
+        struct DistinctCounter {
+            std::vector<Hash> slots;
+            bool zero = false;
+            std::size_t count = 0;
+
+            void reset(const std::size_t n) {
+                std::size_t capacity = 16;
+                while (capacity < n + n / 2) capacity *= 2;
+                if (slots.size() != capacity) slots.assign(capacity, 0);
+                else std::fill(slots.begin(), slots.end(), 0);
+                zero = false;
+                count = 0;
+            }
+            inline void insert(const Hash h) {
+                if (h == 0) {
+                    count += !zero;
+                    zero = true;
+                    return;
+                }
+                const std::size_t mask = slots.size() - 1;
+                for (std::size_t i = h & mask; ; i = (i + 1) & mask) {
+                    if (slots[i] == h) return;
+                    if (slots[i] == 0) {
+                        slots[i] = h;
+                        ++count;
+                        return;
+                    }
+                }
+            }
+        };
+        DistinctCounter unique_hashes;
+        std::size_t previous_unique_hashes = 1;
 
         inline ColorFunction& old_color() { return color_functions[iteration % 2]; }
         inline ColorFunction& new_color() { return color_functions[(iteration + 1) % 2]; }
 
+        // XXH3_64bits() of 4 and 8 byte inputs without branches and table lookups,
+        // such that loops over colors and clauses can be vectorized by the compiler
+        static inline std::uint64_t xxh3_rrmxmx(std::uint64_t h, const std::uint64_t len) {
+            h ^= XXH_rotl64(h, 49) ^ XXH_rotl64(h, 24);
+            h *= 0x9FB21C651E98DF25ULL;
+            h ^= (h >> 35) + len;
+            h *= 0x9FB21C651E98DF25ULL;
+            return h ^ (h >> 28);
+        }
+        static inline std::uint64_t xxh3_short(const std::uint32_t x) {
+            return xxh3_rrmxmx((x | (std::uint64_t) x << 32) ^ xxh3_bitflip, 4);
+        }
+        static inline std::uint64_t xxh3_short(const std::uint64_t x) {
+            return xxh3_rrmxmx((x >> 32 | x << 32) ^ xxh3_bitflip, 8);
+        }
+        // secret words used by XXH3_len_4to8_64b() with seed 0
+        static constexpr std::uint64_t xxh3_bitflip = 0x1cad21f72c81017cULL ^ 0xdb979083e96dd4deULL;
+
         template <typename T> // needs to be flat, no pointers or heap data
         static inline Hash hash(const T t) {
             if constexpr (!use_prime_ring) {
+                if constexpr (use_xxh3 && (sizeof(T) == 4 || sizeof(T) == 8)) {
+                    if (XXH_CPU_LITTLE_ENDIAN) {
+                        std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t> x;
+                        std::memcpy(&x, &t, sizeof(t));
+                        return xxh3_short(x);
+                    }
+                }
                 if constexpr (use_xxh3)
                     return XXH3_64bits(&t, sizeof(t));
 
@@ -146,10 +216,11 @@ namespace CNF {
             }
             *acc += in;
         }
-        template <typename T, typename C>
-        static inline Hash hash_sum(const C& c, const std::function<Hash(const T&)>& f) {
+        // f is a template parameter such that it can be inlined
+        template <typename C, typename F>
+        static inline Hash hash_sum(const C& c, const F& f) {
             Hash h = 0;
-            for (const T& t : c)
+            for (const auto& t : c)
                 combine(&h, f(t));
             return h;
         }
@@ -158,7 +229,17 @@ namespace CNF {
                 : cfg(cfg)
                 , parsing_start_mem(get_mem_usage())
                 , parsing_start_time(Clock::now())
-                , cnf(filename, cfg.shrink_to_fit)
+                , cnf(filename, cfg.shrink_to_fit, cfg.threads)
+                , start_mem(get_mem_usage())
+                , start_time(Clock::now())
+                , color_functions {ColorFunction(cnf.nVars()), ColorFunction(cnf.nVars())}
+        {
+        }
+        WeisfeilerLemanHasher(CNF&& formula, const WLHRuntimeConfig cfg)
+                : cfg(cfg)
+                , parsing_start_mem(get_mem_usage())
+                , parsing_start_time(Clock::now())
+                , cnf(std::move(formula))
                 , start_mem(get_mem_usage())
                 , start_time(Clock::now())
                 , color_functions {ColorFunction(cnf.nVars()), ColorFunction(cnf.nVars())}
@@ -175,7 +256,7 @@ namespace CNF {
         }
         Hash clause_hash(const Clause cl) {
             if (!cfg.sort_for_clause_hash) {
-                Hash h = hash_sum<const Lit>(cl, [this](const Lit lit) { return old_color()(lit); });
+                Hash h = hash_sum(cl, [this](const Lit lit) { return old_color()(lit); });
                 // hash again to preserve clause structure
                 if (cfg.rehash_clauses) h = hash(h);
                 return h;
@@ -188,20 +269,87 @@ namespace CNF {
                 return XXH3_64bits(sorted.data(), sorted.size() * sizeof(Hash));
             }
         };
+        inline Hash clause_color(const Clause cl) {
+            return (!in_optimized_iteration()) ?
+                clause_hash(cl)
+                : cfg.rehash_clauses ? hash(cl.size()) : cl.size();
+        }
         void iteration_step() {
             cross_reference();
-            for (const Clause cl : cnf.clauses()) {
-                const Hash clh = (!in_optimized_iteration()) ?
-                    clause_hash(cl)
-                    : cfg.rehash_clauses ? hash(cl.size()) : cl.size();
-                for (const Lit lit : cl)
-                    combine(&new_color()(lit), clh);
+            if (cfg.threads > 1 && cnf.nClauses() > 1) {
+                parallel_iteration_step();
+            } else {
+                for (const Clause cl : cnf.clauses()) {
+                    ResourceBudget::poll();
+                    const Hash clh = clause_color(cl);
+                    for (const Lit lit : cl)
+                        combine(&new_color()(lit), clh);
+                }
             }
             ++iteration;
         }
+        // combine is commutative and associative, so summing per thread and reducing afterwards yields the serial result
+        void parallel_iteration_step() {
+            if (splits.empty()) {
+                const size_t n_threads = std::min<size_t>(cfg.threads, cnf.nClauses());
+                const size_t chunk = (cnf.nClauses() + n_threads - 1) / n_threads;
+                size_t count = 0;
+                for (auto it = cnf.clauses().begin(); it != cnf.clauses().end(); ++it) {
+                    if (count++ % chunk == 0) splits.push_back(it);
+                }
+                splits.push_back(cnf.clauses().end());
+                partial_colors.resize(splits.size() - 1, std::vector<Hash>(2 * cnf.nVars()));
+            }
+            const size_t n_threads = partial_colors.size();
+            const size_t n_lits = 2 * cnf.nVars();
+            Hash* colors = reinterpret_cast<Hash*>(&new_color().colors[0]);
+            run_parallel(n_threads, [this](size_t t) {
+                std::vector<Hash>& acc = partial_colors[t];
+                std::fill(acc.begin(), acc.end(), 0);
+                for (auto it = splits[t]; it != splits[t + 1]; ++it) {
+                    ResourceBudget::poll();
+                    const Clause cl = *it;
+                    const Hash clh = clause_color(cl);
+                    for (const Lit lit : cl)
+                        combine(&acc[lit], clh);
+                }
+            });
+            run_parallel(n_threads, [this, colors, n_lits, n_threads](size_t t) {
+                for (size_t lit = n_lits * t / n_threads; lit < n_lits * (t + 1) / n_threads; ++lit)
+                    for (const std::vector<Hash>& acc : partial_colors)
+                        combine(&colors[lit], acc[lit]);
+            });
+        }
+        // run job(0) on calling thread (which owns the resource budget) and the others on worker threads with child budgets
+        template <typename Job>
+        static void run_parallel(const size_t n, const Job& job) {
+            std::vector<std::exception_ptr> errors(n);
+            std::vector<std::unique_ptr<ResourceBudget>> budgets;
+            for (size_t t = 1; t < n; ++t)
+                budgets.push_back(std::make_unique<ResourceBudget>(ResourceBudget::current()));
+            auto run = [&job, &errors] (size_t t) {
+                try {
+                    job(t);
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            };
+            std::vector<std::thread> workers;
+            for (size_t t = 1; t < n; ++t)
+                workers.emplace_back([&run, &budgets, t] () {
+                    ResourceBudget::Scope scope(*budgets[t - 1]);
+                    run(t);
+                });
+            run(0);
+            for (std::thread& worker : workers)
+                worker.join();
+            for (const std::exception_ptr& error : errors)
+                if (error)
+                    std::rethrow_exception(error);
+        }
         Hash variable_hash() {
             if (cfg.cross_reference_literals)
-                return hash_sum<LitColors>(old_color().colors, [](LitColors lc) { return lc.variable_hash(); });
+                return hash_sum(old_color().colors, [](LitColors lc) { return lc.variable_hash(); });
 
             Hash h = 0;
             for (Lit lit {}; lit != cnf.nVars() * 2; ++lit)
@@ -210,23 +358,22 @@ namespace CNF {
         }
         Hash cnf_hash() {
             cross_reference();
-            return hash_sum<Clause>(cnf.clauses(), [this](const Clause cl) { return clause_hash(cl); });
+            return hash_sum(cnf.clauses(), [this](const Clause cl) { return clause_hash(cl); });
         }
         std::optional<Hash> check_progress() {
             // few hits at the start
             if ((iteration != cfg.progress_check_iteration && iteration != cfg.progress_check_iteration + 1 && iteration < 6) || iteration == 0)
                 return std::nullopt;
 
-            unique_hashes.reserve(previous_unique_hashes);
-            const Hash vh = hash_sum<LitColors>(old_color().colors, [this](LitColors lc) {
+            unique_hashes.reset(cnf.nVars());
+            const Hash vh = hash_sum(old_color().colors, [this](LitColors lc) {
                 const Hash vh = lc.variable_hash();
                 unique_hashes.insert(vh);
                 return vh;
             });
-            if (unique_hashes.size() <= previous_unique_hashes)
+            if (unique_hashes.count <= previous_unique_hashes)
                 return vh;
-            previous_unique_hashes = unique_hashes.size();
-            unique_hashes.clear();
+            previous_unique_hashes = unique_hashes.count;
             return std::nullopt;
         }
         Hash run() {
@@ -238,7 +385,11 @@ namespace CNF {
             return cfg.depth % 2 == 0 ? variable_hash() : cnf_hash();
         }
         std::string operator () () {
-            std::string result = std::to_string(run());
+            std::string result;
+            {
+                Profile::Scope scope("analyze");
+                result = std::to_string(run());
+            }
             if (cfg.return_measurements) {
                 const auto calculation_time = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time).count();
                 const auto parsing_time = std::chrono::duration_cast<std::chrono::nanoseconds>(start_time - parsing_start_time).count();
@@ -291,7 +442,9 @@ namespace CNF {
      * Runtime O(h*n), space O(n).
      * @param filename benchmark instance
      * @param formula_optimization_level how optimized the CNF formula RAM
-     * usage should be, levels 0, 1 and 2
+     * usage should be, levels 0, 1 and 2, level 3 is level 1 with variables
+     * and clauses reordered for cache locality, level 4 is level 1 with the
+     * clauses kept in a temporary file (see ExternalCNFFormula)
      * @param use_xxh3 whether to use XXH3 or MD5
      * @param use_half_word_hash whether to use 32 or 64 bit hashes
      * @param use_prime_ring whether to add hashes in a prime ring or 2^N
@@ -307,6 +460,8 @@ namespace CNF {
      * iterations that were calculated (possibly half) should be returned
      * @param sort_for_clause_hash whether the clause hash input should be
      * sorted and input directly into the hash function
+     * @param threads number of threads parsing plain DIMACS files and hashing clauses in each iteration,
+     * the result does not depend on it
      * @return comma separated list, std::string Weisfeiler-Leman hash,
      * possibly measurements
      */
@@ -325,9 +480,10 @@ namespace CNF {
         const unsigned progress_check_iteration = 6,
         const bool shrink_to_fit = false,
         const bool return_measurements = true,
-        const bool sort_for_clause_hash = false
+        const bool sort_for_clause_hash = false,
+        const unsigned threads = 1
     ) {
-        constexpr std::string (*generic_functions[24])(const char* filename, const WLHRuntimeConfig cfg) = {
+        constexpr std::string (*generic_functions[40])(const char* filename, const WLHRuntimeConfig cfg) = {
             weisfeiler_leman_hash_generic<NaiveCNFFormula, false, false, false>,
             weisfeiler_leman_hash_generic<NaiveCNFFormula, false, false, true>,
             weisfeiler_leman_hash_generic<NaiveCNFFormula, false, true, false>,
@@ -352,7 +508,26 @@ namespace CNF {
             weisfeiler_leman_hash_generic<SizeGroupedCNFFormula, true, false, true>,
             weisfeiler_leman_hash_generic<SizeGroupedCNFFormula, true, true, false>,
             weisfeiler_leman_hash_generic<SizeGroupedCNFFormula, true, true, true>,
+            weisfeiler_leman_hash_generic<ReorderedCNFFormula, false, false, false>,
+            weisfeiler_leman_hash_generic<ReorderedCNFFormula, false, false, true>,
+            weisfeiler_leman_hash_generic<ReorderedCNFFormula, false, true, false>,
+            weisfeiler_leman_hash_generic<ReorderedCNFFormula, false, true, true>,
+            weisfeiler_leman_hash_generic<ReorderedCNFFormula, true, false, false>,
+            weisfeiler_leman_hash_generic<ReorderedCNFFormula, true, false, true>,
+            weisfeiler_leman_hash_generic<ReorderedCNFFormula, true, true, false>,
+            weisfeiler_leman_hash_generic<ReorderedCNFFormula, true, true, true>,
+            weisfeiler_leman_hash_generic<ExternalCNFFormula, false, false, false>,
+            weisfeiler_leman_hash_generic<ExternalCNFFormula, false, false, true>,
+            weisfeiler_leman_hash_generic<ExternalCNFFormula, false, true, false>,
+            weisfeiler_leman_hash_generic<ExternalCNFFormula, false, true, true>,
+            weisfeiler_leman_hash_generic<ExternalCNFFormula, true, false, false>,
+            weisfeiler_leman_hash_generic<ExternalCNFFormula, true, false, true>,
+            weisfeiler_leman_hash_generic<ExternalCNFFormula, true, true, false>,
+            weisfeiler_leman_hash_generic<ExternalCNFFormula, true, true, true>,
         };
+        if (formula_optimization_level > 4) {
+            throw std::runtime_error("Unknown formula optimization level " + std::to_string(formula_optimization_level));
+        }
         return generic_functions[
             (1 << 3) * formula_optimization_level +
             (1 << 2) * use_xxh3 +
@@ -366,7 +541,8 @@ namespace CNF {
             progress_check_iteration,
             shrink_to_fit,
             return_measurements,
-            sort_for_clause_hash
+            sort_for_clause_hash,
+            threads
         });
     }
 } // namespace CNF
@@ -0,0 +1,249 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef INCREMENTAL_H_
+#define INCREMENTAL_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+#include "src/util/MultiMD5.h"
+#include "src/util/ParallelDimacs.h"
+#include "src/util/SolverTypes.h"
+#include "src/util/StateFile.h"
+
+#include "src/identify/GBDHash.h"
+
+#include "src/extract/CNFBaseFeatures.h"
+
+namespace CNF {
+    struct IncrementalResult {
+        std::string gbdhash;
+        std::vector<std::string> names;
+        std::vector<double> features;  // BaseFeatures1
+        uint64_t bytes_parsed = 0;  // bytes of the file parsed by this call
+        bool resumed = false;  // true if a stored state was continued
+    };
+
+    /**
+     * @brief Hash and base feature accumulators of the clauses before a given position of a plain DIMACS file
+     * The position is always behind a line break, the literals of a clause which is continued after it are kept.
+     */
+    class IncrementalState {
+        static constexpr uint32_t version = 3;  // 2: clause balance as histogram, 3: token text and checksum of whole prefix
+        static constexpr size_t piece_size = 1 << 26;  // bytes parsed at once
+        static constexpr size_t stage_size = 1 << 16;
+
+        const char* filename_;
+        uint64_t offset = 0;
+        uint64_t prefix_check = 0;  // checksum of the bytes before offset
+        XXH3_state_t prefix;  // running checksum of the bytes before offset
+        MultiMD5::Stream md5;
+        NormalizedText::State text;
+        Cl pending;
+        BaseFeatures1 features;
+
+        // normalized text of gbdhash() keeps the token text of the file ("+1", "01")
+        void hash(const char* data, uint64_t end, bool ends_file) {
+            NormalizedText normalized(data + offset, data + end, filename_, text, ends_file);
+            std::string stage;
+            stage.reserve(stage_size + 32);
+            bool more = true;
+            while (more) {
+                more = normalized.read(stage, stage_size);
+                md5.update(stage.data(), stage.size());
+                stage.clear();
+            }
+            text = normalized.state();
+        }
+
+     public:
+        explicit IncrementalState(const char* filename) : filename_(filename), features(filename) {
+            XXH3_64bits_reset(&prefix);
+        }
+
+        /**
+         * @brief continue the state stored in path if it belongs to a prefix of the given file
+         * The stored checksum is compared with the checksum of all bytes of data before the stored position.
+         * @return false if there is no such state, this state is unchanged then
+         */
+        bool load(const std::string& path, const char* data, uint64_t size) {
+            try {
+                StateFile::Reader in(path, "incremental", version);
+                uint64_t stored_offset, stored_check;
+                in.get(stored_offset);
+                in.get(stored_check);
+                if (stored_offset > size) return false;
+                IncrementalState state(filename_);
+                XXH3_64bits_update(&state.prefix, data, stored_offset);
+                if (XXH3_64bits_digest(&state.prefix) != stored_check) return false;
+                in.get(state.md5);
+                in.get(state.text.in_clause);
+                in.get(state.text.notfirst);
+                in.get(state.pending);
+                state.features.load(in);
+                offset = stored_offset;
+                prefix_check = stored_check;
+                XXH3_copyState(&prefix, &state.prefix);
+                md5 = state.md5;
+                text = state.text;
+                pending = std::move(state.pending);
+                features = std::move(state.features);
+                return true;
+            }
+            catch (const std::runtime_error&) {
+                return false;
+            }
+        }
+
+        void save(const std::string& path) const {
+            StateFile::Writer out(path, "incremental", version);
+            out.put(offset);
+            out.put(prefix_check);
+            out.put(md5);
+            out.put(text.in_clause);
+            out.put(text.notfirst);
+            out.put(pending);
+            features.save(out);
+            out.commit();
+        }
+
+        /**
+         * @brief parse data[offset..end), which has to start at the beginning of a line
+         * @param advance move the stored position to end, which has to be the beginning of a line,
+         * otherwise end has to be the end of the file (followed by a zero byte)
+         */
+        void parse(const char* data, uint64_t end, bool advance) {
+            const char* cur = data + offset;
+            const char* last = data + end;
+            while (cur < last) {
+                const char* stop = last;
+                if (static_cast<uint64_t>(last - cur) > piece_size) {
+                    const void* eol = std::memchr(cur + piece_size, '\n', last - cur - piece_size);
+                    if (eol != nullptr) stop = static_cast<const char*>(eol) + 1;
+                }
+                ParallelDimacs::Chunk chunk = ParallelDimacs::parse(cur, stop, filename_);
+                ParallelDimacs::continue_clause(chunk.skipped, !pending.empty(), filename_);
+                auto lit = chunk.literals.begin();
+                for (unsigned length : chunk.sizes) {
+                    pending.insert(pending.end(), lit, lit + length);
+                    lit += length;
+                    features.consume(pending);
+                    pending.clear();
+                }
+                pending.insert(pending.end(), chunk.tail.begin(), chunk.tail.end());
+                cur = stop;
+            }
+            hash(data, end, !advance);
+            if (advance) {
+                XXH3_64bits_update(&prefix, data + offset, end - offset);
+                prefix_check = XXH3_64bits_digest(&prefix);
+                offset = end;
+            }
+        }
+
+        uint64_t position() const {
+            return offset;
+        }
+
+        /**
+         * @brief consume the unterminated last clause and compute the results, the state can not be continued afterwards
+         * @pre the end of the file was parsed
+         */
+        IncrementalResult finish() {
+            if (!pending.empty()) features.consume(pending);
+            pending.clear();
+            features.finalize();
+            IncrementalResult result;
+            result.gbdhash = md5.digest();
+            result.names = features.getNames();
+            result.features = features.getFeatures();
+            return result;
+        }
+    };
+
+    /**
+     * @brief gbdhash() and base features (BaseFeatures1) of a plain DIMACS file which grows by appending clauses.
+     * The state after the last complete line is stored in state_file, the next call only parses the bytes appended since then.
+     * If the file was modified otherwise (detected by a checksum of all bytes before the stored position, which is much
+     * cheaper than parsing them), or if the state file is missing or incompatible, the whole file is parsed.
+     * @param filename uncompressed DIMACS file
+     * @param state_file sidecar file, replaced atomically
+     * @throw std::runtime_error if the file is not an uncompressed DIMACS file
+     */
+    IncrementalResult incremental(const char* filename, const std::string& state_file) {
+        if (!ParallelDimacs::supported(filename)) {
+            throw std::runtime_error(std::string("Incremental update needs an uncompressed DIMACS file: ") + filename);
+        }
+        int fd = open(filename, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) close(fd);
+            throw ParserException(std::string("Error opening file: ") + filename);
+        }
+        const uint64_t size = st.st_size;
+        // reserve at least one zero byte behind the file content, which ends an unterminated last number
+        const size_t page_size = sysconf(_SC_PAGESIZE);
+        const size_t mapped = (size / page_size + 1) * page_size;
+        void* region = mmap(nullptr, mapped, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region != MAP_FAILED && size > 0 && mmap(region, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            munmap(region, mapped);
+            region = MAP_FAILED;
+        }
+        close(fd);
+        if (region == MAP_FAILED) {
+            throw ParserException(std::string("Error mapping file: ") + filename);
+        }
+        const char* data = static_cast<const char*>(region);
+        try {
+            IncrementalState state(filename);
+            const bool resumed = state.load(state_file, data, size);
+            const uint64_t start = state.position();
+            // complete lines are stored, the last one may still be continued
+            uint64_t end = size;
+            while (end > start && data[end - 1] != '\n') --end;
+            state.parse(data, end, true);
+            state.save(state_file);
+            state.parse(data, size, false);
+            IncrementalResult result = state.finish();
+            result.bytes_parsed = size - start;
+            result.resumed = resumed;
+            munmap(region, mapped);
+            return result;
+        }
+        catch (...) {
+            munmap(region, mapped);
+            throw;
+        }
+    }
+} // namespace CNF
+
+#endif  // INCREMENTAL_H_
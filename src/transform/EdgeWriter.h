@@ -0,0 +1,136 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_TRANSFORM_EDGEWRITER_H_
+#define SRC_TRANSFORM_EDGEWRITER_H_
+
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "src/util/BinaryCNF.h"
+#include "src/util/BufferedWriter.h"
+#include "src/util/StreamCompressor.h"
+
+/**
+ * @brief write line consisting of prefix, node a, space, node b and suffix
+ */
+inline void write_edge(BufferedWriter& out, const char* prefix, unsigned a, unsigned b, const char* suffix) {
+    out.write(prefix, std::char_traits<char>::length(prefix));
+    out.writeInt(a);
+    out.put(' ');
+    out.writeInt(b);
+    out.write(suffix, std::char_traits<char>::length(suffix));
+}
+
+/**
+ * @brief Buffered output of the graph transformers to stdout, a plain file or a compressed file (.xz, .zst)
+ * 
+ * Graphs are written either as text, one line per edge, or in the binary CSR format:
+ * - magic "GBDCCSR1", number of nodes and number of edges as little-endian uint64
+ * - offsets: n_nodes + 1 little-endian uint64, targets of node i are at [offsets[i-1], offsets[i])
+ * - targets: n_edges little-endian uint32 node ids, nodes are numbered from 1
+ */
+class EdgeWriter {
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> file;
+    std::unique_ptr<StreamCompressor> compressor;
+    std::unique_ptr<BufferedWriter> writer;
+    BufferedWriter* out;
+
+ public:
+    static constexpr char csr_magic[8] = { 'G', 'B', 'D', 'C', 'C', 'S', 'R', '1' };
+
+    /**
+     * @param output output file, compressed if it ends with .xz or .zst, stdout if nullptr
+     */
+    explicit EdgeWriter(const char* output = nullptr) : file(nullptr, &std::fclose) {
+        if (output != nullptr && StreamCompressor::is_compressed(output)) {
+            compressor = std::make_unique<StreamCompressor>(output);
+            out = &compressor->buffer();
+            return;
+        }
+        if (output != nullptr) {
+            file.reset(std::fopen(output, "w"));
+            if (!file) {
+                throw std::runtime_error(std::string("Could not open ") + output);
+            }
+        }
+        writer = std::make_unique<BufferedWriter>(BufferedWriter::to_file(output != nullptr ? file.get() : stdout));
+        out = writer.get();
+    }
+
+    BufferedWriter& text() {
+        return *out;
+    }
+
+    void edge(const char* prefix, unsigned a, unsigned b, const char* suffix) {
+        write_edge(*out, prefix, a, b, suffix);
+    }
+
+    /**
+     * @brief write CSR header and offsets, targets have to follow in order of their source nodes
+     * @param degree out-degree of each node, degree[0] belongs to node 1
+     */
+    void begin_csr(const std::vector<uint64_t>& degree) {
+        unsigned char bytes[8];
+        out->write(csr_magic, 8);
+        uint64_t n_edges = 0;
+        for (uint64_t d : degree) n_edges += d;
+        BinaryCNF::Header::put(bytes, degree.size(), 8);
+        out->write(reinterpret_cast<const char*>(bytes), 8);
+        BinaryCNF::Header::put(bytes, n_edges, 8);
+        out->write(reinterpret_cast<const char*>(bytes), 8);
+        uint64_t offset = 0;
+        BinaryCNF::Header::put(bytes, offset, 8);
+        out->write(reinterpret_cast<const char*>(bytes), 8);
+        for (uint64_t d : degree) {
+            offset += d;
+            BinaryCNF::Header::put(bytes, offset, 8);
+            out->write(reinterpret_cast<const char*>(bytes), 8);
+        }
+    }
+
+    void target(unsigned node) {
+        unsigned char bytes[4];
+        BinaryCNF::Header::put(bytes, node, 4);
+        out->write(reinterpret_cast<const char*>(bytes), 4);
+    }
+
+    /**
+     * @brief flush buffered output and close the file
+     * @throw std::runtime_error or StreamCompressorException if writing fails
+     */
+    void close() {
+        if (compressor) {
+            compressor->close();
+            return;
+        }
+        writer->flush();
+        if (std::fflush(file ? file.get() : stdout) != 0) {
+            throw std::runtime_error("Error writing output");
+        }
+        if (file && std::fclose(file.release()) != 0) {
+            throw std::runtime_error("Error closing output");
+        }
+    }
+};
+
+#endif  // SRC_TRANSFORM_EDGEWRITER_H_
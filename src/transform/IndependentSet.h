@@ -20,48 +20,141 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #ifndef SRC_TRANSFORM_INDEPENDENTSET_H_
 #define SRC_TRANSFORM_INDEPENDENTSET_H_
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
-#include <fstream>
 #include <memory>
 
 #include <stdexcept>
-#include "src/util/CNFFormula.h"
+#include "src/util/BinaryCNF.h"
+#include "src/util/ExternalCNFFormula.h"
+#include "src/util/ResourceBudget.h"
+#include "src/transform/EdgeWriter.h"
 
+/**
+ * @brief Generates the k-independent set problem of a CNF formula without keeping the formula in memory
+ * - first pass over the input counts nodes, edges and literal occurrences
+ * - generation streams the cliques from the input and collects the node ids of each literal
+ *   in a compact occurrence map (CSR), opposite-literal edges are generated from that map
+ * - clauses are normalized like in CNFFormula: sorted literals, no duplicates, no tautologies
+ * - optionally, the normalized clauses are spilled to a temporary file in the first pass,
+ *   such that the input is parsed (and decompressed) only once
+ */
 class IndependentSetFromCNF {
  private:
-    CNFFormula F;
-    std::vector<std::vector<unsigned>> literal2nodes;
+    std::string filename_;
+    std::unique_ptr<ClauseSpill> spill;  // normalized clauses, if enabled
 
+    std::vector<unsigned> offsets;  // node ids of literal lit are nodes[offsets[lit], offsets[lit+1])
+    std::vector<unsigned> nodes;
+
+    unsigned nVars;
     unsigned nNodes;
-    unsigned nEdges;
+    uint64_t nEdges;  // exceeds 32 bits on instances with many occurrences
     unsigned k;
 
- public:
-    explicit IndependentSetFromCNF(const char* filename) : F(), literal2nodes(), nNodes(0), nEdges(0) {
-        F.readDimacsFromFile(filename);
-        literal2nodes.resize(2 * F.nVars() + 2);
+    /**
+     * @brief sorts the literals and removes duplicates
+     * @return false for tautologies
+     */
+    static bool normalize(Cl& clause) {
+        if (clause.empty()) return true;
+        std::sort(clause.begin(), clause.end());
+        auto it = clause.begin();
+        for (auto jt = clause.begin() + 1; jt != clause.end(); ++jt) {
+            if (*it != *jt) {  // unique
+                if (it->var() == jt->var()) {
+                    return false;  // no tautologies
+                }
+                *++it = *jt;
+            }
+        }
+        clause.erase(it + 1, clause.end());
+        return true;
+    }
+
+    template <typename Visitor>
+    void for_each_clause(Visitor visit) const {
+        if (spill) {
+            spill->for_each(visit);
+            return;
+        }
+        ClauseReader in(filename_.c_str());
+        Cl clause;
+        while (in.readClause(clause)) {
+            if (normalize(clause)) visit(clause);
+        }
+    }
+
+    /**
+     * @brief stores the node ids of each literal, node ids are assigned in order of clauses and literals
+     * @param visit called for each clause with the node id of its first literal
+     */
+    template <typename Visitor>
+    void collect_nodes(Visitor visit) {
+        std::vector<unsigned> next(offsets.begin(), offsets.end() - 1);
+        nodes.assign(nNodes, 0);
         unsigned nodeId = 1;
-        for (Cl* clause : F) {
-            nNodes += clause->size();  // one node per literal occurence
-            nEdges += (clause->size() * (clause->size() - 1)) / 2;  // number of edges in clique
-            for (unsigned i = 0; i < clause->size(); i++) {
-                literal2nodes[(*clause)[i]].push_back(nodeId + i);  // remember nodeids of literals
+        for_each_clause([&] (const Cl& clause) {
+            for (unsigned i = 0; i < clause.size(); i++) {
+                nodes[next[clause[i]]++] = nodeId + i;  // remember nodeids of literals
+            }
+            visit(clause, nodeId);
+            nodeId += clause.size();
+        });
+    }
+
+    unsigned count(Lit lit) const {
+        return offsets[lit + 1] - offsets[lit];
+    }
+
+ public:
+    /**
+     * @param external spill the normalized clauses to a temporary file instead of parsing the input in every pass
+     */
+    explicit IndependentSetFromCNF(const char* filename, bool external = false) : filename_(filename), nVars(0), nNodes(0), nEdges(0), k(0) {
+        std::unique_ptr<ClauseSpill> first_pass;
+        if (external) first_pass = std::make_unique<ClauseSpill>();
+        std::vector<unsigned> occurrences;
+        for_each_clause([&] (const Cl& clause) {
+            if (first_pass) first_pass->add(clause);
+            const unsigned size = clause.size();
+            nNodes += size;  // one node per literal occurence
+            nEdges += (static_cast<uint64_t>(size) * (size - 1)) / 2;  // number of edges in clique
+            if (size > 0) {
+                nVars = std::max(nVars, static_cast<unsigned>(clause.back().var()));
+                if (occurrences.size() < 2 * nVars + 2) occurrences.resize(std::max(2 * nVars + 2, 2 * static_cast<unsigned>(occurrences.size())), 0);
+            }
+            for (Lit lit : clause) {
+                ++occurrences[lit];
             }
-            nodeId += clause->size();
+            ++k;
+        });
+        if (first_pass) {
+            first_pass->finish();
+            spill = std::move(first_pass);
         }
-        for (unsigned i = 1; i <= F.nVars(); i++) {  // count edges between nodes for opposite literals
-            nEdges += literal2nodes[Lit(Var(i), false)].size() * literal2nodes[Lit(Var(i), true)].size();
+        occurrences.resize(2 * nVars + 2);
+        for (unsigned i = 1; i <= nVars; i++) {  // count edges between nodes for opposite literals
+            nEdges += static_cast<uint64_t>(occurrences[Lit(Var(i), false)]) * occurrences[Lit(Var(i), true)];
         }
         nEdges *= 2;  // account for reflexivity
-        k = F.nClauses();
+        offsets.assign(occurrences.size() + 1, 0);
+        for (size_t lit = 0; lit < occurrences.size(); lit++) {
+            offsets[lit + 1] = offsets[lit] + occurrences[lit];
+        }
     }
 
     unsigned numNodes() {
         return nNodes;
     }
 
-    unsigned numEdges() {
+    uint64_t numEdges() {
         return nEdges;
     }
 
@@ -69,47 +162,201 @@ class IndependentSetFromCNF {
         return k;
     }
 
-    void generate_independent_set_problem(const char* output = nullptr) {
-        std::shared_ptr<std::ostream> of;
-        if (output != nullptr) {
-            of.reset(new std::ofstream(output, std::ofstream::out));
+    /**
+     * @brief Writes the k-independent set problem, each edge is written in both directions
+     * @param output output file, compressed if it ends with .xz or .zst, stdout if nullptr
+     * @param csr binary CSR format (see EdgeWriter) instead of text
+     * @param threads number of threads formatting opposite-literal edges of text output
+     */
+    void generate_independent_set_problem(const char* output = nullptr, bool csr = false, unsigned threads = 1) {
+        EdgeWriter of(output);
+        if (csr) {
+            write_csr(of);
         } else {
-            of.reset(&std::cout, [](...){});
+            write_edges(of, threads);
         }
+        of.close();
+    }
 
-        *of << "c satisfiable iff maximum independent set size is " << k << std::endl;
-        *of << "c kis nNodes nEdges k" << std::endl;
-        *of << "p kis " << nNodes << " " << nEdges << " " << k << std::endl;
+ private:
+    void write_edges(EdgeWriter& of, unsigned threads) {
+        of.text().write("c satisfiable iff maximum independent set size is " + std::to_string(k) + "\n");
+        of.text().write("c kis nNodes nEdges k\n");
+        of.text().write("p kis " + std::to_string(nNodes) + " " + std::to_string(nEdges) + " " + std::to_string(k) + "\n");
 
         // generate cliques
-        unsigned nodeId = 1;
-        for (Cl* clause : F) {
-            for (unsigned i = 0; i < clause->size(); i++) {
+        collect_nodes([&] (const Cl& clause, unsigned nodeId) {
+            for (unsigned i = 0; i < clause.size(); i++) {
                 unsigned var1 = nodeId + i;
-                for (unsigned j = i + 1; j < clause->size(); j++) {
+                for (unsigned j = i + 1; j < clause.size(); j++) {
                     unsigned var2 = nodeId + j;
-                    *of << var1 << " " << var2 << " 0" << std::endl;
-                    *of << var2 << " " << var1 << " 0" << std::endl;
+                    of.edge("", var1, var2, " 0\n");
+                    of.edge("", var2, var1, " 0\n");
                 }
             }
-            if (of->bad()) {
-                throw std::runtime_error("Bad output stream");
+        });
+
+        // generate edges between nodes for opposite literals
+        if (threads > 1) {
+            write_opposite_edges(of, threads);
+            return;
+        }
+        for (unsigned i = 1; i <= nVars; i++) {
+            write_opposite_edges(of.text(), Lit(Var(i), false), offsets[Lit(Var(i), false)], offsets[Lit(Var(i), false) + 1]);
+        }
+    }
+
+    /**
+     * @brief edges between the given range of nodes of positive literal pos and all nodes of its negation
+     */
+    void write_opposite_edges(BufferedWriter& out, Lit pos, unsigned from, unsigned to) const {
+        const Lit neg = ~pos;
+        for (unsigned p = from; p < to; p++) {
+            for (unsigned n = offsets[neg]; n < offsets[neg + 1]; n++) {
+                write_edge(out, "", nodes[p], nodes[n], " 0\n");
+                write_edge(out, "", nodes[n], nodes[p], " 0\n");
+            }
+        }
+    }
+
+    /**
+     * @brief formats chunks of opposite-literal edges on threads workers, chunks are written in order
+     * such that the output is identical to the sequential one
+     * Worker t formats the chunks t, t + threads, ... and hands each of them over in its own slot,
+     * it starts the next chunk only after the calling thread wrote the previous one,
+     * so at most threads chunks are in flight.
+     */
+    void write_opposite_edges(EdgeWriter& of, unsigned threads) const {
+        struct Range { Lit pos; unsigned from; unsigned to; };
+        const uint64_t chunk_edges = 1 << 15;
+
+        // chunk k consists of ranges[bounds[k]] to ranges[bounds[k + 1] - 1]
+        std::vector<Range> ranges;
+        std::vector<size_t> bounds { 0 };
+        uint64_t n_edges = 0;
+        for (unsigned i = 1; i <= nVars; i++) {
+            const Lit pos(Var(i), false);
+            const uint64_t n_neg = count(~pos);
+            if (n_neg == 0) continue;
+            // split the nodes of literals with many occurrences over several chunks
+            for (unsigned from = offsets[pos]; from < offsets[pos + 1]; ) {
+                const uint64_t n_pos = std::max<uint64_t>(1, (chunk_edges - n_edges) / n_neg);
+                const unsigned to = std::min<uint64_t>(offsets[pos + 1], from + n_pos);
+                ranges.push_back({ pos, from, to });
+                n_edges += (to - from) * n_neg;
+                from = to;
+                if (n_edges >= chunk_edges) {
+                    bounds.push_back(ranges.size());
+                    n_edges = 0;
+                }
             }
-            nodeId += clause->size();
         }
+        if (bounds.back() < ranges.size()) bounds.push_back(ranges.size());
+        const size_t n_chunks = bounds.size() - 1;
 
-        // generate edges between nodes for opposite literals
-        for (unsigned i = 1; i <= F.nVars(); i++) {
-            for (unsigned node1 : literal2nodes[Lit(Var(i), false)]) {
-                for (unsigned node2 : literal2nodes[Lit(Var(i), true)]) {
-                    *of << node1 << " " << node2 << " 0" << std::endl;
-                    *of << node2 << " " << node1 << " 0" << std::endl;
+        struct Slot {
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::string text;
+            std::exception_ptr error;
+            bool full = false;
+        };
+        std::vector<Slot> slots(threads);
+        std::atomic<bool> abort(false);
+        std::vector<std::unique_ptr<ResourceBudget>> budgets;
+        for (unsigned t = 0; t < threads; ++t) {
+            budgets.push_back(std::make_unique<ResourceBudget>(ResourceBudget::current()));
+        }
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] () {
+                ResourceBudget::Scope scope(*budgets[t]);
+                Slot& slot = slots[t];
+                std::string text;
+                for (size_t k = t; k < n_chunks; k += threads) {
+                    {
+                        std::unique_lock<std::mutex> lock(slot.mutex);
+                        slot.cv.wait(lock, [&] { return !slot.full || abort; });
+                        if (abort) return;
+                    }
+                    std::exception_ptr error;
+                    try {
+                        text.clear();
+                        BufferedWriter out([&text] (const char* data, size_t size) { text.append(data, size); }, 1 << 16);
+                        for (size_t r = bounds[k]; r < bounds[k + 1]; ++r) {
+                            write_opposite_edges(out, ranges[r].pos, ranges[r].from, ranges[r].to);
+                        }
+                        out.flush();
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(slot.mutex);
+                        std::swap(slot.text, text);
+                        slot.error = error;
+                        slot.full = true;
+                    }
+                    slot.cv.notify_all();
+                    if (error) return;
                 }
+            });
+        }
+
+        std::exception_ptr error;
+        std::string text;
+        for (size_t k = 0; k < n_chunks && !error; ++k) {
+            Slot& slot = slots[k % threads];
+            {
+                std::unique_lock<std::mutex> lock(slot.mutex);
+                slot.cv.wait(lock, [&slot] { return slot.full; });
+                std::swap(text, slot.text);
+                error = slot.error;
+                slot.full = false;
+            }
+            slot.cv.notify_all();
+            if (error) break;
+            try {
+                of.text().write(text);
+            } catch (...) {
+                error = std::current_exception();
             }
-            if (of->bad()) {
-                throw std::runtime_error("Bad output stream");
+        }
+        if (error) {
+            abort = true;
+            for (Slot& slot : slots) {
+                { std::lock_guard<std::mutex> lock(slot.mutex); }
+                slot.cv.notify_all();
             }
         }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+    void write_csr(EdgeWriter& of) {
+        // neighbours of a node are the other nodes of its clause and the nodes of the opposite literal
+        std::vector<uint64_t> degree;
+        degree.reserve(nNodes);
+        collect_nodes([&] (const Cl& clause, unsigned) {
+            for (Lit lit : clause) {
+                degree.push_back(clause.size() - 1 + count(~lit));
+            }
+        });
+        of.begin_csr(degree);
+        unsigned nodeId = 1;
+        for_each_clause([&] (const Cl& clause) {
+            for (unsigned i = 0; i < clause.size(); i++) {
+                for (unsigned j = 0; j < clause.size(); j++) {
+                    if (j != i) of.target(nodeId + j);
+                }
+                const Lit opposite = ~clause[i];
+                for (unsigned n = offsets[opposite]; n < offsets[opposite + 1]; n++) {
+                    of.target(nodes[n]);
+                }
+            }
+            nodeId += clause.size();
+        });
     }
 };
 
@@ -20,42 +20,87 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #ifndef SRC_TRANSFORM_NORMALIZE_H_
 #define SRC_TRANSFORM_NORMALIZE_H_
 
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <vector>
 #include <algorithm>
 
+#include "src/util/BufferedWriter.h"
+#include "src/util/ParallelDimacs.h"
+#include "src/util/SolverTypes.h"
+#include "src/util/Stamp.h"
 #include "src/util/StreamBuffer.h"
+#include "src/util/StreamCompressor.h"
 
 
-void determine_counts(const char* filename, int& nvars, int& nclauses) {
-    StreamBuffer in(filename);
-    nvars = 0; 
-    nclauses = 0;
-    while (in.skipWhitespace()) {
-        if (*in == 'c' || *in == 'p') {
-            if (!in.skipLine()) break;
-        } else {
-            int plit;
-            while (in.readInteger(&plit)) {
-                if (plit == 0) break;
-                nvars = std::max(abs(plit), nvars);
-            }
-            nclauses++;
+/**
+ * @brief Writes the header followed by the spooled body
+ * @param header problem line including newline
+ * @param body temporary file holding the clauses
+ * @param output output file, compressed if it ends with .xz or .zst, stdout if nullptr
+ */
+void write_spooled(const std::string& header, std::FILE* body, const char* output) {
+    if (std::fflush(body) != 0) {
+        throw std::runtime_error("Error writing temporary file");
+    }
+    const size_t body_size = std::ftell(body);
+    std::rewind(body);
+    std::unique_ptr<char[]> chunk(new char[1 << 20]);
+    if (output != nullptr && StreamCompressor::is_compressed(output)) {
+        StreamCompressor cmpr(output, header.size() + body_size);
+        cmpr.write(header.data(), header.size());
+        while (size_t n = std::fread(chunk.get(), 1, 1 << 20, body)) {
+            cmpr.write(chunk.get(), n);
+        }
+        cmpr.close();
+        return;
+    }
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> file(nullptr, &std::fclose);
+    if (output != nullptr) {
+        file.reset(std::fopen(output, "w"));
+        if (!file) {
+            throw std::runtime_error(std::string("Could not open ") + output);
         }
     }
+    std::FILE* out = output != nullptr ? file.get() : stdout;
+    BufferedWriter::Sink sink = BufferedWriter::to_file(out);
+    sink(header.data(), header.size());
+    while (size_t n = std::fread(chunk.get(), 1, 1 << 20, body)) {
+        sink(chunk.get(), n);
+    }
+    if (std::fflush(out) != 0) {
+        throw std::runtime_error("Error writing output");
+    }
+}
+
+/**
+ * @brief Temporary file which holds the clauses until the header is known
+ */
+std::unique_ptr<std::FILE, decltype(&std::fclose)> open_spool() {
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> spool(std::tmpfile(), &std::fclose);
+    if (!spool) {
+        throw std::runtime_error("Could not create temporary file");
+    }
+    return spool;
 }
 
 /**
  * @brief Normalizes a CNF formula by removing comments and 
  * generating a header based on the real number of clauses
  * and the maximum variable index.
+ * The input is parsed once, clauses are spooled to a temporary file until the header is known.
  * 
  * @param filename 
+ * @param output output file, compressed if it ends with .xz or .zst, stdout if nullptr
  */
-void normalize(const char* filename) {
+void normalize(const char* filename, const char* output = nullptr) {
     StreamBuffer in(filename);
-    int vars, clauses;
-    determine_counts(filename, vars, clauses);
-    std::cout << "p cnf " << vars << " " << clauses << std::endl;
+    auto spool = open_spool();
+    BufferedWriter body(BufferedWriter::to_file(spool.get()));
+    int vars = 0, clauses = 0;
     while (in.skipWhitespace()) {
         if (*in == 'c' || *in == 'p') {
             if (!in.skipLine()) break;
@@ -63,94 +108,220 @@ void normalize(const char* filename) {
             int plit;
             while (in.readInteger(&plit)) {
                 if (plit == 0) break;
-                std::cout << plit << " ";
+                vars = std::max(abs(plit), vars);
+                body.writeInt(plit);
+                body.put(' ');
             }
-            std::cout << "0" << std::endl;
+            body.write("0\n", 2);
+            clauses++;
+        }
+    }
+    body.flush();
+    write_spooled("p cnf " + std::to_string(vars) + " " + std::to_string(clauses) + "\n", spool.get(), output);
+}
+
+/**
+ * @brief Removes duplicate literals from clauses and detects tautologies,
+ * the literal marks grow with the largest variable seen
+ */
+class ClauseSanitizer {
+    Stamp<unsigned> mask;  // indexed by literal
+
+    void grow(const Cl& clause) {
+        for (Lit lit : clause) {
+            const size_t index = static_cast<unsigned>(lit);
+            if (index + 2 > mask.size()) mask.grow(std::max(index + 2, 2 * mask.size()));
+        }
+    }
+
+ public:
+    /**
+     * @brief removes duplicate literals, the order of first occurrences is preserved
+     * @return false if the clause is tautological
+     */
+    bool sanitize(Cl& clause) {
+        grow(clause);
+        mask.clear();
+        size_t n = 0;
+        for (size_t i = 0; i < clause.size(); ++i) {
+            const Lit lit = clause[i];
+            if (mask[~lit]) return false;
+            if (mask.insert(lit)) clause[n++] = lit;
+        }
+        clause.resize(n);
+        return true;
+    }
+
+    /**
+     * @return true if the clause contains neither duplicate nor complementary literals
+     */
+    bool check(const Cl& clause) {
+        grow(clause);
+        mask.clear();
+        for (Lit lit : clause) {
+            if (mask[~lit] || !mask.insert(lit)) return false;
         }
+        return true;
     }
+};
+
+void write_clause(BufferedWriter& out, const Cl& clause) {
+    for (Lit lit : clause) {
+        const int var = lit.var();
+        out.writeInt(lit.sign() ? -var : var);
+        out.put(' ');
+    }
+    out.write("0\n", 2);
+}
+
+unsigned max_var(const Cl& clause, unsigned vars = 0) {
+    for (Lit lit : clause) vars = std::max(vars, static_cast<unsigned>(lit.var()));
+    return vars;
 }
 
 /**
  * @brief Sanitizes a CNF formula by removing comments and generating a normalized header.
  * Removes duplicate literals from clauses and removes tautological clauses while preserving
- * the order of clauses and literals.
+ * the order of clauses and literals. The number of variables in the header is the largest variable of the input.
+ * The input is parsed once, clauses are spooled to a temporary file until the header is known.
+ * Plain input files are sanitized in chunks on worker threads if threads > 1, the output does not depend on threads.
  * 
  * @param filename
+ * @param output output file, compressed if it ends with .xz or .zst, stdout if nullptr
+ * @param threads number of worker threads
  */
-void sanitize(const char* filename) {
-    StreamBuffer in(filename);
-
-    int vars, clauses;
-    determine_counts(filename, vars, clauses);
-    std::cout << "p cnf " << vars << " " << clauses << std::endl;
-
-    // set mask[lit] to clause number if lit is present in clause
-    int* mask = (int*)calloc(2*vars + 2, sizeof(int));
-    mask += vars + 1;
+void sanitize(const char* filename, const char* output = nullptr, unsigned threads = 1) {
+    auto spool = open_spool();
+    BufferedWriter body(BufferedWriter::to_file(spool.get()));
+    ClauseSanitizer sanitizer;
+    unsigned vars = 0, clauses = 0;
+    auto emit = [&] (Cl& clause) {
+        vars = max_var(clause, vars);
+        if (sanitizer.sanitize(clause)) {
+            write_clause(body, clause);
+            ++clauses;
+        }
+    };
 
-    std::vector<int> clause;
-    unsigned stamp = 0;
-    while (in.skipWhitespace()) {
-        if (*in == 'c' || *in == 'p') {
-            if (!in.skipLine()) break;
-        } else {
-            ++stamp;
-            bool tautological = false;
-            int plit;
-            while (in.readInteger(&plit)) {
-                if (plit == 0) break;
-                if (static_cast<unsigned>(mask[-plit]) == stamp) {
-                    tautological = true;
-                    break;
+    Cl clause;
+    if (threads > 1 && ParallelDimacs::supported(filename)) {
+        // the first clause of a chunk continues the tail of the previous one, it is sanitized when merging
+        struct Sanitized {
+            bool has_head;
+            char skipped;
+            Cl head, tail;
+            std::string text;
+            unsigned vars = 0, clauses = 0;
+        };
+        ParallelDimacs::map_chunks(filename, threads, [] (ParallelDimacs::Chunk&& chunk) {
+            Sanitized result;
+            result.has_head = !chunk.sizes.empty();
+            result.skipped = chunk.skipped;
+            BufferedWriter out([&result] (const char* data, size_t size) { result.text.append(data, size); }, 1 << 16);
+            ClauseSanitizer local;
+            Cl clause;
+            auto lit = chunk.literals.begin();
+            for (size_t i = 0; i < chunk.sizes.size(); ++i) {
+                clause.assign(lit, lit + chunk.sizes[i]);
+                lit += chunk.sizes[i];
+                if (i == 0) {
+                    result.head = clause;
+                    continue;
                 }
-                else if (static_cast<unsigned>(mask[plit]) != stamp) {
-                    mask[plit] = stamp;
-                    clause.push_back(plit);
+                result.vars = max_var(clause, result.vars);
+                if (local.sanitize(clause)) {
+                    write_clause(out, clause);
+                    ++result.clauses;
                 }
             }
-            if (!tautological) {
-                for (int plit : clause) {
-                    std::cout << plit << " ";
-                }
-                std::cout << "0" << std::endl;
+            out.flush();
+            result.tail = std::move(chunk.tail);
+            return result;
+        }, [&] (Sanitized&& chunk) {
+            ParallelDimacs::continue_clause(chunk.skipped, !clause.empty(), filename);
+            if (!chunk.has_head) {
+                clause.insert(clause.end(), chunk.tail.begin(), chunk.tail.end());
+                return true;
             }
-            clause.clear();
-        }
+            clause.insert(clause.end(), chunk.head.begin(), chunk.head.end());
+            emit(clause);
+            body.write(chunk.text);
+            vars = std::max(vars, chunk.vars);
+            clauses += chunk.clauses;
+            clause = std::move(chunk.tail);
+            return true;
+        });
+        // last clause is not terminated
+        if (!clause.empty()) emit(clause);
+    } else {
+        StreamBuffer in(filename);
+        while (in.readClause(clause)) emit(clause);
     }
+    body.flush();
+    write_spooled("p cnf " + std::to_string(vars) + " " + std::to_string(clauses) + "\n", spool.get(), output);
 }
 
 
 /**
- * @brief Checks if a CNF formula is already sanitized.
+ * @brief Checks if a CNF formula is already sanitized, stops at the first violation.
+ * Plain input files are checked in chunks on worker threads if threads > 1.
  * 
  * @param filename 
+ * @param threads number of worker threads
  * @return true if neither duplicate literals nor tautological clauses are present
  * @return false otherwise
  */
-bool check_sanitized(const char* filename) {
-    StreamBuffer in(filename);
-
-    int vars, clauses;
-    determine_counts(filename, vars, clauses);
-    
-    // set mask[lit] to clause number if lit is present in clause
-    int* mask = (int*)calloc(2*vars + 2, sizeof(int));
-    mask += vars + 1;
-
-    unsigned stamp = 0;
-    while (in.skipWhitespace()) {
-        if (*in == 'c' || *in == 'p') {
-            if (!in.skipLine()) break;
-        } else {
-            ++stamp;
-            int plit;
-            while (in.readInteger(&plit)) {
-                if (plit == 0) break;
-                if (static_cast<unsigned>(mask[plit]) == stamp || static_cast<unsigned>(mask[-plit]) == stamp) {
-                    return false;
-                }
+bool check_sanitized(const char* filename, unsigned threads = 1) {
+    ClauseSanitizer sanitizer;
+    Cl clause;
+    if (threads > 1 && ParallelDimacs::supported(filename)) {
+        struct Checked {
+            bool clean = true, has_head;
+            char skipped;
+            Cl head, tail;
+        };
+        std::atomic<bool> violated(false);
+        ParallelDimacs::map_chunks(filename, threads, [&violated] (ParallelDimacs::Chunk&& chunk) {
+            Checked result;
+            result.has_head = !chunk.sizes.empty();
+            result.skipped = chunk.skipped;
+            ClauseSanitizer local;
+            Cl clause;
+            auto lit = chunk.literals.begin();
+            for (size_t i = 0; i < chunk.sizes.size() && result.clean; ++i) {
+                clause.assign(lit, lit + chunk.sizes[i]);
+                lit += chunk.sizes[i];
+                if (i == 0) result.head = clause;
+                else if (!local.check(clause)) result.clean = false;
+                // another chunk already decided the result
+                if ((i & 1023) == 0 && violated.load(std::memory_order_relaxed)) break;
             }
-        }
+            if (!result.clean) violated.store(true, std::memory_order_relaxed);
+            result.tail = std::move(chunk.tail);
+            return result;
+        }, [&] (Checked&& chunk) {
+            ParallelDimacs::continue_clause(chunk.skipped, !clause.empty(), filename);
+            if (!chunk.clean || violated.load(std::memory_order_relaxed)) {
+                violated.store(true, std::memory_order_relaxed);
+                return false;
+            }
+            if (!chunk.has_head) {
+                clause.insert(clause.end(), chunk.tail.begin(), chunk.tail.end());
+                return true;
+            }
+            clause.insert(clause.end(), chunk.head.begin(), chunk.head.end());
+            if (!sanitizer.check(clause)) {
+                violated.store(true, std::memory_order_relaxed);
+                return false;
+            }
+            clause = std::move(chunk.tail);
+            return true;
+        });
+        return !violated.load() && sanitizer.check(clause);
+    }
+    StreamBuffer in(filename);
+    while (in.readClause(clause)) {
+        if (!sanitizer.check(clause)) return false;
     }
     return true;
 }
@@ -0,0 +1,111 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_TRANSFORM_PACK_H_
+#define SRC_TRANSFORM_PACK_H_
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "src/util/BinaryCNF.h"
+#include "src/util/StreamBuffer.h"
+#include "src/identify/GBDHash.h"
+
+/**
+ * @brief Converts a DIMACS CNF file (possibly compressed) to a packed file
+ * @param filename input file
+ * @param output packed output file
+ * @param index whether to append a clause offset index
+ * @param index_stride number of clauses between two index entries
+ * @return BinaryCNF::Header header of the packed file
+ */
+BinaryCNF::Header pack(const char* filename, const char* output, bool index = false, unsigned index_stride = 1024) {
+    BinaryCNF::Header header;
+    header.gbdhash = CNF::gbdhash(filename);
+    std::ofstream out(output, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error(std::string("Could not open ") + output);
+    }
+    header.write(out);  // placeholder, counts are written when finished
+
+    std::vector<uint64_t> offsets;
+    uint64_t offset = BinaryCNF::Header::size;
+    StreamBuffer in(filename);
+    Cl clause;
+    while (in.readClause(clause)) {
+        if (index && header.n_clauses % index_stride == 0) offsets.push_back(offset);
+        BinaryCNF::write_varint(out, clause.size());
+        for (Lit lit : clause) {
+            BinaryCNF::write_varint(out, lit.x);
+            if (static_cast<uint64_t>(lit.var()) > header.n_vars) header.n_vars = lit.var();
+        }
+        ++header.n_clauses;
+        header.n_literals += clause.size();
+        offset = out.tellp();
+    }
+
+    if (index) {
+        header.flags |= BinaryCNF::flag_index;
+        header.index_offset = offset;
+        header.index_stride = index_stride;
+        unsigned char bytes[8];
+        for (uint64_t off : offsets) {
+            BinaryCNF::Header::put(bytes, off, 8);
+            out.write(reinterpret_cast<const char*>(bytes), 8);
+        }
+    }
+    out.seekp(0);
+    header.write(out);
+    if (!out.flush()) {
+        throw std::runtime_error(std::string("Error writing ") + output);
+    }
+    return header;
+}
+
+/**
+ * @brief Converts a packed file back to DIMACS CNF, clauses and literals keep their order
+ * @param filename packed input file
+ * @param output output file, stdout if nullptr
+ */
+void unpack(const char* filename, const char* output = nullptr) {
+    std::shared_ptr<std::ostream> of;
+    if (output != nullptr) {
+        of.reset(new std::ofstream(output, std::ofstream::out));
+    } else {
+        of.reset(&std::cout, [](...){});
+    }
+    BinaryCNF::Reader in(filename);
+    *of << "p cnf " << in.header().n_vars << " " << in.header().n_clauses << "\n";
+    Cl clause;
+    while (in.readClause(clause)) {
+        for (Lit lit : clause) {
+            *of << lit << " ";
+        }
+        *of << "0\n";
+    }
+    of->flush();
+    if (of->bad()) {
+        throw std::runtime_error("Bad output stream");
+    }
+}
+
+#endif  // SRC_TRANSFORM_PACK_H_
@@ -22,43 +22,101 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 
 #include <string>
 #include <vector>
-#include <fstream>
 #include <memory>
 
 #include "src/util/CNFFormula.h"
+#include "src/transform/EdgeWriter.h"
 
 class BipartiteGraphFromCNF {
  private:
     CNFFormula F;
 
+    // maximum number of variable to clause edges buffered by write_csr()
+    uint64_t window_edges;
+
  public:
-    explicit BipartiteGraphFromCNF(const char* filename) : F() {
+    /**
+     * @param window maximum number of variable to clause edges buffered by the CSR output,
+     * which takes one pass over the formula per window
+     */
+    explicit BipartiteGraphFromCNF(const char* filename, uint64_t window = 1 << 22) : F(), window_edges(window) {
         F.readDimacsFromFile(filename);
     }
 
-    void generate_bipartite_graph(const char* output = nullptr) {
-        std::shared_ptr<std::ostream> of;
-        if (output != nullptr) {
-            of.reset(new std::ofstream(output, std::ofstream::out));
+    /**
+     * @brief Writes the directed bipartite graph, negative literals point from variable to clause,
+     * positive literals point from clause to variable
+     * @param output output file, compressed if it ends with .xz or .zst, stdout if nullptr
+     * @param csr binary CSR format (see EdgeWriter) instead of text
+     */
+    void generate_bipartite_graph(const char* output = nullptr, bool csr = false) {
+        EdgeWriter of(output);
+        if (csr) {
+            write_csr(of);
         } else {
-            of.reset(&std::cout, [](...){});
+            write_edges(of);
         }
+        of.close();
+    }
 
-        *of << "c directed bipartite graph representation from cnf" << std::endl;
-        *of << "p edge " << F.nVars() + F.nClauses() << std::endl;
+ private:
+    void write_edges(EdgeWriter& of) {
+        of.text().write("c directed bipartite graph representation from cnf\n");
+        of.text().write("p edge " + std::to_string(F.nVars() + F.nClauses()) + "\n");
 
         unsigned clause_id = F.nVars() + 1;
-        for (Cl* clause : F) {
+        for (const Clause* clause : F) {
             for (unsigned i = 0; i < clause->size(); i++) {
                 if ((*clause)[i].sign()) {
-                    *of << "e " << (*clause)[i].var() << " " << clause_id << std::endl;
+                    of.edge("e ", (*clause)[i].var(), clause_id, "\n");
                 } else {
-                    *of << "e " << clause_id << " " << (*clause)[i].var() << std::endl;
+                    of.edge("e ", clause_id, (*clause)[i].var(), "\n");
                 }
             }
             clause_id++;
         }
     }
+
+    void write_csr(EdgeWriter& of) {
+        // variables 1..n point to the clauses of their negative literals
+        std::vector<uint64_t> degree(F.nVars() + F.nClauses(), 0);
+        unsigned clause_id = F.nVars() + 1;
+        for (const Clause* clause : F) {
+            for (Lit lit : *clause) {
+                ++degree[lit.sign() ? lit.var() - 1 : clause_id - 1];
+            }
+            clause_id++;
+        }
+        // targets of a window of variables are collected per pass over the formula, at most window_edges are kept in memory
+        std::vector<uint64_t> next(F.nVars() + 1, 0);  // position of the next target of each variable
+        for (unsigned v = 0; v < F.nVars(); v++) {
+            next[v + 1] = next[v] + degree[v];
+        }
+        of.begin_csr(degree);
+        std::vector<unsigned> window;
+        for (unsigned lo = 0, hi = 0; lo < F.nVars(); lo = hi) {
+            while (hi < F.nVars() && (hi == lo || next[hi + 1] - next[lo] <= window_edges)) hi++;
+            const uint64_t first = next[lo];
+            window.resize(next[hi] - first);
+            clause_id = F.nVars() + 1;
+            for (const Clause* clause : F) {
+                for (Lit lit : *clause) {
+                    const unsigned v = lit.var() - 1;
+                    if (lit.sign() && v >= lo && v < hi) window[next[v]++ - first] = clause_id;
+                }
+                clause_id++;
+            }
+            for (unsigned target : window) {
+                of.target(target);
+            }
+        }
+        // clauses point to the variables of their positive literals
+        for (const Clause* clause : F) {
+            for (Lit lit : *clause) {
+                if (!lit.sign()) of.target(lit.var());
+            }
+        }
+    }
 };
 
 #endif  // SRC_TRANSFORM_BIP_H_
@@ -0,0 +1,158 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_ARCHIVEDECODER_H_
+#define SRC_UTIL_ARCHIVEDECODER_H_
+
+#include <archive.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Decompresses an archive on a separate thread into a single-producer single-consumer ring of chunks
+ * Ring indices are atomics, the mutex is only taken to sleep while the ring is full (decoder) or empty (reader).
+ */
+class ArchiveDecoder {
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size = 0;
+        bool last = false;  // end of data or error
+    };
+
+    struct archive* file_;
+    const size_t chunk_size_;
+    std::vector<Chunk> ring_;
+
+    std::atomic<size_t> head_;  // next chunk to read, written by reader
+    std::atomic<size_t> tail_;  // next chunk to fill, written by decoder
+    std::atomic<bool> stop_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    std::string error_;  // written by decoder before publishing the last chunk
+    size_t offset_ = 0;  // read position in chunk head_
+    bool finished_ = false;
+
+    std::thread thread_;
+
+    void notify() {
+        { std::lock_guard<std::mutex> lock(mutex_); }
+        cv_.notify_all();
+    }
+
+    void decode() {
+        for (size_t tail = 0; ; ++tail) {
+            if (tail - head_.load(std::memory_order_acquire) == ring_.size()) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&] { return stop_ || tail - head_.load(std::memory_order_acquire) < ring_.size(); });
+            }
+            if (stop_) return;
+            Chunk& chunk = ring_[tail % ring_.size()];
+            chunk.size = 0;
+            chunk.last = false;
+            while (chunk.size < chunk_size_) {
+                ssize_t n = archive_read_data(file_, chunk.data.get() + chunk.size, chunk_size_ - chunk.size);
+                if (n < 0) {
+                    const char* msg = archive_error_string(file_);
+                    error_ = msg != nullptr ? msg : "decompression failed";
+                }
+                if (n <= 0) {
+                    chunk.last = true;
+                    break;
+                }
+                chunk.size += n;
+            }
+            tail_.store(tail + 1, std::memory_order_release);
+            notify();
+            if (chunk.last) return;
+        }
+    }
+
+    // wait for chunk head_, return false at end of data
+    bool acquire() {
+        if (finished_) return false;
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (tail_.load(std::memory_order_acquire) == head) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [&] { return tail_.load(std::memory_order_acquire) != head; });
+        }
+        return true;
+    }
+
+    void release() {
+        offset_ = 0;
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        notify();
+    }
+
+ public:
+    /**
+     * @param file archive opened for reading with current header read, freed by the caller after destruction
+     * @param chunk_size size of each chunk in bytes
+     * @param n_chunks number of chunks in ring
+     */
+    ArchiveDecoder(struct archive* file, size_t chunk_size, unsigned n_chunks = 4)
+     : file_(file), chunk_size_(chunk_size), ring_(std::max(n_chunks, 2U)), head_(0), tail_(0), stop_(false) {
+        for (Chunk& chunk : ring_) chunk.data.reset(new char[chunk_size_]);
+        thread_ = std::thread(&ArchiveDecoder::decode, this);
+    }
+
+    ~ArchiveDecoder() {
+        stop_ = true;
+        notify();
+        thread_.join();
+    }
+
+    ArchiveDecoder(const ArchiveDecoder&) = delete;
+    ArchiveDecoder& operator=(const ArchiveDecoder&) = delete;
+
+    /**
+     * @brief copy next n decoded bytes to dst, fewer only at end of data
+     * @param error set to the error message of the decoder when the end of data is reached after an error
+     * @return number of bytes copied
+     */
+    size_t read(char* dst, size_t n, std::string& error) {
+        size_t copied = 0;
+        while (copied < n && acquire()) {
+            const Chunk& chunk = ring_[head_.load(std::memory_order_relaxed) % ring_.size()];
+            const size_t k = std::min(n - copied, chunk.size - offset_);
+            std::memcpy(dst + copied, chunk.data.get() + offset_, k);
+            offset_ += k;
+            copied += k;
+            if (offset_ == chunk.size) {
+                if (chunk.last) {
+                    finished_ = true;
+                    error = error_;
+                }
+                release();
+            }
+        }
+        return copied;
+    }
+};
+
+#endif  // SRC_UTIL_ARCHIVEDECODER_H_
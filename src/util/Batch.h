@@ -0,0 +1,242 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_BATCH_H_
+#define SRC_UTIL_BATCH_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "src/util/ResourceBudget.h"
+#include "src/util/StreamBuffer.h"
+
+using BatchValue = std::variant<double, std::string>;
+using BatchRecord = std::vector<std::pair<std::string, BatchValue>>;
+using BatchTask = std::function<BatchRecord(const std::string& filename)>;
+
+/**
+ * @brief collect input files of a batch run
+ * @param path directory (searched recursively) or manifest file (one path per line, '#' starts a comment)
+ * @return input files, largest first such that long running instances do not end up in the tail
+ */
+std::vector<std::string> batch_inputs(const std::string& path) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> files;
+    if (fs::is_directory(path)) {
+        for (const auto& entry : fs::recursive_directory_iterator(path)) {
+            if (entry.is_regular_file()) files.push_back(entry.path().string());
+        }
+    } else {
+        std::ifstream manifest(path);
+        if (!manifest.is_open()) {
+            throw std::runtime_error("Could not open manifest " + path);
+        }
+        std::string line;
+        while (std::getline(manifest, line)) {
+            line.erase(0, line.find_first_not_of(" \t\r"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (!line.empty() && line[0] != '#') files.push_back(line);
+        }
+    }
+    std::vector<std::pair<uintmax_t, std::string>> sized;
+    for (const std::string& file : files) {
+        std::error_code ec;
+        uintmax_t size = fs::file_size(file, ec);
+        sized.emplace_back(ec ? 0 : size, file);
+    }
+    std::stable_sort(sized.begin(), sized.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (unsigned i = 0; i < sized.size(); ++i) {
+        files[i] = std::move(sized[i].second);
+    }
+    return files;
+}
+
+/**
+ * @brief thread-safe writer which streams records as CSV or JSON lines
+ * CSV columns are taken from the first record, later records are aligned by key
+ */
+class BatchWriter {
+    std::ostream& out_;
+    const bool jsonl_;
+    std::vector<std::string> header_;
+    std::mutex mutex_;
+
+    static std::string json_string(const std::string& str) {
+        std::string result = "\"";
+        for (char c : str) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+                result += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                result += buf;
+            } else {
+                result += c;
+            }
+        }
+        return result + "\"";
+    }
+
+    static std::string csv_string(const std::string& str) {
+        if (str.find_first_of(",\"\n\r") == std::string::npos) return str;
+        std::string result = "\"";
+        for (char c : str) {
+            if (c == '"') result += '"';
+            result += c;
+        }
+        return result + "\"";
+    }
+
+    static std::string format(const BatchValue& value, bool jsonl) {
+        if (const double* number = std::get_if<double>(&value)) {
+            if (jsonl && !std::isfinite(*number)) return "null";
+            std::ostringstream str;
+            str << *number;
+            return str.str();
+        }
+        const std::string& str = std::get<std::string>(value);
+        return jsonl ? json_string(str) : csv_string(str);
+    }
+
+    std::string format(const BatchValue& value) const {
+        return format(value, jsonl_);
+    }
+
+ public:
+    BatchWriter(std::ostream& out, bool jsonl) : out_(out), jsonl_(jsonl) { }
+
+    /**
+     * @brief record as a single line JSON object (without line break)
+     */
+    static std::string to_json(const BatchRecord& record) {
+        std::string json = "{";
+        for (unsigned i = 0; i < record.size(); ++i) {
+            if (i > 0) json += ", ";
+            json += json_string(record[i].first) + ": " + format(record[i].second, true);
+        }
+        return json + "}";
+    }
+
+    void write(const BatchRecord& record) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (jsonl_) {
+            out_ << to_json(record) << std::endl;
+            return;
+        }
+        if (header_.empty()) {
+            for (unsigned i = 0; i < record.size(); ++i) {
+                header_.push_back(record[i].first);
+                out_ << (i > 0 ? "," : "") << csv_string(record[i].first);
+            }
+            out_ << std::endl;
+        }
+        for (unsigned i = 0; i < header_.size(); ++i) {
+            if (i > 0) out_ << ",";
+            auto it = std::find_if(record.begin(), record.end(), [&](const auto& field) { return field.first == header_[i]; });
+            if (it != record.end()) out_ << format(it->second);
+        }
+        out_ << std::endl;
+    }
+};
+
+/**
+ * @brief call work(i) for all i < n on jobs threads, the calling thread is one of them
+ * Workers fetch the next index from a shared counter, work must not throw.
+ */
+void run_workers(size_t n, unsigned jobs, const std::function<void(size_t)>& work) {
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < n; i = next++) {
+            work(i);
+        }
+    };
+    jobs = std::max(1u, std::min<unsigned>(jobs, n));
+    std::vector<std::thread> workers;
+    for (unsigned j = 1; j < jobs; ++j) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+}
+
+/**
+ * @brief run task on the file under its own cooperative ResourceBudget with time limit rlim (seconds)
+ * and memory limit mlim (mega bytes)
+ * @param error receives the message of a failed task if not nullptr
+ * @return record which starts with the file name and ends with runtime, which is "timeout", "memout" or "error" if the task failed
+ */
+BatchRecord run_task(const BatchTask& task, const std::string& file, double rlim, unsigned mlim, std::string* error = nullptr) {
+    BatchRecord record { { "file", file } };
+    ResourceBudget budget(rlim, mlim);
+    try {
+        BatchRecord result;
+        {  // handlers below run outside of the budget
+            ResourceBudget::Scope scope(budget);
+            result = task(file);
+        }
+        record.insert(record.end(), result.begin(), result.end());
+        record.emplace_back("runtime", budget.get_runtime());
+    }
+    catch (TimeLimitExceeded& e) {
+        record.emplace_back("runtime", "timeout");
+    }
+    catch (MemoryLimitExceeded& e) {
+        record.emplace_back("runtime", "memout");
+    }
+    catch (std::bad_alloc& e) {
+        record.emplace_back("runtime", "memout");
+    }
+    catch (std::exception& e) {
+        std::cerr << file << ": " << e.what() << std::endl;
+        if (error != nullptr) *error = e.what();
+        record.emplace_back("runtime", "error");
+    }
+    return record;
+}
+
+/**
+ * @brief run task on all input files using jobs worker threads
+ * Workers fetch the next unprocessed file from a shared queue (largest files first).
+ * Each task runs under its own ResourceBudget, see run_task().
+ * Results are streamed to the writer in completion order.
+ */
+void run_batch(const std::vector<std::string>& inputs, const BatchTask& task, BatchWriter& writer, unsigned jobs, double rlim, unsigned mlim) {
+    run_workers(inputs.size(), jobs, [&](size_t i) {
+        writer.write(run_task(task, inputs[i], rlim, mlim));
+    });
+}
+
+#endif  // SRC_UTIL_BATCH_H_
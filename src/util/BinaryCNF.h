@@ -0,0 +1,250 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_BINARYCNF_H_
+#define SRC_UTIL_BINARYCNF_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/util/SolverTypes.h"
+#include "src/util/StreamBuffer.h"
+#include "src/util/ResourceBudget.h"
+
+/**
+ * Packed CNF container, all integers little endian:
+ * - header (see Header::size): magic, version, flags, nvars, nclauses, nliterals,
+ *   gbdhash of the original DIMACS file, offset and stride of the optional clause index
+ * - clauses in original order: varint length followed by varint literals (Lit::x),
+ *   literals are stored as is, i.e., duplicates, tautologies and empty clauses are preserved
+ * - optional index: byte offset (u64) of every index_stride-th clause
+ * Packed files are read via mmap and must not be compressed.
+ */
+namespace BinaryCNF {
+    static constexpr char magic[8] = { 'G', 'B', 'D', 'C', 'P', 'A', 'C', 'K' };
+    static constexpr uint32_t version = 1;
+    static constexpr uint32_t flag_index = 1;
+
+    struct Header {
+        static constexpr size_t size = 88;
+
+        uint32_t version = BinaryCNF::version;
+        uint32_t flags = 0;
+        uint64_t n_vars = 0;
+        uint64_t n_clauses = 0;
+        uint64_t n_literals = 0;
+        std::string gbdhash;  // 32 hex digits
+        uint64_t index_offset = 0;
+        uint32_t index_stride = 0;
+
+        void write(std::ostream& out) const {
+            unsigned char bytes[size] = { };
+            std::memcpy(bytes, magic, 8);
+            put(bytes + 8, version, 4);
+            put(bytes + 12, flags, 4);
+            put(bytes + 16, n_vars, 8);
+            put(bytes + 24, n_clauses, 8);
+            put(bytes + 32, n_literals, 8);
+            std::memcpy(bytes + 40, gbdhash.data(), std::min<size_t>(gbdhash.size(), 32));
+            put(bytes + 72, index_offset, 8);
+            put(bytes + 80, index_stride, 4);
+            out.write(reinterpret_cast<const char*>(bytes), size);
+        }
+
+        void read(const unsigned char* bytes) {
+            version = get(bytes + 8, 4);
+            flags = get(bytes + 12, 4);
+            n_vars = get(bytes + 16, 8);
+            n_clauses = get(bytes + 24, 8);
+            n_literals = get(bytes + 32, 8);
+            gbdhash.assign(reinterpret_cast<const char*>(bytes + 40), 32);
+            index_offset = get(bytes + 72, 8);
+            index_stride = get(bytes + 80, 4);
+        }
+
+        static void put(unsigned char* bytes, uint64_t value, unsigned n) {
+            for (unsigned i = 0; i < n; ++i) bytes[i] = value >> (8 * i);
+        }
+
+        static uint64_t get(const unsigned char* bytes, unsigned n) {
+            uint64_t value = 0;
+            for (unsigned i = 0; i < n; ++i) value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+            return value;
+        }
+    };
+
+    inline void write_varint(std::ostream& out, uint64_t value) {
+        char bytes[10];
+        unsigned n = 0;
+        while (value >= 0x80) {
+            bytes[n++] = static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        bytes[n++] = static_cast<char>(value);
+        out.write(bytes, n);
+    }
+
+    /**
+     * @brief check for the magic bytes of a packed file
+     */
+    inline bool is_packed(const char* filename) {
+        char bytes[8];
+        std::ifstream in(filename, std::ios::binary);
+        return in.read(bytes, 8) && std::memcmp(bytes, magic, 8) == 0;
+    }
+
+    /**
+     * @brief zero-copy reader of packed files with the clause interface of StreamBuffer
+     */
+    class Reader {
+        const unsigned char* data;
+        size_t size;
+        const unsigned char* cur;
+        const unsigned char* end;  // end of clause section
+        Header header_;
+
+        inline uint64_t read_varint() {
+            uint64_t value = 0;
+            for (unsigned shift = 0; cur < end && shift < 64; shift += 7) {
+                const unsigned char byte = *cur++;
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (byte < 0x80) return value;
+            }
+            throw ParserException("Error reading packed file: truncated clause");
+        }
+
+     public:
+        /**
+         * @throw ParserException if the file can not be mapped or is not a packed file of known version
+         */
+        explicit Reader(const char* filename) : data(nullptr), size(0) {
+            int fd = open(filename, O_RDONLY);
+            struct stat st;
+            if (fd < 0 || fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < Header::size) {
+                if (fd >= 0) close(fd);
+                throw ParserException(std::string("Error opening packed file: ") + filename);
+            }
+            size = st.st_size;
+            void* region = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (region == MAP_FAILED) {
+                throw ParserException(std::string("Error mapping packed file: ") + filename);
+            }
+            madvise(region, size, MADV_SEQUENTIAL);
+            data = static_cast<const unsigned char*>(region);
+            if (std::memcmp(data, magic, 8) != 0) {
+                munmap(const_cast<unsigned char*>(data), size);
+                throw ParserException(std::string("Not a packed file: ") + filename);
+            }
+            header_.read(data);
+            const bool indexed = header_.flags & flag_index;
+            if (header_.version != version || (indexed && (header_.index_offset < Header::size || header_.index_offset > size))) {
+                munmap(const_cast<unsigned char*>(data), size);
+                throw ParserException(std::string("Unsupported packed file: ") + filename);
+            }
+            cur = data + Header::size;
+            end = indexed ? data + header_.index_offset : data + size;
+        }
+
+        ~Reader() {
+            munmap(const_cast<unsigned char*>(data), size);
+        }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        inline const Header& header() const {
+            return header_;
+        }
+
+        // number of entries of the clause index, 0 if the file has no index
+        inline uint64_t index_size() const {
+            return header_.flags & flag_index ? (size - header_.index_offset) / 8 : 0;
+        }
+
+        /**
+         * @brief continue reading at clause entry * index_stride
+         * @throw ParserException if the entry does not exist or points outside of the clauses
+         */
+        void seek(uint64_t entry) {
+            if (entry >= index_size()) throw ParserException("Error reading packed file: index entry out of range");
+            const uint64_t offset = Header::get(data + header_.index_offset + 8 * entry, 8);
+            if (offset < Header::size || offset > header_.index_offset) throw ParserException("Error reading packed file: bad index entry");
+            cur = data + offset;
+        }
+
+        /**
+         * @brief read next clause to out, same semantics as StreamBuffer::readClause()
+         * @throw ParserException if the clause is longer than the rest of the file or has variables outside of 1..n_vars
+         * @return false if all clauses have been read
+         */
+        bool readClause(Cl& out) {
+            if (cur >= end) return false;
+            ResourceBudget::poll();
+            const uint64_t length = read_varint();
+            // each literal takes at least one byte, bound allocation for corrupt files
+            if (length > static_cast<uint64_t>(end - cur)) throw ParserException("Error reading packed file: truncated clause");
+            out.resize(length);
+            const uint64_t max_lit = 2 * std::min<uint64_t>(header_.n_vars, (1u << 31) - 1) + 1;
+            for (Lit& lit : out) {
+                const uint64_t x = read_varint();
+                if (x < 2 || x > max_lit) throw ParserException("Error reading packed file: variable out of range");
+                lit.x = static_cast<unsigned>(x);
+            }
+            return true;
+        }
+    };
+}  // namespace BinaryCNF
+
+/**
+ * @brief reads clauses of DIMACS CNF or packed files
+ */
+class ClauseReader {
+    std::unique_ptr<BinaryCNF::Reader> packed;
+    std::unique_ptr<StreamBuffer> text;
+
+ public:
+    explicit ClauseReader(const char* filename) {
+        if (BinaryCNF::is_packed(filename)) packed = std::make_unique<BinaryCNF::Reader>(filename);
+        else text = std::make_unique<StreamBuffer>(filename);
+    }
+
+    /**
+     * @brief header of packed file or nullptr for DIMACS files
+     */
+    inline const BinaryCNF::Header* header() const {
+        return packed ? &packed->header() : nullptr;
+    }
+
+    inline bool readClause(Cl& out) {
+        return packed ? packed->readClause(out) : text->readClause(out);
+    }
+};
+
+#endif  // SRC_UTIL_BINARYCNF_H_
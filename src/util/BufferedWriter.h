@@ -0,0 +1,100 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_BUFFEREDWRITER_H_
+#define SRC_UTIL_BUFFEREDWRITER_H_
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Collects output in a large user space buffer and passes it to a sink in big blocks
+ * - integers are formatted with std::to_chars, no locale, no stream state
+ * - the destructor does not flush, call flush() when done
+ */
+class BufferedWriter {
+ public:
+    typedef std::function<void(const char*, size_t)> Sink;
+
+ private:
+    Sink sink_;
+    std::unique_ptr<char[]> buffer_;
+    size_t capacity_;
+    size_t used_ = 0;
+
+ public:
+    explicit BufferedWriter(Sink sink, size_t capacity = 1 << 20)
+        : sink_(std::move(sink)), buffer_(new char[capacity]), capacity_(capacity) { }
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    /**
+     * @brief sink which writes to the given file
+     * @throw std::runtime_error if writing fails
+     */
+    static Sink to_file(std::FILE* file) {
+        return [file] (const char* data, size_t size) {
+            if (std::fwrite(data, 1, size, file) != size) {
+                throw std::runtime_error("Error writing output");
+            }
+        };
+    }
+
+    void write(const char* data, size_t size) {
+        if (used_ + size > capacity_) {
+            flush();
+            if (size > capacity_) {
+                sink_(data, size);
+                return;
+            }
+        }
+        std::memcpy(buffer_.get() + used_, data, size);
+        used_ += size;
+    }
+
+    void write(const std::string& str) {
+        write(str.data(), str.size());
+    }
+
+    void put(char c) {
+        if (used_ == capacity_) flush();
+        buffer_[used_++] = c;
+    }
+
+    template <typename Integer>
+    void writeInt(Integer value) {
+        if (used_ + 24 > capacity_) flush();
+        used_ = std::to_chars(buffer_.get() + used_, buffer_.get() + capacity_, value).ptr - buffer_.get();
+    }
+
+    void flush() {
+        if (used_ > 0) {
+            sink_(buffer_.get(), used_);
+            used_ = 0;
+        }
+    }
+};
+
+#endif  // SRC_UTIL_BUFFEREDWRITER_H_
@@ -21,42 +21,137 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #define SRC_UTIL_CNFFORMULA_H_
 
 #include <vector>
+#include <deque>
 #include <algorithm>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <ostream>
 
-#include "src/util/StreamBuffer.h"
+#include "src/util/BinaryCNF.h"
+#include "src/util/FormulaLoader.h"
+#include "src/util/ParallelDimacs.h"
+#include "src/util/Profile.h"
 #include "src/util/SolverTypes.h"
 
-class CNFFormula {
-    For formula;
-    unsigned variables;
+/**
+ * @brief Clause in the literal arena of a CNFFormula
+ */
+class Clause {
+    friend class CNFFormula;
+
+    Lit* first;
+    unsigned length;
+
+    Clause(Lit* first_, unsigned length_) : first(first_), length(length_) { }
 
  public:
-    CNFFormula() : formula(), variables(0) { }
+    typedef const Lit* const_iterator;
+
+    inline const_iterator begin() const {
+        return first;
+    }
+
+    inline const_iterator end() const {
+        return first + length;
+    }
 
-    explicit CNFFormula(const char* filename) : CNFFormula() {
-        readDimacsFromFile(filename);
+    inline size_t size() const {
+        return length;
     }
 
-    ~CNFFormula() {
-        for (Cl* clause : formula) {
-            delete clause;
+    inline bool empty() const {
+        return length == 0;
+    }
+
+    inline Lit operator[] (size_t i) const {
+        return first[i];
+    }
+
+    inline Lit front() const {
+        return first[0];
+    }
+
+    inline Lit back() const {
+        return first[length - 1];
+    }
+};
+
+typedef std::vector<const Clause*> ClauseList;
+
+inline std::ostream& operator <<(std::ostream& stream, Clause const& clause) {
+    for (Lit lit : clause) {
+        stream << lit << " ";
+    }
+    return stream;
+}
+
+/**
+ * @brief Formula with all literals in a block-wise allocated arena,
+ * clause handles (const Clause*) stay valid for the lifetime of the formula
+ */
+class CNFFormula {
+    static constexpr size_t block_size = 1 << 18;  // literals
+
+    std::vector<std::unique_ptr<Lit[]>> blocks;
+    size_t block_used;  // literals used in blocks.back()
+    size_t block_capacity;  // capacity of blocks.back(), larger than block_size for huge clauses
+    std::deque<Clause> formula;  // stable addresses on push_back
+    unsigned variables;
+
+    // returns space for n literals in the current block, starts a new block if necessary
+    Lit* reserve(size_t n) {
+        if (blocks.empty() || block_used + n > block_capacity) {
+            block_capacity = std::max(block_size, n);
+            blocks.emplace_back(new Lit[block_capacity]);
+            block_used = 0;
         }
+        return blocks.back().get() + block_used;
+    }
+
+ public:
+    CNFFormula() : blocks(), block_used(0), block_capacity(0), formula(), variables(0) { }
+
+    /**
+     * @param threads parse plain DIMACS files with this many threads
+     */
+    explicit CNFFormula(const char* filename, const unsigned threads = 1) : CNFFormula() {
+        Profile::Scope scope("parse");
+        readDimacsFromFile(filename, threads);
+        Profile::count("clauses", nClauses());
     }
 
-    typedef For::const_iterator const_iterator;
+    CNFFormula(const CNFFormula&) = delete;
+    CNFFormula& operator=(const CNFFormula&) = delete;
+
+    class const_iterator {
+        std::deque<Clause>::const_iterator it;
+
+     public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = const Clause*;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Clause* const*;
+        using reference = const Clause*;
+
+        explicit const_iterator(std::deque<Clause>::const_iterator it_) : it(it_) { }
+
+        inline const Clause* operator* () const { return &*it; }
+        inline const_iterator& operator++ () { ++it; return *this; }
+        inline bool operator== (const const_iterator& o) const { return it == o.it; }
+        inline bool operator!= (const const_iterator& o) const { return it != o.it; }
+    };
 
     inline const_iterator begin() const {
-        return formula.begin();
+        return const_iterator(formula.begin());
     }
 
     inline const_iterator end() const {
-        return formula.end();
+        return const_iterator(formula.end());
     }
 
-    inline const Cl* operator[] (int i) const {
-        return formula[i];
+    inline const Clause* operator[] (int i) const {
+        return &formula[i];
     }
 
     inline size_t nVars() const {
@@ -73,75 +168,69 @@ class CNFFormula {
 
     inline void clear() {
         formula.clear();
+        blocks.clear();
+        block_used = block_capacity = 0;
     }
 
     // create gapless representation of variables
     void normalizeVariableNames() {
-        std::vector<unsigned> name;
-        constexpr unsigned empty = ~0U;
-        name.resize(variables+1, empty);
-        unsigned int max = 0;
-        for (Cl* clause : formula) {
-            for (Lit& lit : *clause) {
-                if (name[lit.var()] == empty) name[lit.var()] = max++;
-                lit = Lit(name[lit.var()], lit.sign());
-            }
+        VariableRenaming names(variables);
+        for (Clause& clause : formula) {
+            for (Lit* lit = clause.first; lit != clause.first + clause.length; ++lit) *lit = names(*lit);
         }
-        variables = max;
+        variables = names.size();
     }
 
-    void readDimacsFromFile(const char* filename) {
-        StreamBuffer in(filename);
+    void readDimacsFromFile(const char* filename, const unsigned threads = 1) {
+        if (threads > 1 && ParallelDimacs::supported(filename)) {
+            ParallelDimacs::read(filename, threads, [this] (const Cl& clause) { readClause(clause.begin(), clause.end()); });
+            return;
+        }
+        ClauseReader in(filename);
         Cl clause;
-        while (in.skipWhitespace()) {
-            if (*in == 'p' || *in == 'c') {
-                if (!in.skipLine()) break;
-            } else {
-                int plit;
-                while (in.readInteger(&plit)) {
-                    if (plit == 0) break;
-                    clause.push_back(Lit(abs(plit), plit < 0));
-                }
-                readClause(clause.begin(), clause.end());
-                clause.clear();
-            }
+        while (in.readClause(clause)) {
+            readClause(clause.begin(), clause.end());
         }
     }
 
-    void readClause(std::initializer_list<Lit> list) {
-        readClause(list.begin(), list.end());
+    const Clause* readClause(std::initializer_list<Lit> list) {
+        return readClause(list.begin(), list.end());
     }
 
-    void readClauses(const For& formula) {
-        for (Cl* clause : formula) {
+    template <typename Clauses>
+    void readClauses(const Clauses& clauses) {
+        for (const auto clause : clauses) {
             readClause(clause->begin(), clause->end());
         }
     }
 
+    /**
+     * @brief sorts the literals, removes duplicates and drops tautologies
+     * @return handle of the stored clause, nullptr for tautologies
+     */
     template <typename Iterator>
-    void readClause(Iterator begin, Iterator end) {
-        Cl* clause = new Cl { begin, end };
-        if (clause->size() > 0) {
+    const Clause* readClause(Iterator begin, Iterator end) {
+        const size_t n = std::distance(begin, end);
+        Lit* first = reserve(n);
+        Lit* last = std::copy(begin, end, first);
+        if (n > 0) {
             // remove redundant literals
-            std::sort(clause->begin(), clause->end());
-            unsigned dup = 0;
-            for (auto it = clause->begin(), jt = clause->begin()+1; jt != clause->end(); ++jt) {
+            std::sort(first, last);
+            Lit* it = first;
+            for (Lit* jt = first + 1; jt != last; ++jt) {
                 if (*it != *jt) {  // unique
                     if (it->var() == jt->var()) {
-                        delete clause;
-                        return;  // no tautologies
+                        return nullptr;  // no tautologies
                     }
-                    ++it;
-                    *it = *jt;
-                } else {
-                    ++dup;
+                    *++it = *jt;
                 }
             }
-            clause->resize(clause->size() - dup);
-            clause->shrink_to_fit();
-            variables = std::max(variables, (unsigned int)clause->back().var());
+            last = it + 1;
+            variables = std::max(variables, (unsigned int)it->var());
         }
-        formula.push_back(clause);
+        block_used += last - first;
+        formula.push_back(Clause(first, last - first));
+        return &formula.back();
     }
 };
 
@@ -7,6 +7,8 @@
 
 #include <algorithm>
 #include <cmath>
+#include <type_traits>
+#include <utility>
 
 template <typename Container>
 double Mean(Container&& distribution) {
@@ -27,15 +29,16 @@ double Variance(Container&& distribution, double mean) {
     return vari;
 }
 
-double ScaledEntropyFromOccurenceCounts(std::unordered_map<int64_t, int64_t> occurence, size_t total) {
+double ScaledEntropyFromOccurenceCounts(const std::vector<int64_t>& occurence, size_t total) {
     // collect and sort summands
     std::vector<long double> summands;
-    for (auto& pair : occurence) {
-        long double p_x = (long double)pair.second / (long double)total;
+    summands.reserve(occurence.size());
+    for (int64_t count : occurence) {
+        long double p_x = (long double)count / (long double)total;
         long double summand = p_x * log2(p_x);
         summands.push_back(summand);
     }
-    std::sort(summands.begin(), summands.end(), [] (long double a, long double b) { return abs(a) < abs(b); });
+    std::sort(summands.begin(), summands.end(), [] (long double a, long double b) { return std::fabs(a) < std::fabs(b); });
     // calculate entropy
     long double entropy = 0;
     for (long double summand : summands) {
@@ -45,31 +48,107 @@ double ScaledEntropyFromOccurenceCounts(std::unordered_map<int64_t, int64_t> occ
     return log2(summands.size()) == 0 ? 0 : (double)entropy / log2(summands.size());
 }
 
-double ScaledEntropy(std::vector<double> distribution) {
-    std::unordered_map<int64_t, int64_t> occurence;
-    for (double value : distribution) {
-        // snap to 3 digits after decimal point
+/**
+ * @brief Occurrence counts of values snapped to 3 digits after decimal point
+ * @param runs distinct values in sorted order with their number of occurrences, then equal snaps are adjacent and the keys stay sorted
+ * @return std::vector<int64_t> occurrence count per snapped value
+ */
+static std::vector<int64_t> SnappedOccurenceCounts(const std::vector<std::pair<double, uint64_t>>& runs) {
+    std::vector<int64_t> snaps;
+    std::vector<int64_t> counts;
+    for (const auto& [value, count] : runs) {
         int64_t snap = static_cast<int64_t>(std::round(1000 * value));
-        if (occurence.count(value)) {
-            occurence[snap] = occurence[snap] + 1;
-        } else {
-            occurence[snap] = 1;
+        // counting restarts unless the unsnapped value was seen before as a snap,
+        // kept as in the original map-based version to reproduce recorded features
+        bool seen = std::binary_search(snaps.begin(), snaps.end(), static_cast<int64_t>(value));
+        if (snaps.empty() || snaps.back() != snap) {
+            snaps.push_back(snap);
+            counts.push_back(0);
+        }
+        counts.back() = seen ? counts.back() + 1 : 1;
+        // further occurrences of the value see its own snap
+        if (count > 1) {
+            seen = std::binary_search(snaps.begin(), snaps.end(), static_cast<int64_t>(value));
+            counts.back() = seen ? counts.back() + count - 1 : 1;
         }
     }
-    return ScaledEntropyFromOccurenceCounts(occurence, distribution.size());
+    return counts;
 }
 
-template <typename Container>
-double ScaledEntropy(Container&& distribution) {
-    std::unordered_map<int64_t, int64_t> occurence;
-    for (unsigned value : distribution) {
-        if (occurence.count(value)) {
-            occurence[value] = occurence[value] + 1;
-        } else {
-            occurence[value] = 1;
+/**
+ * @brief Summary of a distribution given by the runs of equal values in sorted order
+ * - mean and variance are accumulated element by element in sorted order, like for the sorted distribution
+ * - entropy of integers is computed from the occurrence counts, entropy of doubles from the counts of 3-digit snaps
+ */
+template <typename T>
+static void push_runs(std::vector<double>& record, const std::vector<std::pair<T, uint64_t>>& runs, uint64_t total) {
+    double mean = 0.0;
+    size_t i = 0;
+    for (const auto& [value, count] : runs) {
+        for (uint64_t c = 0; c < count; ++c, ++i) {
+            mean += (value - mean) / (i + 1);
+        }
+    }
+    double vari = 0.0;
+    i = 0;
+    for (const auto& [value, count] : runs) {
+        double diff = value - mean;
+        for (uint64_t c = 0; c < count; ++c, ++i) {
+            vari += (diff*diff - vari) / (i + 1);
+        }
+    }
+    std::vector<int64_t> counts;
+    if constexpr (std::is_integral_v<T>) {
+        counts.reserve(runs.size());
+        for (const auto& run : runs) {
+            counts.push_back(run.second);
+        }
+    } else {
+        counts = SnappedOccurenceCounts(runs);
+    }
+    double entropy = ScaledEntropyFromOccurenceCounts(counts, total);
+    record.insert(record.end(), { mean, vari, (double)runs.front().first, (double)runs.back().first, entropy });
+}
+
+/**
+ * @brief Summary of a distribution of doubles, sorted in place
+ */
+static void push_real_distribution(std::vector<double>& record, std::vector<double>& distribution) {
+    std::sort(distribution.begin(), distribution.end());
+    std::vector<std::pair<double, uint64_t>> runs;
+    for (double value : distribution) {
+        if (runs.empty() || runs.back().first != value) runs.emplace_back(value, 0);
+        ++runs.back().second;
+    }
+    push_runs(record, runs, distribution.size());
+}
+
+/**
+ * @brief Summary of a distribution of integers, computed from the runs of equal values in sorted order
+ * - counting sort if the value range is small compared to the size of the distribution, std::sort otherwise
+ */
+template <typename T>
+static void push_integer_distribution(std::vector<double>& record, std::vector<T>& distribution) {
+    const auto [min, max] = std::minmax_element(distribution.begin(), distribution.end());
+    const uint64_t range = static_cast<uint64_t>(*max - *min) + 1;
+    std::vector<std::pair<T, uint64_t>> runs;
+    if (range <= 2 * distribution.size() + 1024) {
+        const T offset = *min;
+        std::vector<uint64_t> histogram(range, 0);
+        for (T value : distribution) {
+            ++histogram[value - offset];
+        }
+        for (uint64_t i = 0; i < range; ++i) {
+            if (histogram[i] > 0) runs.emplace_back(static_cast<T>(offset + i), histogram[i]);
+        }
+    } else {
+        std::sort(distribution.begin(), distribution.end());
+        for (T value : distribution) {
+            if (runs.empty() || runs.back().first != value) runs.emplace_back(value, 0);
+            ++runs.back().second;
         }
     }
-    return ScaledEntropyFromOccurenceCounts(occurence, distribution.size());
+    push_runs(record, runs, distribution.size());
 }
 
 template <typename V, typename W>
@@ -78,17 +157,29 @@ void push_distribution(V&& record, W&& distribution) {
         record.insert(record.end(), { 0, 0, 0, 0, 0 });
         return;
     }
-    std::sort(distribution.begin(), distribution.end());
-    double mean = Mean(distribution);
-    double variance = Variance(distribution, mean);
-    double min = distribution.front();
-    double max = distribution.back();
-    double entropy = ScaledEntropy(distribution);
-    record.insert(record.end(), { mean, variance, min, max, entropy });
+    using T = typename std::decay_t<W>::value_type;
+    if constexpr (std::is_integral_v<T>) {
+        push_integer_distribution<T>(record, distribution);
+    } else {
+        push_real_distribution(record, distribution);
+    }
 }
 
 // Explicit template instantiations
 template void push_distribution<std::vector<double, std::allocator<double> >&, std::vector<unsigned int, std::allocator<unsigned int> >&>(std::vector<double, std::allocator<double> >&, std::vector<unsigned int, std::allocator<unsigned int> >&);
 template void push_distribution<std::vector<double, std::allocator<double> >&, std::vector<double, std::allocator<double> >&>(std::vector<double, std::allocator<double> >&, std::vector<double, std::allocator<double> >&);
 template void push_distribution<std::vector<double, std::allocator<double> >&, std::vector<unsigned long, std::allocator<unsigned long> >&>(std::vector<double, std::allocator<double> >&, std::vector<unsigned long, std::allocator<unsigned long> >&);
-template void push_distribution<std::vector<double, std::allocator<double> >&, std::vector<unsigned long long, std::allocator<unsigned long long> >&>(std::vector<double, std::allocator<double> >&, std::vector<unsigned long long, std::allocator<unsigned long long> >&);
\ No newline at end of file
+template void push_distribution<std::vector<double, std::allocator<double> >&, std::vector<unsigned long long, std::allocator<unsigned long long> >&>(std::vector<double, std::allocator<double> >&, std::vector<unsigned long long, std::allocator<unsigned long long> >&);
+
+template <typename T>
+void push_histogram(std::vector<double>& record, const Histogram<T>& histogram) {
+    if (histogram.size() == 0) {
+        record.insert(record.end(), { 0, 0, 0, 0, 0 });
+        return;
+    }
+    push_runs(record, histogram.runs(), histogram.size());
+}
+
+template void push_histogram<unsigned>(std::vector<double>&, const Histogram<unsigned>&);
+template void push_histogram<uint64_t>(std::vector<double>&, const Histogram<uint64_t>&);
+template void push_histogram<double>(std::vector<double>&, const Histogram<double>&);
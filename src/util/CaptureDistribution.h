@@ -6,9 +6,12 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
+#include <algorithm>
 #include <cstdint>
 #include <cstddef>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 
 template <typename Container> 
 double Mean(Container&& distribution);
@@ -16,11 +19,81 @@ double Mean(Container&& distribution);
 template <typename Container> 
 double Variance(Container&& distribution, double mean);
 
-double ScaledEntropyFromOccurenceCounts(std::unordered_map<int64_t, int64_t> occurence, size_t total);
-double ScaledEntropy(std::vector<double> distribution);
-
-template <typename Container> 
-double ScaledEntropy(Container&& distribution);
+double ScaledEntropyFromOccurenceCounts(const std::vector<int64_t>& occurence, size_t total);
 
 template <typename V, typename W> 
-void push_distribution(V&& record, W&& distribution);
\ No newline at end of file
+void push_distribution(V&& record, W&& distribution);
+
+/**
+ * @brief Exact distribution as occurrence counts of its distinct values, memory is O(distinct values) instead of O(values)
+ * Non-negative integers below dense_limit are counted in a vector, all other values in a hash map.
+ * push_histogram() gives the same summary as push_distribution() of the vector of all values.
+ */
+template <typename T>
+class Histogram {
+    std::vector<uint64_t> dense_;
+    std::unordered_map<T, uint64_t> sparse_;
+    uint64_t total_ = 0;
+
+ public:
+    static constexpr uint64_t dense_limit = 1 << 16;
+
+    inline void add(T value, uint64_t count = 1) {
+        total_ += count;
+        if constexpr (std::is_integral_v<T>) {
+            const uint64_t index = static_cast<std::make_unsigned_t<T>>(value);
+            if (index < dense_limit) {
+                if (index >= dense_.size()) dense_.resize(index + 1);
+                dense_[index] += count;
+                return;
+            }
+        }
+        sparse_[value] += count;
+    }
+
+    // number of values
+    uint64_t size() const {
+        return total_;
+    }
+
+    // distinct values in ascending order with their number of occurrences
+    std::vector<std::pair<T, uint64_t>> runs() const {
+        std::vector<std::pair<T, uint64_t>> runs;
+        for (uint64_t i = 0; i < dense_.size(); ++i) {
+            if (dense_[i] > 0) runs.emplace_back(static_cast<T>(i), dense_[i]);
+        }
+        runs.insert(runs.end(), sparse_.begin(), sparse_.end());
+        std::sort(runs.begin(), runs.end());
+        return runs;
+    }
+
+    // occurrence counts for StateFile
+    template <typename Writer>
+    void save(Writer& out) const {
+        std::vector<T> values;
+        std::vector<uint64_t> counts;
+        for (const auto& [value, count] : runs()) {
+            values.push_back(value);
+            counts.push_back(count);
+        }
+        out.put(values);
+        out.put(counts);
+    }
+
+    template <typename Reader>
+    void load(Reader& in) {
+        std::vector<T> values;
+        std::vector<uint64_t> counts;
+        in.get(values);
+        in.get(counts);
+        dense_.clear();
+        sparse_.clear();
+        total_ = 0;
+        for (size_t i = 0; i < values.size() && i < counts.size(); ++i) {
+            add(values[i], counts[i]);
+        }
+    }
+};
+
+template <typename T>
+void push_histogram(std::vector<double>& record, const Histogram<T>& histogram);
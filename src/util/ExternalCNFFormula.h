@@ -0,0 +1,365 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_EXTERNALCNFFORMULA_H_
+#define SRC_UTIL_EXTERNALCNFFORMULA_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "src/util/BinaryCNF.h"
+#include "src/util/BufferedWriter.h"
+#include "src/util/ParallelDimacs.h"
+#include "src/util/Profile.h"
+#include "src/util/SolverTypes.h"
+
+/**
+ * @brief Temporary file of clauses in the varint encoding of packed files (length followed by literals),
+ * written once and read sequentially through bounded memory mapped windows.
+ * Neither the clauses nor the windows are heap allocations, such that they do not count against a ResourceBudget,
+ * and the address space of a window is bounded, such that they also fit under an RLIMIT_AS memory limit.
+ * The file is created in $TMPDIR (default /tmp) and unlinked right away, such that it is removed on every exit path.
+ */
+class ClauseSpill {
+    int fd = -1;
+    uint64_t size_ = 0;
+    uint64_t n_clauses = 0;
+    size_t window_size_;
+    std::unique_ptr<BufferedWriter> writer;
+
+    inline void put_varint(uint64_t value) {
+        do {
+            const unsigned char byte = (value & 0x7F) | (value >= 0x80 ? 0x80 : 0);
+            writer->put(static_cast<char>(byte));
+            value >>= 7;
+            ++size_;
+        } while (value > 0);
+    }
+
+ public:
+    // default address space of a window (bytes), windows grow for clauses that do not fit
+    static constexpr size_t default_window_size = 1 << 26;
+
+    /**
+     * @throw std::runtime_error if the temporary file can not be created
+     */
+    explicit ClauseSpill(size_t window_size = default_window_size) : window_size_(window_size) {
+        const char* dir = std::getenv("TMPDIR");
+        std::string path = std::string(dir != nullptr && *dir != '\0' ? dir : "/tmp") + "/gbdc.spill.XXXXXX";
+        fd = mkstemp(&path[0]);
+        if (fd < 0) throw std::runtime_error("Error creating temporary file " + path);
+        unlink(path.c_str());
+        writer = std::make_unique<BufferedWriter>([this] (const char* data, size_t size) {
+            while (size > 0) {
+                const ssize_t n = ::write(fd, data, size);
+                if (n < 0) throw std::runtime_error("Error writing temporary file");
+                data += n;
+                size -= n;
+            }
+        });
+    }
+
+    ~ClauseSpill() {
+        if (fd >= 0) close(fd);
+    }
+
+    ClauseSpill(const ClauseSpill&) = delete;
+    ClauseSpill& operator=(const ClauseSpill&) = delete;
+
+    template <typename Clause>
+    void add(const Clause& clause) {
+        put_varint(clause.size());
+        for (Lit lit : clause) put_varint(lit.x);
+        ++n_clauses;
+    }
+
+    /**
+     * @brief flush the written clauses, required before reading
+     */
+    void finish() {
+        if (writer) writer->flush();
+        writer.reset();
+    }
+
+    inline uint64_t size() const {
+        return size_;
+    }
+
+    inline uint64_t nClauses() const {
+        return n_clauses;
+    }
+
+    /**
+     * @brief read only mapping of a region of the file, each reader (thread) uses its own window
+     */
+    class Window {
+        const ClauseSpill* spill;
+        unsigned char* map = nullptr;
+        uint64_t map_offset = 0;
+        size_t map_length = 0;
+
+     public:
+        explicit Window(const ClauseSpill* spill_) : spill(spill_) { }
+
+        ~Window() {
+            if (map != nullptr) munmap(map, map_length);
+        }
+
+        Window(const Window&) = delete;
+        Window& operator=(const Window&) = delete;
+
+        /**
+         * @brief map [offset, offset + length) or up to the end of file
+         * @return pointers to the byte at offset and to the end of the mapped region
+         */
+        std::pair<const unsigned char*, const unsigned char*> at(uint64_t offset, size_t length) {
+            const uint64_t file_end = spill->size_;
+            const uint64_t end = std::min<uint64_t>(file_end, offset + length);
+            if (map == nullptr || offset < map_offset || end > map_offset + map_length) {
+                if (map != nullptr) munmap(map, map_length);
+                map = nullptr;
+                const uint64_t page = sysconf(_SC_PAGESIZE);
+                map_offset = offset / page * page;
+                map_length = std::min<uint64_t>(file_end - map_offset, std::max<uint64_t>(spill->window_size_, end - map_offset));
+                void* region = mmap(nullptr, map_length, PROT_READ, MAP_PRIVATE, spill->fd, map_offset);
+                if (region == MAP_FAILED) throw std::runtime_error("Error mapping temporary file");
+                madvise(region, map_length, MADV_SEQUENTIAL);
+                map = static_cast<unsigned char*>(region);
+            }
+            return { map + (offset - map_offset), map + map_length };
+        }
+
+        /**
+         * @brief map the clause at the given offset entirely
+         * @param length number of literals, output parameter
+         * @param next offset of the next clause, output parameter
+         * @return pointer to the first literal
+         */
+        const unsigned char* clause(uint64_t offset, unsigned* length, uint64_t* next) {
+            for (size_t need = 64; ; need *= 2) {
+                const auto [begin, end] = at(offset, need);
+                const unsigned char* cur = begin;
+                uint64_t n = 0;
+                bool complete = false;
+                for (unsigned shift = 0; cur < end && !complete; shift += 7) {
+                    n |= static_cast<uint64_t>(*cur & 0x7F) << shift;
+                    complete = *cur++ < 0x80;
+                }
+                const unsigned char* literals = cur;
+                for (uint64_t k = 0; complete && k < n; ) {
+                    if (cur == end) complete = false;
+                    else if (*cur++ < 0x80) ++k;
+                }
+                if (complete) {
+                    *length = n;
+                    *next = offset + (cur - begin);
+                    return literals;
+                }
+                if (offset + (end - begin) >= spill->size_) {
+                    throw std::runtime_error("Error reading temporary file: truncated clause");
+                }
+            }
+        }
+    };
+
+    static inline uint64_t read_varint(const unsigned char*& cur) {
+        uint64_t value = 0;
+        unsigned shift = 0;
+        for (;; shift += 7) {
+            const unsigned char byte = *cur++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (byte < 0x80) return value;
+        }
+    }
+
+    /**
+     * @brief read all clauses in order, requires finish()
+     * @param visit called for each clause with a reused buffer
+     */
+    template <typename Visitor>
+    void for_each(Visitor visit) const {
+        Window window(this);
+        Cl clause;
+        for (uint64_t offset = 0; offset < size_; ) {
+            ResourceBudget::poll();
+            unsigned length;
+            const unsigned char* cur = window.clause(offset, &length, &offset);
+            clause.resize(length);
+            for (Lit& lit : clause) lit.x = static_cast<unsigned>(read_varint(cur));
+            visit(clause);
+        }
+    }
+};
+
+/**
+ * @brief CNF formula with the interface of IntervalCNFFormula whose clauses are kept in a ClauseSpill,
+ * only the variable renaming is kept in memory during parsing.
+ * Variables are renamed like in IntervalCNFFormula::finalize(), empty clauses are dropped,
+ * such that both formulas have the same clauses in the same order.
+ */
+class ExternalCNFFormula {
+    ClauseSpill spill;
+    unsigned variables = 0;
+    unsigned n_clauses = 0;
+    unsigned n_literals = 0;
+
+ public:
+    /**
+     * @param threads parse plain DIMACS files with this many threads
+     * @param window_size address space of each clause window (bytes)
+     */
+    explicit ExternalCNFFormula(const char* filename, const bool /* shrink_to_fit */ = false, const unsigned threads = 1,
+                                const size_t window_size = ClauseSpill::default_window_size) : spill(window_size) {
+        Profile::Scope scope("parse");
+        constexpr unsigned empty = ~0U;
+        std::vector<unsigned> name;
+        auto add = [&] (Cl& clause) {
+            if (clause.empty()) return;
+            for (Lit& lit : clause) {
+                const unsigned var = lit.var();
+                if (var >= name.size()) name.resize(std::max<size_t>(var + 1, 2 * name.size()), empty);
+                if (name[var] == empty) name[var] = variables++;
+                lit = Lit(name[var], lit.sign());
+            }
+            spill.add(clause);
+            ++n_clauses;
+            n_literals += clause.size();
+        };
+        if (threads > 1 && ParallelDimacs::supported(filename)) {
+            Cl copy;
+            ParallelDimacs::read(filename, threads, [&add, &copy] (const Cl& clause) {
+                copy.assign(clause.begin(), clause.end());
+                add(copy);
+            });
+        } else {
+            ClauseReader in(filename);
+            Cl clause;
+            while (in.readClause(clause)) add(clause);
+        }
+        spill.finish();
+        Profile::count("clauses", n_clauses);
+    }
+
+    inline size_t nVars() const {
+        return variables;
+    }
+    inline size_t nClauses() const {
+        return n_clauses;
+    }
+    inline size_t nLiterals() const {
+        return n_literals;
+    }
+    inline size_t maxClauseLength() const {
+        return 0; // dummy, only interesting for SizeGroupedCNFFormula
+    }
+
+    /**
+     * @brief clause in the current window of the iterator, literals are decoded on the fly
+     */
+    struct Clause {
+        struct It {
+            const unsigned char* next;
+            unsigned remaining;
+            Lit lit;
+            inline It(const unsigned char* data, unsigned n) : next(data), remaining(n) {
+                if (remaining > 0) lit.x = ClauseSpill::read_varint(next);
+            }
+            inline Lit operator * () const {
+                return lit;
+            }
+            inline It& operator ++ () {
+                if (--remaining > 0) lit.x = ClauseSpill::read_varint(next);
+                return *this;
+            }
+            inline bool operator != (const It& o) const {
+                return remaining != o.remaining;
+            }
+        };
+        const unsigned char* data;
+        unsigned size_;
+        inline It begin() const {
+            return It(data, size_);
+        }
+        inline It end() const {
+            return It(nullptr, 0);
+        }
+        inline unsigned size() const {
+            return size_;
+        }
+    };
+    /**
+     * @brief copies of an iterator map their own window on first access, such that they can be used on different threads
+     */
+    struct ClauseIt {
+        const ClauseSpill* spill;
+        uint64_t offset;
+        uint64_t next = 0;  // offset of the next clause, valid if mapped
+        bool mapped = false;
+        std::unique_ptr<ClauseSpill::Window> window;
+
+        ClauseIt(const ClauseSpill* spill_, uint64_t offset_) : spill(spill_), offset(offset_) { }
+        ClauseIt(const ClauseIt& o) : spill(o.spill), offset(o.offset) { }
+        ClauseIt& operator = (const ClauseIt& o) {
+            spill = o.spill;
+            offset = o.offset;
+            mapped = false;
+            return *this;
+        }
+
+        inline Clause operator * () {
+            if (!window) window = std::make_unique<ClauseSpill::Window>(spill);
+            unsigned length;
+            const unsigned char* data = window->clause(offset, &length, &next);
+            mapped = true;
+            return Clause {data, length};
+        }
+        inline ClauseIt& operator ++ () {
+            if (!mapped) **this;
+            offset = next;
+            mapped = false;
+            return *this;
+        }
+        inline bool operator != (const ClauseIt& o) const {
+            return offset != o.offset;
+        }
+    };
+    struct Clauses {
+        const ClauseSpill* spill;
+        inline ClauseIt begin() const {
+            return ClauseIt(spill, 0);
+        }
+        inline ClauseIt end() const {
+            return ClauseIt(spill, spill->size());
+        }
+    };
+    Clauses clauses() const {
+        return Clauses {&spill};
+    }
+};
+
+#endif  // SRC_UTIL_EXTERNALCNFFORMULA_H_
@@ -0,0 +1,130 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_FORMULALOADER_H_
+#define SRC_UTIL_FORMULALOADER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+#include "src/util/BinaryCNF.h"
+#include "src/util/ParallelDimacs.h"
+#include "src/util/SolverTypes.h"
+#include "src/util/StreamBuffer.h"
+
+/**
+ * @brief counts in the header of a DIMACS or packed file, 0 if unknown
+ * Headers of DIMACS files are only hints, literals are only known for packed files.
+ */
+struct FormulaHint {
+    uint64_t vars = 0, clauses = 0, literals = 0;
+};
+
+inline FormulaHint formula_hint(const char* filename) {
+    FormulaHint hint;
+    try {
+        if (BinaryCNF::is_packed(filename)) {
+            const BinaryCNF::Reader in(filename);
+            hint.vars = in.header().n_vars;
+            hint.clauses = in.header().n_clauses;
+            hint.literals = in.header().n_literals;
+        } else {
+            StreamBuffer in(filename, 1 << 12);
+            while (in.skipWhitespace() && *in == 'c' && in.skipLine()) { }
+            if (!in.eof() && *in == 'p' && !in.readHeader("cnf", &hint.vars, &hint.clauses)) hint = FormulaHint();
+        }
+    } catch (const std::exception&) {
+        hint = FormulaHint();  // reported by the parse
+    }
+    return hint;
+}
+
+/**
+ * @brief formula_hint() bounded by the size of the file in bytes, used to reserve memory upfront
+ * Each clause and literal of a plain or packed file takes at least one byte and so do the variables
+ * that occur, so bogus headers cannot allocate more than the file. Compressed files may be underestimated.
+ */
+inline FormulaHint allocation_hint(const char* filename) {
+    FormulaHint hint = formula_hint(filename);
+    std::error_code ec;
+    const uint64_t bytes = std::filesystem::file_size(filename, ec);
+    if (ec) return FormulaHint();
+    hint.vars = std::min(hint.vars, bytes);
+    hint.clauses = std::min(hint.clauses, bytes);
+    hint.literals = std::min(hint.literals, bytes);
+    return hint;
+}
+
+/**
+ * @brief gapless names of variables in order of first occurrence, names start at 0
+ */
+class VariableRenaming {
+    static constexpr unsigned empty = ~0U;
+    std::vector<unsigned> name_;
+    unsigned n_vars_ = 0;
+
+ public:
+    // dense map of vars_hint variables is allocated upfront, pass allocation_hint() for untrusted headers
+    explicit VariableRenaming(uint64_t vars_hint = 0) : name_(vars_hint + 1, empty) { }
+
+    inline Lit operator() (Lit lit) {
+        const unsigned var = lit.var();
+        if (var >= name_.size()) name_.resize(std::max<size_t>(var + 1, 2 * name_.size()), empty);
+        if (name_[var] == empty) name_[var] = n_vars_++;
+        return Lit(name_[var], lit.sign());
+    }
+
+    // rename the literals of the range in place
+    template <typename Lits>
+    inline void apply(Lits&& lits) {
+        for (Lit& lit : lits) lit = (*this)(lit);
+    }
+
+    inline unsigned size() const {
+        return n_vars_;
+    }
+};
+
+/**
+ * @brief single pass loader of the formula backends, parses a DIMACS (with threads if plain) or packed file
+ * and passes each clause (including empty ones) with renamed literals to add in file order
+ */
+template <typename Add>
+void load_formula(const char* filename, const unsigned threads, VariableRenaming& names, Add&& add) {
+    if (threads > 1 && ParallelDimacs::supported(filename)) {
+        Cl renamed;
+        ParallelDimacs::read(filename, threads, [&] (const Cl& clause) {
+            renamed.resize(clause.size());
+            std::transform(clause.begin(), clause.end(), renamed.begin(), [&names] (Lit lit) { return names(lit); });
+            add(renamed);
+        });
+        return;
+    }
+    ClauseReader in(filename);
+    Cl clause;
+    while (in.readClause(clause)) {
+        names.apply(clause);
+        add(clause);
+    }
+}
+
+#endif  // SRC_UTIL_FORMULALOADER_H_
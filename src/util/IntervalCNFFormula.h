@@ -25,7 +25,9 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include <memory>
 #include <string>
 
-#include "src/util/StreamBuffer.h"
+#include "src/util/FormulaLoader.h"
+#include "src/util/Profile.h"
+#include "src/util/ResourceBudget.h"
 #include "src/util/SolverTypes.h"
 
 class IntervalCNFFormula {
@@ -35,8 +37,90 @@ class IntervalCNFFormula {
     unsigned n_literals = 0;
 
  public:
-    explicit inline IntervalCNFFormula(const char* filename, const bool shrink_to_fit) {
-        readDimacsFromFile(filename, shrink_to_fit);
+    IntervalCNFFormula() = default;
+
+    /**
+     * @param threads parse plain DIMACS files with this many threads
+     */
+    explicit inline IntervalCNFFormula(const char* filename, const bool shrink_to_fit, const unsigned threads = 1) {
+        Profile::Scope scope("parse");
+        readDimacsFromFile(filename, shrink_to_fit, threads);
+        Profile::count("clauses", nClauses());
+    }
+
+    /**
+     * @brief incremental construction, clauses are stored with their original variable names until finalize() is called
+     * @param clause the clause to append, empty clauses are dropped
+     */
+    template <typename Clause>
+    void addClause(const Clause& clause) {
+        if (clause.size() == 0) return;
+        for (Lit lit : clause) {
+            if (static_cast<unsigned>(lit.var()) > variables) variables = lit.var();
+        }
+        pushClause(clause);
+    }
+
+    void finalize(const bool shrink_to_fit) {
+        if (shrink_to_fit) literals.shrink_to_fit();
+        normalizeVariableNames();
+    }
+
+    /**
+     * @brief renumber variables in breadth first order over the clause-variable graph and store the clauses in the order
+     * in which the search reaches them, such that consecutive clauses touch variables with nearby names, requires finalize()
+     */
+    void reorder() {
+        constexpr unsigned empty = ~0U;
+        // clauses of each variable, clauses are identified by the position of their length slot (literal counts are unsigned)
+        std::vector<unsigned> starts;
+        starts.reserve(n_clauses);
+        std::vector<unsigned> offsets(variables + 1, 0);
+        for (unsigned pos = 0; pos < literals.size(); pos += literals[pos].x) {
+            starts.push_back(pos);
+            for (unsigned i = pos + 1; i < pos + literals[pos].x; ++i) ++offsets[literals[i].var() + 1];
+        }
+        for (unsigned v = 0; v < variables; ++v) offsets[v + 1] += offsets[v];
+        std::vector<unsigned> occurrences(offsets.back());
+        {
+            std::vector<unsigned> fill(offsets.begin(), offsets.end() - 1);
+            for (unsigned c = 0; c < starts.size(); ++c) {
+                for (unsigned i = starts[c] + 1; i < starts[c] + literals[starts[c]].x; ++i) occurrences[fill[literals[i].var()]++] = c;
+            }
+        }
+
+        std::vector<unsigned> name(variables, empty);
+        std::vector<unsigned> order;  // old names in order of discovery, doubles as queue
+        order.reserve(variables);
+        std::vector<char> emitted(starts.size(), false);
+        std::vector<Lit> reordered;
+        reordered.reserve(literals.size());
+        size_t head = 0;
+        for (unsigned root = 0; root < variables; ++root) {
+            if (name[root] != empty) continue;
+            name[root] = order.size();
+            order.push_back(root);
+            for (; head < order.size(); ++head) {
+                ResourceBudget::poll();
+                const unsigned var = order[head];
+                for (unsigned k = offsets[var]; k < offsets[var + 1]; ++k) {
+                    const unsigned c = occurrences[k];
+                    if (emitted[c]) continue;
+                    emitted[c] = true;
+                    const unsigned start = starts[c];
+                    reordered.push_back(literals[start]);
+                    for (unsigned i = start + 1; i < start + literals[start].x; ++i) {
+                        const Lit lit = literals[i];
+                        if (name[lit.var()] == empty) {
+                            name[lit.var()] = order.size();
+                            order.push_back(lit.var());
+                        }
+                        reordered.push_back(Lit(name[lit.var()], lit.sign()));
+                    }
+                }
+            }
+        }
+        literals.swap(reordered);
     }
 
     inline size_t nVars() const {
@@ -130,47 +214,34 @@ class IntervalCNFFormula {
     MutClauses mut_clauses() {
         return MutClauses {{literals.begin()}, {literals.end()}};
     }
+    template <typename Clause>
+    inline void pushClause(const Clause& clause) {
+        literals.push_back({});
+        literals.back().x = clause.size() + 1; // including length slot
+        literals.insert(literals.end(), clause.begin(), clause.end());
+        ++n_clauses;
+        n_literals += clause.size();
+    }
+
     // create gapless representation of variables
     void normalizeVariableNames() {
-        std::vector<unsigned> name;
-        constexpr unsigned empty = ~0U;
-        name.resize(variables+1, empty);
-        unsigned max = 0;
+        VariableRenaming names(variables);
         for (MutClause cl : mut_clauses()) {
-            for (Lit& lit : cl) {
-                if (name[lit.var()] == empty) name[lit.var()] = max++;
-                lit = Lit(name[lit.var()], lit.sign());
-            }
+            names.apply(cl);
         }
-        variables = max;
+        variables = names.size();
     }
 
-    void readDimacsFromFile(const char* filename, const bool shrink_to_fit) {
-        StreamBuffer in(filename);
-        while (in.skipWhitespace()) {
-            if (*in == 'p' || *in == 'c') {
-                if (!in.skipLine()) break;
-            } else {
-                literals.push_back({});
-                unsigned length = 1; // including length slot
-                int plit;
-                while (in.readInteger(&plit)) {
-                    if (plit == 0) break;
-                    const unsigned var = abs(plit);
-                    literals.push_back(Lit(var, plit < 0));
-                    ++length;
-                    if (var > variables) variables = var;
-                }
-                if (length != 1) {
-                    literals[literals.size() - length].x = length;
-                    ++n_clauses;
-                    n_literals += length - 1;
-                } else
-                    literals.pop_back();
-            }
-        }
-        if (shrink_to_fit) literals.shrink_to_fit();
-        normalizeVariableNames();
+    // names of variables are made gapless while loading, the literal array of packed files is allocated once from the header counts
+    void readDimacsFromFile(const char* filename, const bool shrink_to_fit, const unsigned threads = 1) {
+        const FormulaHint hint = allocation_hint(filename);
+        if (hint.literals > 0) literals.reserve(hint.literals + hint.clauses);
+        VariableRenaming names(hint.vars);
+        load_formula(filename, threads, names, [this] (const Cl& clause) {
+            if (!clause.empty()) pushClause(clause);
+        });
+        variables = names.size();
+        if (shrink_to_fit && hint.literals == 0) literals.shrink_to_fit();
     }
 };
 
@@ -0,0 +1,317 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_MULTIMD5_H_
+#define SRC_UTIL_MULTIMD5_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/**
+ * Multi-buffer MD5: hashes Engine::lanes independent messages at once, one per 32 bit lane of a vector register.
+ * Digests are identical to the ones of src/external/md5 (and md5sum), only the throughput per core differs.
+ * Vectors use the GCC/Clang vector extensions, the compiler maps them to SSE2 (AVX2 if supported at runtime),
+ * NEON, or scalar code. Lanes advance in lockstep by one 64 byte block, so callers should feed all lanes
+ * with chunks of similar size, lanes without a full block are masked in that step.
+ */
+namespace MultiMD5 {
+    typedef uint32_t Vec __attribute__((vector_size(32)));
+
+#define MULTIMD5_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MULTIMD5_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define MULTIMD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MULTIMD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+#define MULTIMD5_STEP(f, a, b, c, d, w, t, s) \
+    a += f(b, c, d) + (w) + static_cast<uint32_t>(t); \
+    a = (a << (s)) | (a >> (32 - (s))); \
+    a += b;
+
+    /**
+     * @brief MD5 compression function on vectors of lanes or on a single lane (V = uint32_t)
+     * @param state a, b, c, d
+     * @param x the 16 little endian message words of the block
+     */
+    template <typename V>
+    __attribute__((always_inline)) inline void compress(V* state, const V* x) {
+        V a = state[0], b = state[1], c = state[2], d = state[3];
+
+        MULTIMD5_STEP(MULTIMD5_F, a, b, c, d, x[0], 0xd76aa478, 7)
+        MULTIMD5_STEP(MULTIMD5_F, d, a, b, c, x[1], 0xe8c7b756, 12)
+        MULTIMD5_STEP(MULTIMD5_F, c, d, a, b, x[2], 0x242070db, 17)
+        MULTIMD5_STEP(MULTIMD5_F, b, c, d, a, x[3], 0xc1bdceee, 22)
+        MULTIMD5_STEP(MULTIMD5_F, a, b, c, d, x[4], 0xf57c0faf, 7)
+        MULTIMD5_STEP(MULTIMD5_F, d, a, b, c, x[5], 0x4787c62a, 12)
+        MULTIMD5_STEP(MULTIMD5_F, c, d, a, b, x[6], 0xa8304613, 17)
+        MULTIMD5_STEP(MULTIMD5_F, b, c, d, a, x[7], 0xfd469501, 22)
+        MULTIMD5_STEP(MULTIMD5_F, a, b, c, d, x[8], 0x698098d8, 7)
+        MULTIMD5_STEP(MULTIMD5_F, d, a, b, c, x[9], 0x8b44f7af, 12)
+        MULTIMD5_STEP(MULTIMD5_F, c, d, a, b, x[10], 0xffff5bb1, 17)
+        MULTIMD5_STEP(MULTIMD5_F, b, c, d, a, x[11], 0x895cd7be, 22)
+        MULTIMD5_STEP(MULTIMD5_F, a, b, c, d, x[12], 0x6b901122, 7)
+        MULTIMD5_STEP(MULTIMD5_F, d, a, b, c, x[13], 0xfd987193, 12)
+        MULTIMD5_STEP(MULTIMD5_F, c, d, a, b, x[14], 0xa679438e, 17)
+        MULTIMD5_STEP(MULTIMD5_F, b, c, d, a, x[15], 0x49b40821, 22)
+
+        MULTIMD5_STEP(MULTIMD5_G, a, b, c, d, x[1], 0xf61e2562, 5)
+        MULTIMD5_STEP(MULTIMD5_G, d, a, b, c, x[6], 0xc040b340, 9)
+        MULTIMD5_STEP(MULTIMD5_G, c, d, a, b, x[11], 0x265e5a51, 14)
+        MULTIMD5_STEP(MULTIMD5_G, b, c, d, a, x[0], 0xe9b6c7aa, 20)
+        MULTIMD5_STEP(MULTIMD5_G, a, b, c, d, x[5], 0xd62f105d, 5)
+        MULTIMD5_STEP(MULTIMD5_G, d, a, b, c, x[10], 0x02441453, 9)
+        MULTIMD5_STEP(MULTIMD5_G, c, d, a, b, x[15], 0xd8a1e681, 14)
+        MULTIMD5_STEP(MULTIMD5_G, b, c, d, a, x[4], 0xe7d3fbc8, 20)
+        MULTIMD5_STEP(MULTIMD5_G, a, b, c, d, x[9], 0x21e1cde6, 5)
+        MULTIMD5_STEP(MULTIMD5_G, d, a, b, c, x[14], 0xc33707d6, 9)
+        MULTIMD5_STEP(MULTIMD5_G, c, d, a, b, x[3], 0xf4d50d87, 14)
+        MULTIMD5_STEP(MULTIMD5_G, b, c, d, a, x[8], 0x455a14ed, 20)
+        MULTIMD5_STEP(MULTIMD5_G, a, b, c, d, x[13], 0xa9e3e905, 5)
+        MULTIMD5_STEP(MULTIMD5_G, d, a, b, c, x[2], 0xfcefa3f8, 9)
+        MULTIMD5_STEP(MULTIMD5_G, c, d, a, b, x[7], 0x676f02d9, 14)
+        MULTIMD5_STEP(MULTIMD5_G, b, c, d, a, x[12], 0x8d2a4c8a, 20)
+
+        MULTIMD5_STEP(MULTIMD5_H, a, b, c, d, x[5], 0xfffa3942, 4)
+        MULTIMD5_STEP(MULTIMD5_H, d, a, b, c, x[8], 0x8771f681, 11)
+        MULTIMD5_STEP(MULTIMD5_H, c, d, a, b, x[11], 0x6d9d6122, 16)
+        MULTIMD5_STEP(MULTIMD5_H, b, c, d, a, x[14], 0xfde5380c, 23)
+        MULTIMD5_STEP(MULTIMD5_H, a, b, c, d, x[1], 0xa4beea44, 4)
+        MULTIMD5_STEP(MULTIMD5_H, d, a, b, c, x[4], 0x4bdecfa9, 11)
+        MULTIMD5_STEP(MULTIMD5_H, c, d, a, b, x[7], 0xf6bb4b60, 16)
+        MULTIMD5_STEP(MULTIMD5_H, b, c, d, a, x[10], 0xbebfbc70, 23)
+        MULTIMD5_STEP(MULTIMD5_H, a, b, c, d, x[13], 0x289b7ec6, 4)
+        MULTIMD5_STEP(MULTIMD5_H, d, a, b, c, x[0], 0xeaa127fa, 11)
+        MULTIMD5_STEP(MULTIMD5_H, c, d, a, b, x[3], 0xd4ef3085, 16)
+        MULTIMD5_STEP(MULTIMD5_H, b, c, d, a, x[6], 0x04881d05, 23)
+        MULTIMD5_STEP(MULTIMD5_H, a, b, c, d, x[9], 0xd9d4d039, 4)
+        MULTIMD5_STEP(MULTIMD5_H, d, a, b, c, x[12], 0xe6db99e5, 11)
+        MULTIMD5_STEP(MULTIMD5_H, c, d, a, b, x[15], 0x1fa27cf8, 16)
+        MULTIMD5_STEP(MULTIMD5_H, b, c, d, a, x[2], 0xc4ac5665, 23)
+
+        MULTIMD5_STEP(MULTIMD5_I, a, b, c, d, x[0], 0xf4292244, 6)
+        MULTIMD5_STEP(MULTIMD5_I, d, a, b, c, x[7], 0x432aff97, 10)
+        MULTIMD5_STEP(MULTIMD5_I, c, d, a, b, x[14], 0xab9423a7, 15)
+        MULTIMD5_STEP(MULTIMD5_I, b, c, d, a, x[5], 0xfc93a039, 21)
+        MULTIMD5_STEP(MULTIMD5_I, a, b, c, d, x[12], 0x655b59c3, 6)
+        MULTIMD5_STEP(MULTIMD5_I, d, a, b, c, x[3], 0x8f0ccc92, 10)
+        MULTIMD5_STEP(MULTIMD5_I, c, d, a, b, x[10], 0xffeff47d, 15)
+        MULTIMD5_STEP(MULTIMD5_I, b, c, d, a, x[1], 0x85845dd1, 21)
+        MULTIMD5_STEP(MULTIMD5_I, a, b, c, d, x[8], 0x6fa87e4f, 6)
+        MULTIMD5_STEP(MULTIMD5_I, d, a, b, c, x[15], 0xfe2ce6e0, 10)
+        MULTIMD5_STEP(MULTIMD5_I, c, d, a, b, x[6], 0xa3014314, 15)
+        MULTIMD5_STEP(MULTIMD5_I, b, c, d, a, x[13], 0x4e0811a1, 21)
+        MULTIMD5_STEP(MULTIMD5_I, a, b, c, d, x[4], 0xf7537e82, 6)
+        MULTIMD5_STEP(MULTIMD5_I, d, a, b, c, x[11], 0xbd3af235, 10)
+        MULTIMD5_STEP(MULTIMD5_I, c, d, a, b, x[2], 0x2ad7d2bb, 15)
+        MULTIMD5_STEP(MULTIMD5_I, b, c, d, a, x[9], 0xeb86d391, 21)
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+    }
+
+#undef MULTIMD5_F
+#undef MULTIMD5_G
+#undef MULTIMD5_H
+#undef MULTIMD5_I
+#undef MULTIMD5_STEP
+
+    inline void compress_generic(Vec* state, const Vec* x) {
+        compress(state, x);
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("avx2"))) inline void compress_avx2(Vec* state, const Vec* x) {
+        compress(state, x);
+    }
+#endif
+
+    /**
+     * @brief vector compression function of the best instruction set supported by the cpu
+     */
+    inline void (*select_compress())(Vec*, const Vec*) {
+    #if defined(__x86_64__) || defined(__i386__)
+        if (__builtin_cpu_supports("avx2")) return compress_avx2;
+    #endif
+        return compress_generic;
+    }
+
+    // little endian word at p, compiles to a plain load on little endian machines
+    inline uint32_t load_le32(const unsigned char* p) {
+        return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    /**
+     * @brief MD5 of a single message, the state is plain data such that it can be saved and resumed later
+     */
+    struct Stream {
+        uint32_t state[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+        uint64_t length = 0;  // bytes consumed
+        unsigned char pending[64] = { };  // partial block
+        uint32_t n_pending = 0;
+
+        void update(const char* data, size_t size) {
+            const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+            length += size;
+            if (n_pending > 0) {
+                const size_t fill = std::min<size_t>(64 - n_pending, size);
+                std::memcpy(pending + n_pending, in, fill);
+                n_pending += fill;
+                in += fill;
+                size -= fill;
+                if (n_pending < 64) return;
+                block(pending);
+                n_pending = 0;
+            }
+            for (; size >= 64; in += 64, size -= 64) block(in);
+            std::memcpy(pending, in, size);
+            n_pending = size;
+        }
+
+        /**
+         * @brief digest of the message consumed so far, the stream can be continued afterwards
+         * @return digest as 32 lower case hex digits, like MD5::produce()
+         */
+        std::string digest() const {
+            uint32_t s[4] = { state[0], state[1], state[2], state[3] };
+            unsigned char padded[128] = { };
+            unsigned n = n_pending;
+            std::memcpy(padded, pending, n);
+            padded[n++] = 0x80;
+            const unsigned n_blocks = n + 8 <= 64 ? 1 : 2;
+            const uint64_t bits = length * 8;
+            for (unsigned i = 0; i < 8; ++i) padded[64 * n_blocks - 8 + i] = static_cast<unsigned char>(bits >> (8 * i));
+            for (unsigned b = 0; b < n_blocks; ++b) {
+                uint32_t x[16];
+                for (unsigned i = 0; i < 16; ++i) x[i] = load_le32(padded + 64 * b + 4 * i);
+                compress(s, x);
+            }
+            static constexpr char hex[] = "0123456789abcdef";
+            std::string result(32, '0');
+            for (unsigned i = 0; i < 16; ++i) {
+                const unsigned char byte = static_cast<unsigned char>(s[i / 4] >> (8 * (i % 4)));
+                result[2 * i] = hex[byte >> 4];
+                result[2 * i + 1] = hex[byte & 15];
+            }
+            return result;
+        }
+
+     private:
+        void block(const unsigned char* data) {
+            uint32_t x[16];
+            for (unsigned i = 0; i < 16; ++i) x[i] = load_le32(data + 4 * i);
+            compress(state, x);
+        }
+    };
+
+    class Engine {
+     public:
+        static constexpr unsigned lanes = sizeof(Vec) / sizeof(uint32_t);
+
+     private:
+        Vec state[4];
+        uint64_t length[lanes] = { };  // bytes consumed per lane
+        unsigned char pending[lanes][64];  // partial block per lane
+        unsigned n_pending[lanes] = { };
+        void (*compress_vec)(Vec*, const Vec*) = select_compress();
+
+     public:
+        Engine() {
+            for (unsigned lane = 0; lane < lanes; ++lane) reset(lane);
+        }
+
+        /**
+         * @brief start a new message in the given lane
+         */
+        void reset(unsigned lane) {
+            state[0][lane] = 0x67452301;
+            state[1][lane] = 0xefcdab89;
+            state[2][lane] = 0x98badcfe;
+            state[3][lane] = 0x10325476;
+            length[lane] = 0;
+            n_pending[lane] = 0;
+        }
+
+        /**
+         * @brief append data[lane] of size[lane] bytes to the message of each lane, size zero for idle lanes
+         */
+        void update(const char* const* data, const size_t* size) {
+            size_t pos[lanes] = { };
+            for (unsigned lane = 0; lane < lanes; ++lane) length[lane] += size[lane];
+            for (;;) {
+                Vec x[16];
+                unsigned mask = 0;
+                for (unsigned lane = 0; lane < lanes; ++lane) {
+                    const unsigned char* block = nullptr;
+                    const size_t available = size[lane] - pos[lane];
+                    if (n_pending[lane] + available >= 64) {
+                        const unsigned char* in = reinterpret_cast<const unsigned char*>(data[lane]) + pos[lane];
+                        if (n_pending[lane] > 0) {
+                            const unsigned fill = 64 - n_pending[lane];
+                            std::memcpy(pending[lane] + n_pending[lane], in, fill);
+                            pos[lane] += fill;
+                            n_pending[lane] = 0;
+                            block = pending[lane];
+                        } else {
+                            block = in;
+                            pos[lane] += 64;
+                        }
+                        mask |= 1u << lane;
+                    }
+                    for (unsigned i = 0; i < 16; ++i) x[i][lane] = block ? load_le32(block + 4 * i) : 0;
+                }
+                if (mask == 0) break;
+                if (mask == (1u << lanes) - 1) {
+                    compress_vec(state, x);
+                } else {
+                    Vec saved[4] = { state[0], state[1], state[2], state[3] };
+                    compress_vec(state, x);
+                    for (unsigned lane = 0; lane < lanes; ++lane) {
+                        if (mask & (1u << lane)) continue;
+                        for (unsigned k = 0; k < 4; ++k) state[k][lane] = saved[k][lane];
+                    }
+                }
+            }
+            for (unsigned lane = 0; lane < lanes; ++lane) {
+                const size_t rest = size[lane] - pos[lane];
+                std::memcpy(pending[lane] + n_pending[lane], data[lane] + pos[lane], rest);
+                n_pending[lane] += rest;
+            }
+        }
+
+        /**
+         * @brief pad the message of the given lane, the lane has to be reset before it is used again
+         * @return digest as 32 lower case hex digits, like MD5::produce()
+         */
+        std::string finish(unsigned lane) const;
+    };
+
+    inline std::string Engine::finish(unsigned lane) const {
+        Stream stream;
+        for (unsigned k = 0; k < 4; ++k) stream.state[k] = state[k][lane];
+        stream.length = length[lane];
+        std::memcpy(stream.pending, pending[lane], n_pending[lane]);
+        stream.n_pending = n_pending[lane];
+        return stream.digest();
+    }
+}  // namespace MultiMD5
+
+#endif  // SRC_UTIL_MULTIMD5_H_
@@ -25,7 +25,8 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include <memory>
 #include <string>
 
-#include "src/util/StreamBuffer.h"
+#include "src/util/FormulaLoader.h"
+#include "src/util/Profile.h"
 #include "src/util/SolverTypes.h"
 
 class NaiveCNFFormula {
@@ -34,8 +35,13 @@ class NaiveCNFFormula {
     unsigned literals = 0;
 
  public:
-    explicit inline NaiveCNFFormula(const char* filename, const bool shrink_to_fit) {
-        readDimacsFromFile(filename, shrink_to_fit);
+    /**
+     * @param threads parse plain DIMACS files with this many threads
+     */
+    explicit inline NaiveCNFFormula(const char* filename, const bool shrink_to_fit, const unsigned threads = 1) {
+        Profile::Scope scope("parse");
+        readDimacsFromFile(filename, shrink_to_fit, threads);
+        Profile::count("clauses", nClauses());
     }
     NaiveCNFFormula(const NaiveCNFFormula&) = delete;
     NaiveCNFFormula& operator=(const NaiveCNFFormula&) = delete;
@@ -101,45 +107,19 @@ class NaiveCNFFormula {
     }
 
  private:
-    // create gapless representation of variables
-    void normalizeVariableNames() {
-        std::vector<unsigned> name;
-        constexpr unsigned empty = ~0U;
-        name.resize(variables+1, empty);
-        unsigned int max = 0;
-        for (Cl* clause : formula) {
-            for (Lit& lit : *clause) {
-                if (name[lit.var()] == empty) name[lit.var()] = max++;
-                lit = Lit(name[lit.var()], lit.sign());
-            }
-        }
-        variables = max;
-    }
-
-    void readDimacsFromFile(const char* filename, const bool shrink_to_fit) {
-        StreamBuffer in(filename);
-        while (in.skipWhitespace()) {
-            if (*in == 'p' || *in == 'c') {
-                if (!in.skipLine()) break;
-            } else {
-                Cl* clause = new Cl;
-                int plit;
-                while (in.readInteger(&plit)) {
-                    if (plit == 0) break;
-                    const unsigned var = abs(plit);
-                    clause->push_back(Lit(var, plit < 0));
-                    if (var > variables) variables = var;
-                }
-                if (clause->size() == 0) {
-                    delete clause;
-                    continue;
-                }
-                if (shrink_to_fit) clause->shrink_to_fit();
-                formula.push_back(clause);
-                literals += clause->size();
-            }
-        }
-        normalizeVariableNames();
+    // names of variables are made gapless while loading
+    void readDimacsFromFile(const char* filename, const bool shrink_to_fit, const unsigned threads = 1) {
+        const FormulaHint hint = allocation_hint(filename);
+        formula.reserve(hint.clauses);
+        VariableRenaming names(hint.vars);
+        load_formula(filename, threads, names, [&] (const Cl& clause) {
+            if (clause.empty()) return;
+            Cl* copy = new Cl(clause);
+            if (shrink_to_fit) copy->shrink_to_fit();
+            formula.push_back(copy);
+            literals += clause.size();
+        });
+        variables = names.size();
     }
 };
 
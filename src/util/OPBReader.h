@@ -0,0 +1,161 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_OPBREADER_H_
+#define SRC_UTIL_OPBREADER_H_
+
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "src/util/StreamBuffer.h"
+
+/**
+ * Tokenizer for OPB files which is shared by OPB::gbdhash() and OPB::BaseFeatures:
+ * the objective and each constraint are read into one reused term arena,
+ * numbers are kept as int64 values and as normalized text (as produced by StreamBuffer::readNumber()),
+ * such that no allocations happen per term once the arena has grown to the longest constraint.
+ */
+namespace OPB {
+    /**
+     * @brief span of normalized text in the arena of the reader
+     */
+    struct Span {
+        uint32_t begin = 0;
+        uint32_t end = 0;
+    };
+
+    struct Token {
+        enum Kind : uint8_t { NUMBER, POSITIVE, NEGATIVE };  // coefficient, x<var>, ~x<var>
+        Kind kind = NUMBER;
+        bool big = false;  // number exceeds int64, only its text is valid
+        int64_t value = 0;
+        Span text;  // digits with sign, without the literal prefix
+    };
+
+    struct Constraint {
+        enum Rel { GE, LE, EQ };
+        bool objective = false;
+        std::vector<Token> terms;  // left hand side
+        Rel rel = GE;
+        Span relation;  // relation operator as written, e.g. ">="
+        Token bound;
+    };
+
+    class Reader {
+        StreamBuffer in;
+        std::string text_;
+        Constraint constraint_;
+
+        void read_number(Token& token) {
+            token.text.begin = text_.size();
+            if (!in.appendNumber(text_)) {
+                throw ParserException("unexpected end of opb file");
+            }
+            token.text.end = text_.size();
+            const char* begin = text_.data() + token.text.begin;
+            const char* end = text_.data() + token.text.end;
+            token.big = std::from_chars(begin, end, token.value).ec != std::errc();
+        }
+
+        void read_token() {
+            Token token;
+            if (*in == 'x') {
+                token.kind = Token::POSITIVE;
+                in.skip();
+            } else if (*in == '~') {
+                token.kind = Token::NEGATIVE;
+                in.skip();
+                in.skipWhitespace();
+                in.skip();
+            }
+            read_number(token);
+            constraint_.terms.push_back(token);
+            in.skipWhitespace();
+        }
+
+     public:
+        explicit Reader(const char* filename) : in(filename) { }
+
+        /**
+         * @brief read the next objective or constraint, comment lines are skipped
+         * @throw ParserException if the file ends within a constraint
+         * @return false if the end of file is reached
+         */
+        bool next() {
+            while (in.skipWhitespace()) {
+                if (*in == '*') {
+                    if (!in.skipLine()) return false;
+                    continue;
+                }
+                text_.clear();
+                constraint_.terms.clear();
+                if (*in == 'm') {
+                    constraint_.objective = true;
+                    in.skipString("min:");
+                    in.skipWhitespace();
+                    while (*in != ';') {
+                        if (in.eof()) throw ParserException("unexpected end of opb file");
+                        read_token();
+                    }
+                } else {
+                    constraint_.objective = false;
+                    while (*in != '>' && *in != '<' && *in != '=') {
+                        if (in.eof()) throw ParserException("unexpected end of opb file");
+                        read_token();
+                    }
+                    constraint_.rel = *in == '>' ? Constraint::GE : *in == '<' ? Constraint::LE : Constraint::EQ;
+                    constraint_.relation.begin = text_.size();
+                    while (*in == '>' || *in == '<' || *in == '=') {
+                        text_.push_back(*in);
+                        in.skip();
+                    }
+                    constraint_.relation.end = text_.size();
+                    read_number(constraint_.bound);
+                    in.skipWhitespace();
+                }
+                if (*in == ';') in.skip();
+                return true;
+            }
+            return false;
+        }
+
+        const Constraint& constraint() const {
+            return constraint_;
+        }
+
+        std::string_view text(Span span) const {
+            return std::string_view(text_.data() + span.begin, span.end - span.begin);
+        }
+
+        /**
+         * @return value of the given number, big numbers are converted from their text
+         */
+        double toDouble(const Token& token) const {
+            if (!token.big) return static_cast<double>(token.value);
+            return std::strtod(std::string(text(token.text)).c_str(), nullptr);
+        }
+    };
+} // namespace OPB
+
+#endif  // SRC_UTIL_OPBREADER_H_
@@ -0,0 +1,240 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_PARALLELDIMACS_H_
+#define SRC_UTIL_PARALLELDIMACS_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <string>
+#include <vector>
+
+#include "src/util/SolverTypes.h"
+#include "src/util/StreamBuffer.h"
+#include "src/util/BinaryCNF.h"
+#include "src/util/Profile.h"
+#include "src/util/ResourceBudget.h"
+
+/**
+ * Parallel loader for plain (uncompressed) DIMACS CNF files:
+ * the memory mapped file is split at line breaks into chunks which are parsed on worker threads,
+ * clauses which span a chunk boundary are stitched together on the calling thread.
+ * Clauses are delivered in file order with the semantics of StreamBuffer::readClause().
+ * Worker threads run under child budgets of the caller's ResourceBudget, see ResourceBudget(const ResourceBudget*).
+ */
+namespace ParallelDimacs {
+    /**
+     * @brief zero terminated clauses of a chunk, the first one continues the unterminated tail of the previous chunk
+     */
+    struct Chunk {
+        std::vector<Lit> literals;
+        std::vector<unsigned> sizes;
+        std::vector<Lit> tail;  // literals after the last zero
+        char skipped = 0;  // 'c' or 'p' if such a line was skipped before the first number, see continue_clause()
+    };
+
+    /**
+     * @brief check the start of a chunk which continues a clause, lines of comments or problems
+     * are only skipped between clauses, as by StreamBuffer::readClause()
+     * @param skipped Chunk::skipped of the chunk
+     * @param open true if the continued clause has literals
+     * @throw ParserException if the chunk skipped a line inside of a clause
+     */
+    inline void continue_clause(char skipped, bool open, const char* filename) {
+        if (skipped != 0 && open) {
+            throw ParserException(std::string(filename) + ": unexpected character: " + skipped);
+        }
+    }
+
+    /**
+     * @brief parse the given range, which starts at the beginning of a line
+     * @throw ParserException on malformed input
+     */
+    inline Chunk parse(const char* cur, const char* end, const char* filename) {
+        Chunk chunk;
+        chunk.literals.reserve((end - cur) / 4);
+        size_t clause_start = 0;  // clause in progress starts here in chunk.literals
+        while (cur < end) {
+            const char c = *cur;
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                ++cur;
+            } else if ((c == 'c' || c == 'p') && chunk.literals.size() == clause_start) {
+                if (chunk.literals.empty() && chunk.sizes.empty() && chunk.skipped == 0) chunk.skipped = c;
+                cur = static_cast<const char*>(std::memchr(cur, '\n', end - cur));
+                if (cur == nullptr) break;
+            } else {
+                const bool negative = (c == '-');
+                if (negative || c == '+') ++cur;
+                const char* digits = cur;
+                uint64_t number = 0;
+                while (cur < end && *cur >= '0' && *cur <= '9' && number <= static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) {
+                    number = number * 10 + (*cur - '0');
+                    ++cur;
+                }
+                if (cur == digits) {
+                    throw ParserException(std::string(filename) + ": unexpected character: " + c);
+                }
+                if ((cur < end && *cur >= '0' && *cur <= '9') || number > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())) {
+                    throw ParserException(std::string(filename) + ": number out of int32 range");
+                }
+                if (number == 0) {
+                    chunk.sizes.push_back(chunk.literals.size() - clause_start);
+                    clause_start = chunk.literals.size();
+                } else {
+                    chunk.literals.push_back(Lit(static_cast<unsigned>(number), negative));
+                }
+            }
+        }
+        chunk.tail.assign(chunk.literals.begin() + clause_start, chunk.literals.end());
+        chunk.literals.resize(clause_start);
+        return chunk;
+    }
+
+    /**
+     * @return true if the file can be loaded in parallel, i.e., it is neither packed nor compressed
+     */
+    inline bool supported(const char* filename) {
+        if (BinaryCNF::is_packed(filename)) return false;
+        std::ifstream file(filename, std::ios::binary);
+        char head[64];
+        file.read(head, sizeof(head));
+        const std::streamsize n = file.gcount();
+        if (n < 4) return false;
+        // magic numbers of xz, gzip, bzip2 and zstd
+        if (std::memcmp(head, "\xFD" "7zXZ", std::min<std::streamsize>(n, 5)) == 0) return false;
+        if (std::memcmp(head, "\x1F\x8B", 2) == 0 || std::memcmp(head, "BZh", 3) == 0 || std::memcmp(head, "\x28\xB5\x2F\xFD", 4) == 0) return false;
+        // text files do not contain control characters
+        for (std::streamsize i = 0; i < n; ++i) {
+            const unsigned char c = head[i];
+            if ((c < 0x20 && !std::isspace(c)) || c == 0x7F) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief parse the chunks of the plain DIMACS file on worker threads and pass the results to merge in file order
+     * @param work callable with argument Chunk&&, called on worker threads with the chunk they parsed
+     * @param merge callable with the result of work, called on the calling thread, returns false to stop early
+     * @param chunk_size approximate number of bytes per chunk, 0 selects several chunks per thread between 1 MB and 64 MB
+     * @throw ParserException if the file can not be mapped or is malformed
+     */
+    template <typename Work, typename Merge>
+    void map_chunks(const char* filename, const unsigned threads, Work&& work, Merge&& merge, size_t chunk_size = 0) {
+        int fd = open(filename, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) close(fd);
+            throw ParserException(std::string("Error opening file: ") + filename);
+        }
+        const size_t size = st.st_size;
+        if (size == 0) {
+            close(fd);
+            return;
+        }
+        void* region = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (region == MAP_FAILED) {
+            throw ParserException(std::string("Error mapping file: ") + filename);
+        }
+        madvise(region, size, MADV_SEQUENTIAL);
+        Profile::count("bytes_read", size);
+        const char* data = static_cast<const char*>(region);
+
+        // several chunks per thread such that memory of parsed but unmerged chunks stays bounded
+        if (chunk_size == 0) chunk_size = std::clamp<size_t>(size / (4 * std::max(threads, 1u)), 1 << 20, 64 << 20);
+        auto next_start = [data, size] (size_t pos) {
+            if (pos >= size) return size;
+            const void* eol = std::memchr(data + pos, '\n', size - pos);
+            return eol ? static_cast<const char*>(eol) - data + 1 : size;
+        };
+
+        typedef decltype(work(std::declval<Chunk>())) Result;
+        std::deque<std::future<Result>> in_flight;
+        size_t begin = 0;
+        auto launch = [&] () {
+            const size_t end = next_start(begin + chunk_size);
+            const char* first = data + begin;
+            const char* last = data + end;
+            auto budget = std::make_shared<ResourceBudget>(ResourceBudget::current());  // chunks are accounted to the task
+            in_flight.push_back(std::async(std::launch::async, [&work, first, last, filename, budget] () {
+                ResourceBudget::Scope scope(*budget);
+                return work(parse(first, last, filename));
+            }));
+            begin = end;
+        };
+
+        try {
+            while (begin < size || !in_flight.empty()) {
+                while (begin < size && in_flight.size() < 2 * std::max(threads, 1u)) launch();
+                Result result = in_flight.front().get();
+                in_flight.pop_front();
+                if (!merge(std::move(result))) break;
+                ResourceBudget::check();
+            }
+        }
+        catch (...) {
+            // the future of a failed chunk has been consumed by get()
+            for (auto& future : in_flight) if (future.valid()) future.wait();
+            munmap(region, size);
+            throw;
+        }
+        for (auto& future : in_flight) future.wait();
+        munmap(region, size);
+    }
+
+    /**
+     * @brief parse the plain DIMACS file with the given number of threads and pass all clauses in file order to add
+     * @param add callable with argument const Cl&, called on the calling thread
+     * @param chunk_size approximate number of bytes per chunk, see map_chunks()
+     * @throw ParserException if the file can not be mapped or is malformed
+     */
+    template <typename AddClause>
+    void read(const char* filename, const unsigned threads, AddClause&& add, size_t chunk_size = 0) {
+        Cl clause;
+        map_chunks(filename, threads, [] (Chunk&& chunk) { return std::move(chunk); }, [&] (Chunk&& chunk) {
+            continue_clause(chunk.skipped, !clause.empty(), filename);
+            auto lit = chunk.literals.begin();
+            for (unsigned length : chunk.sizes) {
+                clause.insert(clause.end(), lit, lit + length);
+                lit += length;
+                add(static_cast<const Cl&>(clause));
+                clause.clear();
+            }
+            clause.insert(clause.end(), chunk.tail.begin(), chunk.tail.end());
+            return true;
+        }, chunk_size);
+        // last clause is not terminated
+        if (!clause.empty()) add(static_cast<const Cl&>(clause));
+    }
+}  // namespace ParallelDimacs
+
+#endif  // SRC_UTIL_PARALLELDIMACS_H_
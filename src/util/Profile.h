@@ -0,0 +1,202 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+
+/**
+ * @brief Lightweight instrumentation of tool phases (decompress, parse, analyze, summarize, ...).
+ * Recording is switched on at runtime with Profile::enable() (gbdc --profile, gbdc.enable_profile())
+ * and compiled out with -DGBDC_NO_PROFILE. Phases accumulate calls, wall and CPU time of the
+ * calling thread in nanoseconds and the peak resident set size of the process at their end.
+ * Nested phases are reported inclusively. Counters accumulate amounts like bytes or clauses.
+ * Phases are meant for coarse grained scopes (per file or buffer refill), not per clause.
+ */
+namespace Profile {
+    struct Phase {
+        uint64_t calls = 0;
+        uint64_t wall_ns = 0;
+        uint64_t cpu_ns = 0;
+        uint64_t peak_rss_kb = 0;
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::map<std::string, Phase> phases;
+        std::map<std::string, uint64_t> counters;
+    };
+
+    inline std::atomic<bool> enabled_ { false };
+
+    inline Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    inline void enable(bool on = true) {
+        enabled_.store(on, std::memory_order_relaxed);
+    }
+
+    inline bool enabled() {
+    #ifdef GBDC_NO_PROFILE
+        return false;
+    #else
+        return enabled_.load(std::memory_order_relaxed);
+    #endif
+    }
+
+    inline uint64_t wall_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // cpu time of calling thread, zero if not supported
+    inline uint64_t cpu_ns() {
+    #if defined(CLOCK_THREAD_CPUTIME_ID)
+        struct timespec time;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0) {
+            return static_cast<uint64_t>(time.tv_sec) * 1000000000ull + time.tv_nsec;
+        }
+    #endif
+        return 0;
+    }
+
+    inline uint64_t peak_rss_kb() {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    #ifdef __APPLE__
+        return usage.ru_maxrss / 1024;  // bytes
+    #else
+        return usage.ru_maxrss;
+    #endif
+    }
+
+    /**
+     * @brief adds n to the named counter
+     */
+    inline void count(const char* name, uint64_t n) {
+        if (!enabled()) return;
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.counters[name] += n;
+    }
+
+    /**
+     * @brief records the lifetime of the scope as one call of the named phase
+     * The phase is registered by the constructor, so the destructor does not allocate and
+     * cannot throw while unwinding, e.g. from a memory limit of a ResourceBudget.
+     */
+    class Scope {
+    #ifndef GBDC_NO_PROFILE
+        Phase* phase_ = nullptr;
+        uint64_t wall_ = 0;
+        uint64_t cpu_ = 0;
+
+     public:
+        explicit Scope(const char* name) {
+            if (enabled()) {
+                Registry& r = registry();
+                {
+                    std::lock_guard<std::mutex> lock(r.mutex);
+                    phase_ = &r.phases[name];
+                }
+                wall_ = wall_ns();
+                cpu_ = cpu_ns();
+            }
+        }
+
+        ~Scope() {
+            if (phase_ == nullptr) return;
+            const uint64_t wall = wall_ns() - wall_;
+            const uint64_t cpu = cpu_ns() - cpu_;
+            const uint64_t rss = peak_rss_kb();
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            Phase& phase = *phase_;
+            ++phase.calls;
+            phase.wall_ns += wall;
+            phase.cpu_ns += cpu;
+            phase.peak_rss_kb = std::max(phase.peak_rss_kb, rss);
+        }
+    #else
+     public:
+        explicit Scope(const char*) { }
+    #endif
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // phases are zeroed rather than erased, open scopes still point to them
+    inline void reset() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (auto& entry : r.phases) entry.second = Phase();
+        r.counters.clear();
+    }
+
+    /**
+     * @return flat list of measurements, "<phase>.calls", "<phase>.wall_ns", "<phase>.cpu_ns",
+     * "<phase>.peak_rss_kb" for each phase and "<counter>" for each counter
+     */
+    inline std::vector<std::pair<std::string, uint64_t>> report() {
+        std::vector<std::pair<std::string, uint64_t>> result;
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (const auto& [name, phase] : r.phases) {
+            if (phase.calls == 0) continue;
+            result.emplace_back(name + ".calls", phase.calls);
+            result.emplace_back(name + ".wall_ns", phase.wall_ns);
+            result.emplace_back(name + ".cpu_ns", phase.cpu_ns);
+            result.emplace_back(name + ".peak_rss_kb", phase.peak_rss_kb);
+        }
+        for (const auto& [name, value] : r.counters) {
+            result.emplace_back(name, value);
+        }
+        return result;
+    }
+
+    /**
+     * @brief prints one comment line per phase and counter
+     */
+    inline void print(std::ostream& out) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (const auto& [name, phase] : r.phases) {
+            if (phase.calls == 0) continue;
+            out << "c profile " << name << " calls=" << phase.calls << " wall_ns=" << phase.wall_ns
+                << " cpu_ns=" << phase.cpu_ns << " peak_rss_kb=" << phase.peak_rss_kb << std::endl;
+        }
+        for (const auto& [name, value] : r.counters) {
+            out << "c profile " << name << "=" << value << std::endl;
+        }
+    }
+}  // namespace Profile
@@ -0,0 +1,40 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_REORDEREDCNFFORMULA
+#define SRC_UTIL_REORDEREDCNFFORMULA
+
+#include "src/util/IntervalCNFFormula.h"
+
+/**
+ * @brief IntervalCNFFormula with variables and clauses in breadth first order (see IntervalCNFFormula::reorder()),
+ * improves locality of algorithms which visit all clauses and access data of their variables, e.g., color propagation
+ */
+class ReorderedCNFFormula : public IntervalCNFFormula {
+ public:
+    /**
+     * @param threads parse plain DIMACS files with this many threads
+     */
+    explicit inline ReorderedCNFFormula(const char* filename, const bool shrink_to_fit, const unsigned threads = 1)
+     : IntervalCNFFormula(filename, shrink_to_fit, threads) {
+        reorder();
+    }
+};
+
+#endif  // SRC_UTIL_REORDEREDCNFFORMULA
@@ -0,0 +1,191 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#if defined(__APPLE__)
+    #include <malloc/malloc.h>
+#else
+    #include <malloc.h>
+#endif
+
+#include "src/util/ResourceBudget.h"
+
+/**
+ * Replacements of all global allocation functions (plain, array, aligned and nothrow) which
+ * account heap memory to the ResourceBudget of the calling thread. Memory is obtained from
+ * malloc() (posix_memalign() if aligned) and sizes are taken from the allocator, such that
+ * blocks can be released by any translation unit (also those which still use the default
+ * operator delete). Blocks are not tagged with their budget: a block released on a thread with
+ * another budget (or none) is credited to that budget, which never drops below zero by this.
+ */
+
+static inline size_t allocated_size(void* ptr) {
+#if defined(__APPLE__)
+    return malloc_size(ptr);
+#elif defined(_WIN32)
+    return _msize(ptr);
+#else
+    return malloc_usable_size(ptr);
+#endif
+}
+
+static inline void* aligned_malloc(std::size_t size, std::size_t alignment) {
+#if defined(_WIN32)
+    return _aligned_malloc(size, alignment);
+#else
+    void* ptr;
+    return posix_memalign(&ptr, std::max(alignment, sizeof(void*)), size) == 0 ? ptr : nullptr;
+#endif
+}
+
+static inline size_t aligned_size(void* ptr, std::size_t alignment) {
+#if defined(_WIN32)
+    return _aligned_msize(ptr, alignment, 0);
+#else
+    (void) alignment;
+    return allocated_size(ptr);
+#endif
+}
+
+static inline void aligned_free(void* ptr) {
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+static void* budget_new(std::size_t size, std::size_t alignment = 0) {
+    if (size == 0) size = 1;
+    void* ptr;
+    while ((ptr = alignment == 0 ? std::malloc(size) : aligned_malloc(size, alignment)) == nullptr) {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) throw std::bad_alloc();
+        handler();
+    }
+    if (!ResourceBudget::allocate(alignment == 0 ? allocated_size(ptr) : aligned_size(ptr, alignment))) {
+        if (alignment == 0) std::free(ptr);
+        else aligned_free(ptr);
+        throw MemoryLimitExceeded();
+    }
+    return ptr;
+}
+
+static void* budget_new_nothrow(std::size_t size, std::size_t alignment = 0) noexcept {
+    try {
+        return budget_new(size, alignment);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+static void budget_delete(void* ptr) noexcept {
+    if (ptr == nullptr) return;
+    ResourceBudget::deallocate(allocated_size(ptr));
+    std::free(ptr);
+}
+
+static void budget_delete(void* ptr, std::align_val_t alignment) noexcept {
+    if (ptr == nullptr) return;
+    ResourceBudget::deallocate(aligned_size(ptr, static_cast<std::size_t>(alignment)));
+    aligned_free(ptr);
+}
+
+void* operator new(std::size_t size) {
+    return budget_new(size);
+}
+
+void* operator new[](std::size_t size) {
+    return budget_new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return budget_new_nothrow(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return budget_new_nothrow(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return budget_new(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return budget_new(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return budget_new_nothrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return budget_new_nothrow(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept {
+    budget_delete(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    budget_delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    budget_delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    budget_delete(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    budget_delete(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    budget_delete(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t alignment) noexcept {
+    budget_delete(ptr, alignment);
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept {
+    budget_delete(ptr, alignment);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+    budget_delete(ptr, alignment);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+    budget_delete(ptr, alignment);
+}
+
+void operator delete(void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    budget_delete(ptr, alignment);
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    budget_delete(ptr, alignment);
+}
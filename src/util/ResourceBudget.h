@@ -0,0 +1,214 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <limits>
+
+#include "src/util/ResourceLimits.h"
+
+/**
+ * @brief Cooperative resource budget of a single task.
+ * Unlike ResourceLimits it does not touch process-wide rlimits or signal handlers,
+ * such that several tasks can run concurrently in one process, each on its own thread.
+ * Parsers and long running loops call ResourceBudget::poll(), which throws
+ * TimeLimitExceeded if the budget of the task running on the calling thread is exhausted.
+ * Heap allocations of the calling thread are accounted by the replaced global
+ * operator new (see ResourceBudget.cc), which throws MemoryLimitExceeded.
+ * Budgets are per thread: threads without an installed budget are neither limited nor accounted.
+ * Helper threads of a task install a child budget (see ResourceBudget(const ResourceBudget*)),
+ * which shares the memory account of the task. The time limit is cpu time of each thread,
+ * such that a task with k threads may use up to k times its time limit in total.
+ */
+class ResourceBudget {
+    double rlim_;   // time limit (seconds), zero means unlimited
+    double start_;
+
+    int64_t mlim_;  // memory limit (bytes), zero means unlimited
+    std::atomic<int64_t> memory_ { 0 };  // bytes currently allocated by the task
+    std::atomic<int64_t> peak_ { 0 };
+    ResourceBudget* account_ = this;  // budget which accounts the memory, the task's own for child budgets
+
+    static inline thread_local ResourceBudget* current_ = nullptr;
+    static inline thread_local unsigned countdown_ = 0;
+
+ public:
+    // number of calls to poll() between two clock readings
+    static constexpr unsigned poll_interval = 1024;
+
+    /**
+     * @param rlim time limit in seconds (cpu time of the calling thread)
+     * @param mlim memory limit in mega bytes (heap allocations of the calling thread)
+     */
+    explicit ResourceBudget(double rlim = 0, unsigned mlim = 0)
+     : rlim_(rlim), start_(get_thread_time()), mlim_(static_cast<int64_t>(mlim) << 20) { }
+
+    /**
+     * @brief budget of a helper thread of the task which owns parent, construct on the thread of parent
+     * Allocations are accounted to the memory limit of the task. The time limit is the remaining time
+     * of parent, measured in cpu time of the helper thread from the moment the budget is installed there.
+     * Without parent the budget is unlimited.
+     * @param parent budget of the spawning thread, usually current(), may be nullptr
+     */
+    explicit ResourceBudget(const ResourceBudget* parent) : ResourceBudget() {
+        if (parent == nullptr) return;
+        if (parent->rlim_ > 0) rlim_ = std::max(parent->rlim_ - parent->get_runtime(), 1e-9);
+        account_ = parent->account_;
+    }
+
+    ResourceBudget(const ResourceBudget&) = delete;
+    ResourceBudget& operator=(const ResourceBudget&) = delete;
+
+    /**
+     * @brief budget installed on the calling thread, nullptr if there is none
+     */
+    static ResourceBudget* current() {
+        return current_;
+    }
+
+    /**
+     * @brief installs a budget for the calling thread during its lifetime
+     */
+    class Scope {
+        ResourceBudget* previous_;
+
+     public:
+        explicit Scope(ResourceBudget& budget) : previous_(current_) {
+            if (budget.account_ != &budget) budget.start_ = get_thread_time();  // child budget on helper thread
+            current_ = &budget;
+            countdown_ = 0;
+        }
+
+        ~Scope() {
+            current_ = previous_;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // runtime of the task (seconds)
+    double get_runtime() const {
+        return get_thread_time() - start_;
+    }
+
+    // peak memory of the task (mega bytes)
+    unsigned get_memory() const {
+        return static_cast<unsigned>(account_->peak_.load(std::memory_order_relaxed) >> 20);
+    }
+
+    bool within_time_limit() const {
+        return rlim_ == 0 || get_runtime() <= rlim_;
+    }
+
+    void within_limits_or_throw() const {
+        if (!within_time_limit()) throw TimeLimitExceeded();
+    }
+
+    /**
+     * @brief cheap check of the current thread's budget, reads the clock only every poll_interval calls
+     * @throw TimeLimitExceeded if budget is exhausted
+     */
+    static inline void poll() {
+        if (current_ != nullptr && ++countdown_ >= poll_interval) {
+            countdown_ = 0;
+            current_->within_limits_or_throw();
+        }
+    }
+
+    /**
+     * @brief immediate check of the current thread's budget, for coarse grained call sites
+     * @throw TimeLimitExceeded if budget is exhausted
+     */
+    static inline void check() {
+        if (current_ != nullptr) current_->within_limits_or_throw();
+    }
+
+    /**
+     * @brief account allocation of given size to the current thread's budget
+     * @return false if allocation exceeds the memory limit (nothing is accounted then)
+     */
+    static inline bool allocate(size_t size) {
+        if (current_ == nullptr) return true;
+        ResourceBudget* account = current_->account_;
+        const int64_t memory = account->memory_.fetch_add(size, std::memory_order_relaxed) + static_cast<int64_t>(size);
+        if (account->mlim_ > 0 && memory > account->mlim_) {
+            account->memory_.fetch_sub(size, std::memory_order_relaxed);
+            return false;
+        }
+        int64_t peak = account->peak_.load(std::memory_order_relaxed);
+        while (memory > peak && !account->peak_.compare_exchange_weak(peak, memory, std::memory_order_relaxed)) { }
+        return true;
+    }
+
+    /**
+     * @brief memory the calling thread can still allocate (bytes), for components which trade memory for i/o
+     * Minimum of the remaining memory of the current thread's budget and of the remaining address space
+     * under RLIMIT_AS (as set by ResourceLimits), the maximum of int64_t if neither is limited.
+     * Reads /proc/self/statm if RLIMIT_AS is set, so call it at coarse grained sites only.
+     */
+    static int64_t available_memory() {
+        int64_t available = std::numeric_limits<int64_t>::max();
+        if (current_ != nullptr && current_->account_->mlim_ > 0) {
+            const ResourceBudget* account = current_->account_;
+            available = std::max<int64_t>(account->mlim_ - account->memory_.load(std::memory_order_relaxed), 0);
+        }
+    #if defined(__linux__)
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_AS, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+            unsigned long pages = 0;
+            FILE* statm = std::fopen("/proc/self/statm", "r");
+            if (statm != nullptr) {
+                if (std::fscanf(statm, "%lu", &pages) != 1) pages = 0;
+                std::fclose(statm);
+            }
+            const int64_t used = static_cast<int64_t>(pages) * sysconf(_SC_PAGESIZE);
+            available = std::min<int64_t>(available, std::max<int64_t>(static_cast<int64_t>(limit.rlim_cur) - used, 0));
+        }
+    #endif
+        return available;
+    }
+
+    // blocks of other budgets may be released here, the account is clamped at zero
+    static inline void deallocate(size_t size) {
+        if (current_ == nullptr) return;
+        std::atomic<int64_t>& memory = current_->account_->memory_;
+        int64_t value = memory.load(std::memory_order_relaxed);
+        while (!memory.compare_exchange_weak(value, std::max<int64_t>(value - static_cast<int64_t>(size), 0), std::memory_order_relaxed)) { }
+    }
+
+ private:
+    // cpu time of calling thread in seconds, wallclock time if not supported
+    static double get_thread_time() {
+    #if defined(CLOCK_THREAD_CPUTIME_ID)
+        struct timespec time;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0) {
+            return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) * 1e-9;
+        }
+    #endif
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
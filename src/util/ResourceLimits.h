@@ -72,19 +72,19 @@ struct ResourceLimitsNotSupported : public std::exception {
     }
 };
 
-struct rlimit cpu_limit;
+inline struct rlimit cpu_limit;
 static void timeout(int signal) {
     setrlimit(RLIMIT_CPU, &cpu_limit);
     throw TimeLimitExceeded();
 }
 
-struct rlimit as_limit;
+inline struct rlimit as_limit;
 static void memout() {
     setrlimit(RLIMIT_AS, &as_limit);
     throw MemoryLimitExceeded();
 }
 
-struct rlimit fsize_limit;
+inline struct rlimit fsize_limit;
 static void fileout(int signal) {
     setrlimit(RLIMIT_FSIZE, &fsize_limit);
     throw FileSizeLimitExceeded();
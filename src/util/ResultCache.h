@@ -0,0 +1,162 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_RESULTCACHE_H_
+#define SRC_UTIL_RESULTCACHE_H_
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+#include "src/util/Batch.h"
+
+/**
+ * @brief Persistent cache of results in a directory, one file per entry
+ * Entries are keyed by the identity of the input file (device, inode, size, modification time),
+ * the task name and the cache version, so modified or replaced files are never served from the cache.
+ * The task name has to determine the result, i.e., encode every parameter which changes the output
+ * (results of the extractors do not depend on their number of threads).
+ * Entries are published by atomic rename, such that concurrent readers and writers
+ * (threads or processes of a pool) never observe partially written entries.
+ */
+class ResultCache {
+    std::filesystem::path dir_;
+
+    // returns empty key if the file can not be identified
+    static std::string key(const std::string& filename, const std::string& task) {
+        struct stat st;
+        if (stat(filename.c_str(), &st) != 0) return "";
+        std::error_code ec;
+        const auto mtime = std::filesystem::last_write_time(filename, ec);
+        if (ec) return "";
+        std::ostringstream str;
+        str << version << " " << task << " " << st.st_dev << " " << st.st_ino << " " << st.st_size << " " << mtime.time_since_epoch().count();
+        return str.str();
+    }
+
+    std::filesystem::path entry(const std::string& key) const {
+        // xxh3 is stable across platforms and runs, collisions are detected by the key in the entry
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(XXH3_64bits(key.data(), key.size())));
+        return dir_ / std::string(name, 2) / name;
+    }
+
+    static bool parse(std::istream& in, const std::string& key, BatchRecord& record) {
+        std::string line;
+        if (!std::getline(in, line) || line != key) return false;  // hash collision or foreign file
+        BatchRecord result;
+        while (std::getline(in, line)) {
+            const size_t tab1 = line.find('\t');
+            const size_t tab2 = tab1 == std::string::npos ? tab1 : line.find('\t', tab1 + 1);
+            if (tab2 != tab1 + 2) return false;
+            const std::string value = line.substr(tab2 + 1);
+            if (line[tab1 + 1] == 'd') {
+                result.emplace_back(line.substr(0, tab1), std::strtod(value.c_str(), nullptr));
+            } else if (line[tab1 + 1] == 's') {
+                result.emplace_back(line.substr(0, tab1), value);
+            } else {
+                return false;
+            }
+        }
+        record.swap(result);
+        return true;
+    }
+
+ public:
+    static constexpr const char* version = "gbdc-cache-2";  // change whenever the results of a task change
+
+    explicit ResultCache(const std::string& directory) : dir_(directory) { }
+
+    /**
+     * @brief look up the cached result of task for the given file
+     * @return true if a valid entry was found and written to record
+     */
+    bool lookup(const std::string& filename, const std::string& task, BatchRecord& record) const {
+        const std::string k = key(filename, task);
+        if (k.empty()) return false;
+        std::ifstream in(entry(k));
+        return in.is_open() && parse(in, k, record);
+    }
+
+    /**
+     * @brief store the result of task for the given file, values must not contain tabs or newlines
+     * @return true if the entry was published
+     */
+    bool store(const std::string& filename, const std::string& task, const BatchRecord& record) const {
+        const std::string k = key(filename, task);
+        if (k.empty()) return false;
+        const std::filesystem::path path = entry(k);
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+        if (ec) return false;
+
+        static std::atomic<unsigned> counter(0);
+        std::ostringstream tmpname;
+        tmpname << "." << path.filename().string() << "." << getpid() << "." << std::this_thread::get_id() << "." << counter++;
+        const std::filesystem::path tmp = path.parent_path() / tmpname.str();
+        {
+            std::ofstream out(tmp);
+            out << k << "\n";
+            char number[32];
+            for (const auto& [name, value] : record) {
+                if (const double* d = std::get_if<double>(&value)) {
+                    snprintf(number, sizeof(number), "%.17g", *d);
+                    out << name << "\td\t" << number << "\n";
+                } else {
+                    out << name << "\ts\t" << std::get<std::string>(value) << "\n";
+                }
+            }
+            if (!out.flush()) {
+                out.close();
+                std::filesystem::remove(tmp, ec);
+                return false;
+            }
+        }
+        std::filesystem::rename(tmp, path, ec);  // atomic replace
+        if (!ec) return true;
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+
+    /**
+     * @brief return the cached result of task for the given file, or compute and store it
+     */
+    BatchRecord get_or_compute(const std::string& filename, const std::string& task, const std::function<BatchRecord()>& compute) const {
+        BatchRecord record;
+        if (lookup(filename, task, record)) return record;
+        record = compute();
+        store(filename, task, record);
+        return record;
+    }
+};
+
+#endif  // SRC_UTIL_RESULTCACHE_H_
@@ -0,0 +1,392 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_SERVER_H_
+#define SRC_UTIL_SERVER_H_
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "src/util/Batch.h"
+
+/**
+ * JSON lines server of "gbdc serve", each request is a flat JSON object on a single line, e.g.,
+ *   {"id": 7, "task": "id", "file": "a.cnf.xz", "timeout": 10, "memout": 2048}
+ * Requests are queued and run on a pool of long-lived worker threads, each under its own ResourceBudget (see run_task()),
+ * timeout and memout are optional and default to the limits given on the command line.
+ * Responses are streamed in completion order, they repeat the id (if any) followed by the record of the task,
+ * malformed requests (also lines of more than max_request bytes and invalid limits) are answered with {"id": ..., "error": message}.
+ * Clients are trusted to the extent that tasks read any file the server can read, the unix socket is therefore only
+ * accessible by the user running the server (mode 0600).
+ */
+namespace Server {
+    using Handler = std::function<BatchRecord(const std::string& task, const std::string& file)>;
+
+    // maximum length of a request line in bytes, longer lines are discarded
+    inline constexpr size_t max_request = 1 << 16;
+
+    struct Field {
+        std::string key;
+        BatchValue value;
+        std::string raw;  // JSON text of the value
+    };
+
+    /**
+     * @brief parse a flat JSON object of strings, numbers, booleans (as 0 and 1) and null (skipped)
+     * @throw std::runtime_error on malformed input
+     */
+    inline std::vector<Field> parse_object(const std::string& line) {
+        size_t pos = 0;
+        auto fail = [&line, &pos] (const char* what) {
+            throw std::runtime_error(std::string(what) + " at column " + std::to_string(pos + 1));
+        };
+        auto skip = [&] () {
+            while (pos < line.size() && std::isspace(static_cast<unsigned char>(line[pos]))) ++pos;
+        };
+        auto expect = [&] (char c) {
+            skip();
+            if (pos >= line.size() || line[pos] != c) fail("unexpected character");
+            ++pos;
+        };
+        auto string = [&] () {
+            expect('"');
+            std::string result;
+            while (pos < line.size() && line[pos] != '"') {
+                char c = line[pos++];
+                if (c == '\\') {
+                    if (pos >= line.size()) fail("unterminated string");
+                    c = line[pos++];
+                    switch (c) {
+                        case 'n': result += '\n'; break;
+                        case 't': result += '\t'; break;
+                        case 'r': result += '\r'; break;
+                        case 'b': result += '\b'; break;
+                        case 'f': result += '\f'; break;
+                        case 'u': {
+                            if (pos + 4 > line.size()) fail("bad escape");
+                            const unsigned code = std::stoul(line.substr(pos, 4), nullptr, 16);
+                            pos += 4;
+                            // basic multilingual plane as utf-8, surrogate pairs are not combined
+                            if (code < 0x80) {
+                                result += static_cast<char>(code);
+                            } else if (code < 0x800) {
+                                result += static_cast<char>(0xC0 | (code >> 6));
+                                result += static_cast<char>(0x80 | (code & 0x3F));
+                            } else {
+                                result += static_cast<char>(0xE0 | (code >> 12));
+                                result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                                result += static_cast<char>(0x80 | (code & 0x3F));
+                            }
+                            break;
+                        }
+                        default: result += c;
+                    }
+                } else {
+                    result += c;
+                }
+            }
+            if (pos >= line.size()) fail("unterminated string");
+            ++pos;
+            return result;
+        };
+
+        std::vector<Field> fields;
+        expect('{');
+        skip();
+        if (pos < line.size() && line[pos] == '}') {
+            ++pos;
+        } else {
+            for (;;) {
+                Field field;
+                field.key = string();
+                expect(':');
+                skip();
+                const size_t begin = pos;
+                if (pos < line.size() && line[pos] == '"') {
+                    field.value = string();
+                } else if (line.compare(pos, 4, "true") == 0 || line.compare(pos, 5, "false") == 0) {
+                    field.value = line[pos] == 't' ? 1.0 : 0.0;
+                    pos += line[pos] == 't' ? 4 : 5;
+                } else if (line.compare(pos, 4, "null") == 0) {
+                    pos += 4;
+                    field.key.clear();
+                } else {
+                    char* end = nullptr;
+                    const double number = std::strtod(line.c_str() + pos, &end);
+                    if (end == line.c_str() + pos) fail("unexpected value");
+                    pos = end - line.c_str();
+                    field.value = number;
+                }
+                field.raw = line.substr(begin, pos - begin);
+                if (!field.key.empty()) fields.push_back(std::move(field));
+                skip();
+                if (pos < line.size() && line[pos] == ',') {
+                    ++pos;
+                    continue;
+                }
+                expect('}');
+                break;
+            }
+        }
+        skip();
+        if (pos != line.size()) fail("trailing characters");
+        return fields;
+    }
+
+    /**
+     * @brief fixed number of long-lived worker threads which run queued jobs in submission order
+     */
+    class Pool {
+        std::deque<std::function<void()>> queue_;
+        std::mutex mutex_;
+        std::condition_variable ready_;
+        bool stopping_ = false;
+        std::vector<std::thread> workers_;
+
+     public:
+        explicit Pool(unsigned threads) {
+            for (unsigned i = 0; i < std::max(threads, 1u); ++i) {
+                workers_.emplace_back([this] () {
+                    for (;;) {
+                        std::function<void()> job;
+                        {
+                            std::unique_lock<std::mutex> lock(mutex_);
+                            ready_.wait(lock, [this] () { return stopping_ || !queue_.empty(); });
+                            if (queue_.empty()) return;
+                            job = std::move(queue_.front());
+                            queue_.pop_front();
+                        }
+                        job();
+                    }
+                });
+            }
+        }
+
+        // runs the queued jobs before joining
+        ~Pool() {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            ready_.notify_all();
+            for (std::thread& worker : workers_) worker.join();
+        }
+
+        void submit(std::function<void()> job) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                queue_.push_back(std::move(job));
+            }
+            ready_.notify_one();
+        }
+    };
+
+    /**
+     * @brief queue the request of a single line, reply is called with the response line (without line break) on any thread
+     */
+    inline void submit(const std::string& line, Pool& pool, const Handler& handler, double rlim, unsigned mlim,
+                       const std::shared_ptr<std::function<void(const std::string&)>>& reply) {
+        std::string id;  // JSON text
+        auto respond = [reply] (const std::string& id, const BatchRecord& record) {
+            std::string json = BatchWriter::to_json(record);
+            if (!id.empty()) json.insert(1, "\"id\": " + id + (record.empty() ? "" : ", "));
+            (*reply)(json);
+        };
+        // limits are seconds and mega bytes, zero is unlimited
+        auto limit = [] (const Field& field, double max) {
+            const double value = std::get<double>(field.value);
+            if (!(value >= 0 && value <= max)) throw std::runtime_error("Invalid " + field.key + ": " + field.raw);
+            return value;
+        };
+        try {
+            if (line.size() > max_request) throw std::runtime_error("Request longer than " + std::to_string(max_request) + " bytes");
+            std::string task = "id", file;
+            for (const Field& field : parse_object(line)) {
+                if (field.key == "id") id = field.raw;
+                else if (field.key == "task" && std::holds_alternative<std::string>(field.value)) task = std::get<std::string>(field.value);
+                else if (field.key == "file" && std::holds_alternative<std::string>(field.value)) file = std::get<std::string>(field.value);
+                else if (field.key == "timeout" && std::holds_alternative<double>(field.value)) rlim = limit(field, std::numeric_limits<double>::max());
+                else if (field.key == "memout" && std::holds_alternative<double>(field.value)) mlim = static_cast<unsigned>(limit(field, UINT_MAX));
+            }
+            pool.submit([=, &handler] () {
+                std::string error;
+                BatchRecord record = run_task([&handler, &task] (const std::string& file) { return handler(task, file); }, file, rlim, mlim, &error);
+                if (!error.empty()) record.emplace_back("error", error);
+                respond(id, record);
+            });
+        }
+        catch (const std::exception& e) {
+            respond(id, BatchRecord { { "error", std::string(e.what()) } });
+        }
+    }
+
+    /**
+     * @brief splits chunks of a stream into request lines in bounded memory,
+     * a line of more than max_request bytes is submitted once truncated (and answered with an error), its rest is discarded
+     */
+    class LineSplitter {
+        std::string pending_;
+        bool overlong_ = false;  // rest of a discarded line is pending
+
+     public:
+        template <typename Submit>
+        void feed(const char* data, size_t size, const Submit& submit) {
+            pending_.append(data, size);
+            size_t begin = 0;
+            for (size_t eol; (eol = pending_.find('\n', begin)) != std::string::npos; begin = eol + 1) {
+                const std::string line = pending_.substr(begin, eol - begin);
+                if (!overlong_ && line.find_first_not_of(" \t\r") != std::string::npos) submit(line);
+                overlong_ = false;
+            }
+            pending_.erase(0, begin);
+            if (pending_.size() > max_request) {
+                if (!overlong_) submit(pending_);
+                overlong_ = true;
+                pending_.clear();
+            }
+        }
+
+        // submits the last line if it is not terminated by a line break
+        template <typename Submit>
+        void finish(const Submit& submit) {
+            if (!overlong_ && pending_.find_first_not_of(" \t\r") != std::string::npos) submit(pending_);
+            overlong_ = false;
+            pending_.clear();
+        }
+    };
+
+    /**
+     * @brief serve the requests of the input stream until it ends, responses go to out
+     */
+    inline void serve_stream(std::istream& in, std::ostream& out, unsigned threads, const Handler& handler, double rlim, unsigned mlim) {
+        auto mutex = std::make_shared<std::mutex>();
+        auto reply = std::make_shared<std::function<void(const std::string&)>>([mutex, &out] (const std::string& line) {
+            std::unique_lock<std::mutex> lock(*mutex);
+            out << line << std::endl;
+        });
+        Pool pool(threads);
+        auto request = [&] (const std::string& line) { submit(line, pool, handler, rlim, mlim, reply); };
+        LineSplitter splitter;
+        // bounded chunks, requests are submitted as soon as their line is complete
+        char buffer[1 << 12];
+        while (!in.bad()) {
+            in.getline(buffer, sizeof(buffer));
+            const size_t n = in.gcount();
+            if (in.eof()) {  // no line break
+                splitter.feed(buffer, n, request);
+                break;
+            }
+            if (in.fail()) {  // buffer is full and the line goes on
+                if (n == 0) break;
+                in.clear();
+                splitter.feed(buffer, n, request);
+            } else {  // n includes the extracted line break
+                buffer[n - 1] = '\n';
+                splitter.feed(buffer, n, request);
+            }
+        }
+        splitter.finish(request);
+    }
+
+    /**
+     * @brief serve the connections of a unix domain socket at path until the process is terminated,
+     * every connection is a stream of requests as in serve_stream(), all connections share the worker pool
+     * @throw std::runtime_error if the socket can not be created
+     */
+    inline void serve_socket(const std::string& path, unsigned threads, const Handler& handler, double rlim, unsigned mlim) {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) throw std::runtime_error("Socket path too long: " + path);
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0) throw std::runtime_error("Could not create socket");
+        unlink(path.c_str());
+        // only the owner may connect, clients can make the server read its files
+        if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || chmod(path.c_str(), S_IRUSR | S_IWUSR) != 0
+            || listen(listener, 64) != 0) {
+            close(listener);
+            throw std::runtime_error("Could not listen on " + path + ": " + std::strerror(errno));
+        }
+        // connection threads are detached and share ownership of handler and pool, they may outlive serve_socket()
+        struct Shared {
+            Handler handler;
+            Pool pool;  // destroyed first, its queued jobs use the handler
+            Shared(const Handler& handler, unsigned threads) : handler(handler), pool(threads) { }
+        };
+        const auto shared = std::make_shared<Shared>(handler, threads);
+        for (;;) {
+            const int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                close(listener);
+                throw std::runtime_error(std::string("Could not accept connection: ") + std::strerror(errno));
+            }
+            // the connection is closed when the reader is done and the last response is sent
+            auto connection = std::shared_ptr<int>(new int(fd), [] (int* fd) { close(*fd); delete fd; });
+            auto mutex = std::make_shared<std::mutex>();
+            auto reply = std::make_shared<std::function<void(const std::string&)>>([connection, mutex] (const std::string& line) {
+                std::unique_lock<std::mutex> lock(*mutex);
+                const std::string data = line + "\n";
+                for (size_t sent = 0; sent < data.size(); ) {
+                    const ssize_t n = send(*connection, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+                    if (n <= 0 && errno == EINTR) continue;
+                    if (n <= 0) return;  // client is gone
+                    sent += n;
+                }
+            });
+            std::thread([connection, reply, shared, rlim, mlim] () {
+                auto request = [&] (const std::string& line) { submit(line, shared->pool, shared->handler, rlim, mlim, reply); };
+                LineSplitter splitter;
+                char buffer[1 << 12];
+                for (;;) {
+                    const ssize_t n = read(*connection, buffer, sizeof(buffer));
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) break;
+                    splitter.feed(buffer, n, request);
+                }
+                splitter.finish(request);
+            }).detach();
+        }
+    }
+}  // namespace Server
+
+#endif  // SRC_UTIL_SERVER_H_
@@ -25,7 +25,8 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include <memory>
 #include <string>
 
-#include "src/util/StreamBuffer.h"
+#include "src/util/FormulaLoader.h"
+#include "src/util/Profile.h"
 #include "src/util/SolverTypes.h"
 
 class SizeGroupedCNFFormula {
@@ -35,8 +36,13 @@ class SizeGroupedCNFFormula {
     unsigned literals = 0;
 
  public:
-    explicit inline SizeGroupedCNFFormula(const char* filename, const bool shrink_to_fit) {
-        readDimacsFromFile(filename, shrink_to_fit);
+    /**
+     * @param threads parse plain DIMACS files with this many threads
+     */
+    explicit inline SizeGroupedCNFFormula(const char* filename, const bool shrink_to_fit, const unsigned threads = 1) {
+        Profile::Scope scope("parse");
+        readDimacsFromFile(filename, shrink_to_fit, threads);
+        Profile::count("clauses", nClauses());
     }
     ~SizeGroupedCNFFormula() {
         for (const std::vector<Lit>* clause_length : clause_length_literals)
@@ -110,21 +116,6 @@ class SizeGroupedCNFFormula {
     }
 
  private:
-    // create gapless representation of variables
-    void normalizeVariableNames() {
-        std::vector<unsigned> name;
-        constexpr unsigned empty = ~0U;
-        name.resize(variables+1, empty);
-        unsigned max = 0;
-        for (std::vector<Lit>* clause_length : clause_length_literals) {
-            for (Lit& lit : *clause_length) {
-                if (name[lit.var()] == empty) name[lit.var()] = max++;
-                lit = Lit(name[lit.var()], lit.sign());
-            }
-        }
-        variables = max;
-    }
-
     // https://stackoverflow.com/a/1322548/27720282
     static inline unsigned next_power_of_2(unsigned n) {
         n--;
@@ -136,40 +127,29 @@ class SizeGroupedCNFFormula {
         n++;
         return n;
     }
-    void readDimacsFromFile(const char* filename, const bool shrink_to_fit) {
-        StreamBuffer in(filename);
-        std::vector<Lit> clause;
-        while (in.skipWhitespace()) {
-            if (*in == 'p' || *in == 'c') {
-                if (!in.skipLine()) break;
-            } else {
-                int plit;
-                while (in.readInteger(&plit)) {
-                    if (plit == 0) break;
-                    const unsigned var = abs(plit);
-                    clause.push_back(Lit(var, plit < 0));
-                    if (var > variables) variables = var;
-                }
-                if (clause.size() >= clause_length_literals.size()) {
-                    const unsigned old_size = clause_length_literals.size();
-                    const unsigned new_size = clause.size() + 1;
-                    clause_length_literals.reserve(next_power_of_2(new_size));
-                    clause_length_literals.resize(new_size);
-                    for (auto it = clause_length_literals.begin() + old_size; it != clause_length_literals.end(); ++it)
-                        *it = new std::vector<Lit>;
-                }
-                std::vector<Lit>& insert_here = *clause_length_literals[clause.size()];
-                insert_here.reserve(next_power_of_2(insert_here.size() + clause.size()));
-                insert_here.insert(insert_here.end(), clause.begin(), clause.end());
-                ++n_clauses;
-                literals += clause.size();
-                clause.clear();
-            }
+    void addClause(const std::vector<Lit>& clause) {
+        if (clause.size() >= clause_length_literals.size()) {
+            const unsigned old_size = clause_length_literals.size();
+            const unsigned new_size = clause.size() + 1;
+            clause_length_literals.reserve(next_power_of_2(new_size));
+            clause_length_literals.resize(new_size);
+            for (auto it = clause_length_literals.begin() + old_size; it != clause_length_literals.end(); ++it)
+                *it = new std::vector<Lit>;
         }
+        std::vector<Lit>& insert_here = *clause_length_literals[clause.size()];
+        insert_here.reserve(next_power_of_2(insert_here.size() + clause.size()));
+        insert_here.insert(insert_here.end(), clause.begin(), clause.end());
+        ++n_clauses;
+        literals += clause.size();
+    }
+    // names of variables are made gapless while loading, in order of first occurrence in the file
+    void readDimacsFromFile(const char* filename, const bool shrink_to_fit, const unsigned threads = 1) {
+        VariableRenaming names(allocation_hint(filename).vars);
+        load_formula(filename, threads, names, [this] (const Cl& clause) { addClause(clause); });
+        variables = names.size();
         if (shrink_to_fit)
             for (std::vector<Lit>* clause_length : clause_length_literals)
                 clause_length->shrink_to_fit();
-        normalizeVariableNames();
     }
 };
 
@@ -0,0 +1,167 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_SKETCHES_H_
+#define SRC_UTIL_SKETCHES_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Streaming summaries of bounded size for sampled feature extraction (see CNF::ApproxFeatures)
+ */
+namespace Sketch {
+    // splitmix64 finalizer, spreads consecutive variable numbers over all bits
+    inline uint64_t mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    /**
+     * @brief HyperLogLog counter of distinct values with 2^precision registers,
+     * relative standard error is about 1.04 / sqrt(2^precision)
+     */
+    class HyperLogLog {
+        unsigned precision_;
+        std::vector<uint8_t> registers_;
+
+     public:
+        explicit HyperLogLog(unsigned precision = 12) : precision_(precision), registers_(1UL << precision, 0) { }
+
+        inline void add(uint64_t value) {
+            const uint64_t hash = mix(value);
+            const uint64_t index = hash >> (64 - precision_);
+            const uint64_t rest = hash << precision_;
+            const uint8_t rank = rest == 0 ? 64 - precision_ + 1 : __builtin_clzll(rest) + 1;
+            registers_[index] = std::max(registers_[index], rank);
+        }
+
+        double estimate() const {
+            const double m = registers_.size();
+            double sum = 0;
+            unsigned zeros = 0;
+            for (uint8_t r : registers_) {
+                sum += std::ldexp(1.0, -r);
+                if (r == 0) ++zeros;
+            }
+            const double raw = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+            // linear counting for small cardinalities
+            if (raw <= 2.5 * m && zeros > 0) return m * std::log(m / zeros);
+            return raw;
+        }
+
+        double relative_error() const {
+            return 1.04 / std::sqrt(static_cast<double>(registers_.size()));
+        }
+    };
+
+    /**
+     * @brief uniform sample of at most capacity values of a stream (algorithm R)
+     */
+    template <typename T>
+    class Reservoir {
+        size_t capacity_;
+        uint64_t seen_ = 0;
+        std::vector<T> sample_;
+        std::mt19937_64 rng_;
+
+     public:
+        explicit Reservoir(size_t capacity, uint64_t seed = 0) : capacity_(capacity), rng_(seed) { }
+
+        inline void add(const T& value) {
+            ++seen_;
+            if (sample_.size() < capacity_) {
+                sample_.push_back(value);
+            } else {
+                const uint64_t j = rng_() % seen_;
+                if (j < capacity_) sample_[j] = value;
+            }
+        }
+
+        uint64_t seen() const {
+            return seen_;
+        }
+
+        std::vector<T>& sample() {
+            return sample_;
+        }
+    };
+
+    /**
+     * @brief occurrence counts of a hash-selected subset of at most capacity variables,
+     * a variable is tracked iff the top level bits of its hash are zero, the level is raised when the capacity is exceeded.
+     * Counts of tracked variables are exact, such that quantiles of the counts of all variables can be estimated
+     * from a small uniform sample of the variables.
+     */
+    class VariableSample {
+        size_t capacity_;
+        unsigned level_ = 0;
+        std::unordered_map<uint64_t, uint64_t> counts_;
+
+        inline bool tracked(uint64_t var) const {
+            return level_ == 0 || (mix(var) >> (64 - level_)) == 0;
+        }
+
+     public:
+        explicit VariableSample(size_t capacity = 1 << 16) : capacity_(capacity) { }
+
+        inline void add(uint64_t var) {
+            if (!tracked(var)) return;
+            ++counts_[var];
+            while (counts_.size() > capacity_ && level_ < 63) {
+                ++level_;
+                for (auto it = counts_.begin(); it != counts_.end(); ) {
+                    it = tracked(it->first) ? std::next(it) : counts_.erase(it);
+                }
+            }
+        }
+
+        /**
+         * @param q quantile in [0, 1]
+         * @return q-quantile of the counts of the occurring variables (0 if none)
+         */
+        double quantile(double q) const {
+            if (counts_.empty()) return 0;
+            std::vector<uint64_t> values;
+            values.reserve(counts_.size());
+            for (const auto& entry : counts_) values.push_back(entry.second);
+            const size_t k = std::min(values.size() - 1, static_cast<size_t>(q * values.size()));
+            std::nth_element(values.begin(), values.begin() + k, values.end());
+            return values[k];
+        }
+
+        // fraction of the variables which are tracked
+        double rate() const {
+            return std::ldexp(1.0, -static_cast<int>(level_));
+        }
+
+        size_t size() const {
+            return counts_.size();
+        }
+    };
+}  // namespace Sketch
+
+#endif  // SRC_UTIL_SKETCHES_H_
@@ -84,6 +84,17 @@ template <class T> class Stamp {
         stamped[index] = stamp;
     }
 
+    /**
+     * @brief stamps index, for use as a set which is emptied by clear()
+     * @return true if index was not stamped before
+     */
+    inline bool insert(unsigned int index) {
+        assert(index < stamped.size());
+        if (stamped[index] == stamp) return false;
+        stamped[index] = stamp;
+        return true;
+    }
+
     inline bool operator[] (unsigned int index) const {
         assert(index < stamped.size());
         return isStamped(index);
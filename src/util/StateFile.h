@@ -0,0 +1,155 @@
+/*************************************************************************************************
+CNFTools -- Copyright (c) 2021, Markus Iser, KIT - Karlsruhe Institute of Technology
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+associated documentation files (the "Software"), to deal in the Software without restriction,
+including without limitation the rights to use, copy, modify, merge, publish, distribute,
+sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or
+substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT
+OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef SRC_UTIL_STATEFILE_H_
+#define SRC_UTIL_STATEFILE_H_
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Binary files which hold the state of resumable computations, e.g., the sidecar files of CNF::incremental().
+ * Values are written in native byte order, a state file is only meant to be read on the machine which wrote it.
+ * The format tag and version are checked when reading, states of other versions are rejected.
+ */
+namespace StateFile {
+    constexpr char magic[8] = { 'g', 'b', 'd', 'c', 's', 't', 'a', 't' };
+
+    class Writer {
+        std::string path_, tmp_;
+        std::FILE* file_;
+
+     public:
+        /**
+         * @brief the state becomes visible at path when commit() succeeds, an existing state is replaced atomically
+         * @throw std::runtime_error if the temporary file can not be created
+         */
+        Writer(const std::string& path, const std::string& format, uint32_t version)
+            : path_(path), tmp_(path + ".tmp" + std::to_string(getpid())), file_(std::fopen(tmp_.c_str(), "wb")) {
+            if (file_ == nullptr) throw std::runtime_error("Could not create state file " + tmp_);
+            std::fwrite(magic, 1, sizeof(magic), file_);
+            put(format);
+            put(version);
+        }
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        ~Writer() {
+            if (file_ != nullptr) {
+                std::fclose(file_);
+                std::remove(tmp_.c_str());
+            }
+        }
+
+        template <typename T>
+        void put(const T& value) {
+            static_assert(std::is_trivially_copyable<T>::value, "plain data only");
+            std::fwrite(&value, sizeof(T), 1, file_);
+        }
+
+        template <typename T>
+        void put(const std::vector<T>& values) {
+            static_assert(std::is_trivially_copyable<T>::value, "plain data only");
+            put<uint64_t>(values.size());
+            std::fwrite(values.data(), sizeof(T), values.size(), file_);
+        }
+
+        void put(const std::string& value) {
+            put<uint64_t>(value.size());
+            std::fwrite(value.data(), 1, value.size(), file_);
+        }
+
+        /**
+         * @throw std::runtime_error if the state could not be written completely
+         */
+        void commit() {
+            const bool ok = std::fflush(file_) == 0 && !std::ferror(file_);
+            std::fclose(file_);
+            file_ = nullptr;
+            if (!ok || std::rename(tmp_.c_str(), path_.c_str()) != 0) {
+                std::remove(tmp_.c_str());
+                throw std::runtime_error("Could not write state file " + path_);
+            }
+        }
+    };
+
+    class Reader {
+        std::unique_ptr<std::FILE, decltype(&std::fclose)> file_;
+
+        void read(void* data, size_t size) {
+            if (size > 0 && std::fread(data, 1, size, file_.get()) != size) {
+                throw std::runtime_error("Truncated state file");
+            }
+        }
+
+        // bound allocations for corrupt files
+        uint64_t length(size_t element_size) {
+            uint64_t n;
+            get(n);
+            if (element_size > 0 && n > (uint64_t(1) << 40) / element_size) throw std::runtime_error("Corrupt state file");
+            return n;
+        }
+
+     public:
+        /**
+         * @throw std::runtime_error if the file can not be opened or holds a state of another format or version
+         */
+        Reader(const std::string& path, const std::string& format, uint32_t version) : file_(std::fopen(path.c_str(), "rb"), &std::fclose) {
+            if (!file_) throw std::runtime_error("Could not open state file " + path);
+            char tag[sizeof(magic)];
+            read(tag, sizeof(tag));
+            std::string name;
+            uint32_t v;
+            get(name);
+            get(v);
+            if (std::memcmp(tag, magic, sizeof(magic)) != 0 || name != format || v != version) {
+                throw std::runtime_error("Incompatible state file " + path);
+            }
+        }
+
+        template <typename T>
+        void get(T& value) {
+            static_assert(std::is_trivially_copyable<T>::value, "plain data only");
+            read(&value, sizeof(T));
+        }
+
+        template <typename T>
+        void get(std::vector<T>& values) {
+            static_assert(std::is_trivially_copyable<T>::value, "plain data only");
+            values.resize(length(sizeof(T)));
+            read(values.data(), sizeof(T) * values.size());
+        }
+
+        void get(std::string& value) {
+            value.resize(length(1));
+            read(value.data(), value.size());
+        }
+    };
+}  // namespace StateFile
+
+#endif  // SRC_UTIL_STATEFILE_H_
@@ -23,13 +23,22 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include <archive.h>
 #include <archive_entry.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <cstring>
 #include <algorithm>
 #include <string>
 
 #include "SolverTypes.h"
+#include "Profile.h"
+#include "ResourceBudget.h"
+#include "ArchiveDecoder.h"
 
 class ParserException : public std::exception
 {
@@ -48,15 +57,66 @@ class StreamBuffer
 {
     struct archive *file;
 
-    unsigned int buffer_size;
+    size_t buffer_size;
+    bool adaptive; // grow buffer instead of failing on tokens longer than buffer
     char *buffer;
 
-    unsigned int pos; // current read position
-    unsigned int end; // 1+last valid position
+    size_t pos; // current read position
+    size_t end; // 1+last valid position
     bool end_of_file; // true when last chunk of file was read to buffer
 
     const char *filename_;
 
+    // locale independent replacements of isspace() and isdigit()
+    static inline bool is_space(char c)
+    {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    static inline bool is_digit(char c)
+    {
+        return static_cast<unsigned char>(c - '0') < 10;
+    }
+
+    size_t map_size; // size of memory mapping, zero if file is read via libarchive
+
+    std::unique_ptr<ArchiveDecoder> decoder; // decompresses on a separate thread if set
+
+    bool borrowed = false; // buffer is memory of the caller, see StreamBuffer(const char*, const char*, const char*)
+
+    /**
+     * @brief read next n bytes of the (decompressed) file, fewer only at end of file
+     * @throw ParserException on decompression errors
+     */
+    size_t read_data(char *dst, size_t n)
+    {
+        Profile::Scope scope("decompress");
+        if (decoder)
+        {
+            std::string error;
+            const size_t size = decoder->read(dst, n, error);
+            if (!error.empty())
+                throw ParserException(std::string(filename_) + ": " + error);
+            Profile::count("bytes_read", size);
+            return size;
+        }
+        size_t size = 0;
+        while (size < n)
+        {
+            ssize_t r = archive_read_data(file, dst + size, n - size);
+            if (r < 0)
+            {
+                const char *error = archive_error_string(file);
+                throw ParserException(std::string(filename_) + ": " + (error != nullptr ? error : "decompression failed"));
+            }
+            if (r == 0)
+                break;
+            size += r;
+        }
+        Profile::count("bytes_read", size);
+        return size;
+    }
+
     bool refill_buffer(bool align = true)
     {
         if (pos >= end && !end_of_file)
@@ -71,7 +131,8 @@ class StreamBuffer
             {
                 end = 0;
             }
-            end += archive_read_data(file, buffer + end, buffer_size - end);
+            end += read_data(buffer + end, buffer_size - end);
+            ResourceBudget::check();
             if (end < buffer_size)
             {
                 std::memset(buffer + end, 0, buffer_size - end);
@@ -92,19 +153,111 @@ class StreamBuffer
 
     void align_buffer()
     {
-        while (!isspace(buffer[end - 1]))
+        size_t token_end = end;
+        while (!is_space(buffer[token_end - 1]))
         { // align buffer with word-end
-            end--;
-            if (end < 1)
+            token_end--;
+            if (token_end < 1)
             {
-                throw ParserException(std::string("Error reading file: maximum token length exceeded"));
+                if (!adaptive)
+                {
+                    throw ParserException(std::string("Error reading file: maximum token length exceeded"));
+                }
+                grow_buffer();
+                if (end_of_file)
+                    return;
+                token_end = end;
             }
         }
+        end = token_end;
+    }
+
+    /**
+     * @brief double buffer size and append the next chunk of the file
+     * @pre buffer is completely filled with a single token
+     */
+    void grow_buffer()
+    {
+        char *grown = new char[2 * buffer_size];
+        std::copy(buffer, buffer + buffer_size, grown);
+        delete[] buffer;
+        buffer = grown;
+        end = buffer_size + read_data(buffer + buffer_size, buffer_size);
+        buffer_size *= 2;
+        if (end < buffer_size)
+        {
+            std::memset(buffer + end, 0, buffer_size - end);
+            end_of_file = true;
+        }
+    }
+
+    /**
+     * @brief map entire uncompressed file to memory, buffer then contains the whole file
+     * @return true if mapping succeeded, false otherwise (caller falls back to libarchive)
+     */
+    bool map_file()
+    {
+        int fd = open(filename_, O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+        {
+            close(fd);
+            return false;
+        }
+        const size_t file_size = st.st_size;
+        const size_t page_size = sysconf(_SC_PAGESIZE);
+        // reserve at least one zero byte behind the file content, it is no digit so the integer scanners stop there
+        const size_t size = (file_size / page_size + 1) * page_size;
+        void *region = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+        if (mmap(region, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+        {
+            munmap(region, size);
+            close(fd);
+            return false;
+        }
+        close(fd);
+        madvise(region, file_size, MADV_SEQUENTIAL);
+        map_size = size;
+        buffer = static_cast<char *>(region);
+        buffer_size = file_size;
+        pos = 0;
+        end = file_size;
+        end_of_file = true;
+        return true;
     }
 
 public:
-    explicit StreamBuffer(const char *filename) : buffer_size(16384), buffer(nullptr), pos(0), end(0), end_of_file(false), filename_(filename)
+    // defaults for all stream buffers, set from command line or python bindings
+    static inline size_t default_buffer_size = 1 << 20;
+    static inline bool default_adaptive = true;
+    static inline bool default_threaded = false;
+
+    /**
+     * @brief open file for reading, uncompressed files are mapped to memory
+     * @param filename the file to read
+     * @param size size of read buffer and libarchive block size in bytes
+     * @param grow whether the buffer grows on tokens longer than size
+     * @param threaded whether compressed files are decompressed on a separate thread
+     * @throw ParserException if file can not be opened
+     */
+    explicit StreamBuffer(const char *filename, size_t size = default_buffer_size, bool grow = default_adaptive, bool threaded = default_threaded)
+        : file(nullptr), buffer_size(std::max<size_t>(size, 2)), adaptive(grow), buffer(nullptr), pos(0), end(0), end_of_file(false), filename_(filename), map_size(0)
     {
+        // libarchive does not recognize empty input, an empty file is an empty stream
+        struct stat st;
+        if (stat(filename, &st) == 0 && S_ISREG(st.st_mode) && st.st_size == 0)
+        {
+            buffer = new char[buffer_size]();
+            end_of_file = true;
+            return;
+        }
         file = archive_read_new();
         archive_read_support_filter_all(file);
         archive_read_support_format_raw(file);
@@ -119,15 +272,46 @@ public:
         {
             throw ParserException(std::string("Error reading header: ") + std::string(filename));
         }
+        // zero-copy fast path for uncompressed files
+        if (archive_filter_count(file) == 1 && archive_filter_code(file, 0) == ARCHIVE_FILTER_NONE && map_file())
+        {
+            Profile::count("bytes_read", map_size);
+            archive_read_free(file);
+            file = nullptr;
+            return;
+        }
         buffer = new char[buffer_size];
+        if (threaded)
+            decoder = std::make_unique<ArchiveDecoder>(file, buffer_size);
         refill_buffer();
     }
 
+    /**
+     * @brief read the bytes [first, last) of memory owned by the caller, e.g. some lines of a mapped file
+     * @pre the range ends with whitespace, or the byte at last is readable and not a digit (like the zero behind a mapped file)
+     * @param filename name of the file in error messages
+     */
+    StreamBuffer(const char *first, const char *last, const char *filename)
+        : file(nullptr), buffer_size(last - first), adaptive(false), buffer(const_cast<char *>(first)), pos(0), end(last - first), end_of_file(true), filename_(filename), map_size(0), borrowed(true)
+    {
+    }
+
     ~StreamBuffer()
     {
-        archive_read_free(file);
-        if (buffer != nullptr && buffer[0] != '\0')
+        if (borrowed)
+        {
+            return;
+        }
+        if (map_size > 0)
+        {
+            munmap(buffer, map_size);
+        }
+        else
+        {
+            decoder.reset(); // joins decoder thread before archive is freed
+            archive_read_free(file);
             delete[] buffer;
+        }
     }
 
     char operator*() const
@@ -176,8 +360,9 @@ public:
                 return false;
         }
         // manually align buffer after line is skipped to be able to skip lines
-        // with words longer than the stream buffer
-        align_buffer();
+        // with words longer than the stream buffer, the last chunk is complete
+        if (!end_of_file)
+            align_buffer();
         return skipWhitespace();
     }
 
@@ -191,7 +376,7 @@ public:
         // needed if last call to fill_buffer left pos == end == 0
         if (eof())
             return false;
-        while (isspace(buffer[pos]))
+        while (is_space(buffer[pos]))
         {
             if (!skip())
                 return false;
@@ -245,17 +430,17 @@ public:
                 return false;
         }
 
-        if (!isdigit(buffer[pos]))
+        if (!is_digit(buffer[pos]))
         {
             if (!skipWhitespace())
                 return false;
-            if (!isdigit(buffer[pos]))
+            if (!is_digit(buffer[pos]))
             {
                 throw ParserException(std::string(filename_) + ": unexpected character: " + buffer[pos]);
             }
         }
 
-        while (isdigit(buffer[pos]))
+        while (is_digit(buffer[pos]))
         {
             if (!skip())
                 break;
@@ -275,36 +460,33 @@ public:
         if (!skipWhitespace())
             return false;
 
-        char *str = buffer + pos;
-        char *end = nullptr;
+        // buffer always ends with whitespace or zero, so scanning stops in bounds
+        const char *str = buffer + pos;
+        const char *cur = str;
+        const bool negative = (*cur == '-');
+        if (negative || *cur == '+')
+            ++cur;
 
-        errno = 0;
-        long number = strtol(str, &end, 10);
+        const char *digits = cur;
+        uint64_t number = 0;
+        while (is_digit(*cur) && number <= static_cast<uint64_t>(std::numeric_limits<int32_t>::max()))
+        {
+            number = number * 10 + (*cur - '0');
+            ++cur;
+        }
 
-        if (errno == 0)
+        if (cur == digits)
         {
-            if (end > str)
-            {
-                if (std::abs(number) <= std::numeric_limits<int32_t>::max())
-                {
-                    pos += static_cast<intptr_t>(end - str);
-                    *out = static_cast<int>(number);
-                    return true;
-                }
-                else
-                {
-                    throw ParserException(std::string(filename_) + ": number out of int32 range");
-                }
-            }
-            else
-            {
-                throw ParserException(std::string(filename_) + ": unexpected character: " + buffer[pos]);
-            }
+            throw ParserException(std::string(filename_) + ": unexpected character: " + buffer[pos]);
         }
-        else
+        if (is_digit(*cur) || number > static_cast<uint64_t>(std::numeric_limits<int32_t>::max()))
         {
-            throw ParserException(std::string(filename_) + ": strtol() errno: " + std::to_string(errno));
+            throw ParserException(std::string(filename_) + ": number out of int32 range");
         }
+
+        pos += cur - str;
+        *out = negative ? -static_cast<int>(number) : static_cast<int>(number);
+        return true;
     }
 
     /**
@@ -375,17 +557,17 @@ public:
                 return false;
         }
 
-        if (!isdigit(buffer[pos]))
+        if (!is_digit(buffer[pos]))
         {
             if (!skipWhitespace())
                 return false;
-            if (!isdigit(buffer[pos]))
+            if (!is_digit(buffer[pos]))
             {
                 throw ParserException(std::string(filename_) + ": unexpected character: " + buffer[pos]);
             }
         }
 
-        while (isdigit(buffer[pos]))
+        while (is_digit(buffer[pos]))
         {
             result.append(1, buffer[pos]);
             if (!skip())
@@ -396,6 +578,85 @@ public:
         return true;
     }
 
+    /**
+     * @brief read next number like readNumber(), but append its text to out without temporary strings
+     * @param out the string to append the number to
+     * @throw ParserException if no number could be read
+     * @return true if number was read before reaching eof, false otherwise (out is unchanged then)
+     */
+    bool appendNumber(std::string &out)
+    {
+        if (!skipWhitespace())
+            return false;
+
+        const bool negative = buffer[pos] == '-';
+        if (negative)
+        {
+            if (!skip())
+                return false;
+        }
+        else if (buffer[pos] == '+')
+        {
+            if (!skip())
+                return false;
+        }
+
+        if (!is_digit(buffer[pos]))
+        {
+            if (!skipWhitespace())
+                return false;
+            if (!is_digit(buffer[pos]))
+            {
+                throw ParserException(std::string(filename_) + ": unexpected character: " + buffer[pos]);
+            }
+        }
+
+        // sign is only appended with digits, out is unchanged if no number is read
+        if (negative)
+            out.push_back('-');
+
+        // buffer always ends with whitespace or zero, so scanning stops in bounds
+        const char *str = buffer + pos;
+        const char *cur = str;
+        while (is_digit(*cur))
+            ++cur;
+        out.append(str, cur - str);
+        pos += cur - str;
+        if (pos >= end)
+            refill_buffer();
+        return true;
+    }
+
+    /**
+     * @brief read problem line of the form "p <format> <vars> <clauses>" and skip the rest of it
+     * @pre current character is 'p'
+     * @param format expected format, e.g. "cnf"
+     * @param *vars number of variables, output parameter
+     * @param *clauses number of clauses, output parameter
+     * @return true if the line matched, false otherwise (malformed lines are skipped without throwing)
+     */
+    bool readHeader(const char *format, uint64_t *vars, uint64_t *clauses)
+    {
+        auto skipBlanks = [this]() {
+            while (buffer[pos] == ' ' || buffer[pos] == '\t')
+            {
+                if (!skip())
+                    return false;
+            }
+            return true;
+        };
+        bool valid = skip() && skipBlanks();
+        for (const char *c = format; valid && *c != '\0'; ++c)
+        {
+            valid = buffer[pos] == *c && skip();
+        }
+        valid = valid && skipBlanks() && is_digit(buffer[pos]) && readUInt64(vars);
+        valid = valid && skipBlanks() && is_digit(buffer[pos]) && readUInt64(clauses);
+        if (!eof())
+            skipLine();
+        return valid;
+    }
+
     /**
      * @brief read next clause
      * @param out the read clause, output parameter
@@ -403,8 +664,6 @@ public:
      */
     bool readClause(Cl &out)
     {
-        Cl clause;
-
         if (eof() || !skipWhitespace())
             return false;
 
@@ -414,15 +673,18 @@ public:
                 return false;
         }
 
+        ResourceBudget::poll();
+
+        // decode directly into out to reuse its capacity
+        out.clear();
         int plit;
         while (readInteger(&plit))
         {
             if (plit == 0)
                 break;
-            clause.push_back(Lit(abs(plit), plit < 0));
+            out.push_back(Lit(abs(plit), plit < 0));
         }
 
-        out = clause;
         return true;
     }
 };
@@ -23,9 +23,14 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include <archive.h>
 #include <archive_entry.h>
 
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
 
+#include "BufferedWriter.h"
+
 class StreamCompressorException : public std::runtime_error
 {
 public:
@@ -34,103 +39,154 @@ public:
     explicit StreamCompressorException(const std::string &msg, archive *arch) : std::runtime_error(msg + ": " + std::string(archive_error_string(arch))) {}
 };
 
+/**
+ * @brief Streaming writer of a compressed file, accepts any amount of data
+ * - the filter is zstd if the output ends with .zst, xz otherwise
+ * - writes are batched into large blocks before they are passed to libarchive
+ */
 class StreamCompressor
 {
-    unsigned size_;
-    unsigned cursor;
-
     struct archive *arch;
     struct archive_entry *entry;
 
+    std::unique_ptr<BufferedWriter> writer;
+
     int status;
     bool closed;
 
+    void set_filter_option(const char *module, const char *option, int value)
+    {
+        status = archive_write_set_filter_option(arch, module, option, std::to_string(value).c_str());
+        if (status != ARCHIVE_OK)
+            throw StreamCompressorException(std::string("Error setting ") + module + " option " + option, arch);
+    }
+
 public:
-    StreamCompressor(const char *output, unsigned size = 0) : size_(size), cursor(0), status(0)
+    static inline unsigned default_threads = 1; // compression threads, 0 for number of cores
+    static inline int default_level = -1;       // compression level, -1 for the filter's default
+    static inline size_t default_block_size = 1 << 20;
+
+    /**
+     * @return true if the given output file is compressed by StreamCompressor, i.e., ends with .xz or .zst
+     */
+    static bool is_compressed(const char *output)
     {
+        const auto extension = std::filesystem::path(output).extension();
+        return extension == ".xz" || extension == ".zst";
+    }
+
+    /**
+     * @param output output file
+     * @param size size of the uncompressed data if known in advance, 0 otherwise
+     * @param threads compression threads, 0 for number of cores
+     * @param level compression level, -1 for the filter's default
+     */
+    StreamCompressor(const char *output, size_t size = 0, unsigned threads = default_threads, int level = default_level) : status(0), closed(false)
+    {
+        std::filesystem::path p(output);
+        const bool zstd = p.extension() == ".zst";
+        const char *module = zstd ? "zstd" : "xz";
+
         arch = archive_write_new();
         status = archive_write_set_format_raw(arch);
         if (status != ARCHIVE_OK)
             throw StreamCompressorException("Error setting format", arch);
-        status = archive_write_add_filter_xz(arch);
+        status = zstd ? archive_write_add_filter_zstd(arch) : archive_write_add_filter_xz(arch);
         if (status != ARCHIVE_OK)
-            throw StreamCompressorException("Error adding XZ filter", arch);
+            throw StreamCompressorException(std::string("Error adding ") + module + " filter", arch);
+        if (threads != 1)
+            set_filter_option(module, "threads", threads);
+        if (level >= 0)
+            set_filter_option(module, "compression-level", level);
         status = archive_write_open_filename(arch, output);
         if (status != ARCHIVE_OK)
             throw StreamCompressorException("Error open archive", arch);
 
         entry = archive_entry_new();
 
-        std::filesystem::path p(output);
         auto entry_path = p.filename();
-        if (entry_path.extension() == ".xz")
+        if (entry_path.extension() == ".xz" || entry_path.extension() == ".zst")
         {
             entry_path.replace_extension();
         }
 
         archive_entry_set_pathname(entry, entry_path.c_str());
         if (size != 0)
-            resize_entry(size);
+            archive_entry_set_size(entry, size);
         archive_entry_set_filetype(entry, AE_IFREG);
         archive_entry_set_perm(entry, 0644);
 
         status = archive_write_header(arch, entry);
         if (status != ARCHIVE_OK)
             throw StreamCompressorException("Error writing header", arch);
+
+        writer = std::make_unique<BufferedWriter>([this](const char *buf, size_t len) {
+            ssize_t bytes_written = archive_write_data(arch, buf, len);
+            if (bytes_written < 0 || static_cast<size_t>(bytes_written) != len)
+            {
+                throw StreamCompressorException("Error writing to archive", arch);
+            }
+        }, default_block_size);
     }
 
+    StreamCompressor(const StreamCompressor &) = delete;
+    StreamCompressor &operator=(const StreamCompressor &) = delete;
+
     ~StreamCompressor()
     {
         if (!closed)
-            close();
-    }
-
-    void write(const char *buf, unsigned len)
-    {
-        cursor += len;
-        if (cursor > size_)
         {
-            throw StreamCompressorException("Attempt to write more than announced");
+            try
+            {
+                close();
+            }
+            catch (const StreamCompressorException &e)
+            {
+                std::cerr << e.what() << std::endl;
+            }
         }
+    }
 
-        int bytes_written = archive_write_data(arch, buf, len);
-        if (bytes_written != len)
-        {
-            throw StreamCompressorException("Error writing to archive", arch);
-        }
+    void write(const char *buf, size_t len)
+    {
+        writer->write(buf, len);
     }
 
-    void resize_entry(size_t size)
+    /**
+     * @brief buffered writer to format output directly into the compressor
+     */
+    BufferedWriter &buffer()
     {
-        size_ = size;
-        archive_entry_set_size(entry, size);
+        return *writer;
     }
 
     friend std::istream &operator>>(std::istream &input, StreamCompressor &cmpr)
     {
-        input.seekg(0, input.end);
-        unsigned length = input.tellg();
-        input.seekg(0, input.beg);
-
-        char *buffer = new char[length];
-        input.read(buffer, length);
-        if (input.fail() && !input.eof())
+        std::unique_ptr<char[]> chunk(new char[default_block_size]);
+        while (input.read(chunk.get(), default_block_size) || input.gcount() > 0)
         {
-            throw StreamCompressorException("Error reading from input stream");
+            cmpr.write(chunk.get(), input.gcount());
         }
-        if (archive_entry_size(cmpr.entry) < length)
+        if (input.bad())
         {
-            cmpr.resize_entry(length);
+            throw StreamCompressorException("Error reading from input stream");
         }
-
-        cmpr.write(buffer, length);
-
-        delete[] buffer;
         return input;
     }
 
     void close()
     {
+        closed = true;
+        try
+        {
+            writer->flush();
+        }
+        catch (const StreamCompressorException &)
+        {
+            archive_entry_free(entry);
+            archive_write_free(arch);
+            throw;
+        }
         archive_entry_free(entry);
         status = archive_write_close(arch);
         if (status != ARCHIVE_OK)
@@ -142,7 +198,6 @@ public:
         {
             throw StreamCompressorException("Error freeing archive", arch);
         }
-        closed = true;
     }
 };
 
@@ -1,35 +1,142 @@
 #include "UnionFind.h"
 #include <algorithm>
+#include <numeric>
+#include <stdexcept>
 #include <vector>
 
 
-UnionFind::UnionFind() : ccs() {}
+UnionFind::UnionFind(unsigned n_vars) : parent(), size()
+{
+    reserve(n_vars);
+}
+
+void UnionFind::reserve(unsigned n_vars)
+{
+    parent.reserve(n_vars + 1);
+    size.reserve(n_vars + 1);
+}
+
+void UnionFind::grow(unsigned var)
+{
+    const unsigned old_size = parent.size();
+    if (var < old_size) return;
+    parent.resize(var + 1);
+    std::iota(parent.begin() + old_size, parent.end(), old_size);
+    size.resize(var + 1, 1);
+    n_components += var + 1 - std::max(old_size, 1u);
+}
+
+unsigned UnionFind::root(unsigned var)
+{
+    while (parent[var] != var) {
+        parent[var] = parent[parent[var]];
+        var = parent[var];
+    }
+    return var;
+}
+
+unsigned UnionFind::link(unsigned a, unsigned b)
+{
+    if (a == b) return a;
+    if (size[a] < size[b]) std::swap(a, b);
+    parent[b] = a;
+    size[a] += size[b];
+    --n_components;
+    return a;
+}
 
 void UnionFind::insert(const Cl &cl)
 {
-    Var min_var = Var(cl.front().var()), par;
+    if (cl.empty()) return;
+    unsigned max_var = 0;
+    for (const Lit &lit : cl) max_var = std::max(max_var, static_cast<unsigned>(lit.var()));
+    grow(max_var);
+    unsigned rep = root(cl.front().var());
     for (const Lit &lit : cl) {
-        par = find(lit.var());
-        if (min_var > par){
-            ccs[min_var] = par;
-            min_var = par;
-        } else {
-            ccs[par] = min_var;
-        }
+        rep = link(rep, root(lit.var()));
     }
 }
 
+bool UnionFind::unite(Var a, Var b)
+{
+    grow(std::max(a.id, b.id));
+    const unsigned ra = root(a.id), rb = root(b.id);
+    if (ra == rb) return false;
+    link(ra, rb);
+    return true;
+}
+
 Var UnionFind::find(Var var)
 {
-    return var == ccs[var] ? var : (ccs[var] = find(ccs[var]));
+    grow(var.id);
+    return Var(root(var.id));
+}
+
+unsigned UnionFind::count_components() const
+{
+    return n_components;
 }
 
-unsigned UnionFind::count_components()
+void UnionFind::save(StateFile::Writer &out) const
 {
-    unsigned num_components = 0;
-    for (unsigned i = 1; i < ccs.size(); ++i)
-    {
-        num_components += i == static_cast<unsigned>(find(ccs[i]));
+    out.put(parent);
+    out.put(size);
+    out.put(n_components);
+}
+
+void UnionFind::load(StateFile::Reader &in)
+{
+    in.get(parent);
+    in.get(size);
+    in.get(n_components);
+    if (size.size() != parent.size()) throw std::runtime_error("Corrupt union-find state");
+    for (unsigned v = 0; v < parent.size(); ++v) {
+        if (parent[v] >= parent.size()) throw std::runtime_error("Corrupt union-find state");
+    }
+}
+
+
+ConcurrentUnionFind::ConcurrentUnionFind(unsigned n_vars_) : parent(new std::atomic<unsigned>[n_vars_ + 1]), n_vars(n_vars_)
+{
+    for (unsigned v = 0; v <= n_vars; ++v) parent[v].store(v, std::memory_order_relaxed);
+}
+
+unsigned ConcurrentUnionFind::find(unsigned var)
+{
+    for (;;) {
+        unsigned p = parent[var].load(std::memory_order_acquire);
+        if (p == var) return var;
+        const unsigned gp = parent[p].load(std::memory_order_acquire);
+        // another thread may have shortened or linked meanwhile, a failed shortcut is harmless
+        if (p != gp) parent[var].compare_exchange_weak(p, gp, std::memory_order_acq_rel);
+        var = gp;
     }
-    return num_components;
-}
\ No newline at end of file
+}
+
+bool ConcurrentUnionFind::unite(unsigned a, unsigned b)
+{
+    for (;;) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return false;
+        if (a < b) std::swap(a, b);
+        unsigned expected = a;
+        // a root only ever points to a smaller index, hence no cycles
+        if (parent[a].compare_exchange_strong(expected, b, std::memory_order_acq_rel)) {
+            n_unions.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+}
+
+void ConcurrentUnionFind::insert(const Cl &cl)
+{
+    for (const Lit &lit : cl) {
+        unite(cl.front().var(), lit.var());
+    }
+}
+
+unsigned ConcurrentUnionFind::count_components() const
+{
+    return n_vars - n_unions.load(std::memory_order_relaxed);
+}
@@ -1,42 +1,66 @@
 #ifndef UNIONFIND_H
 #define UNIONFIND_H
 
+#include <atomic>
+#include <memory>
 #include <vector>
-#include <algorithm>
 
 #include "src/util/SolverTypes.h"
+#include "src/util/StateFile.h"
 
+/**
+ * Connected components of the variables of the inserted clauses,
+ * variables up to the largest one seen so far which do not occur in a clause count as singleton components.
+ * Union by size and path halving, the number of components is maintained during insertion.
+ */
 class UnionFind
 {
 private:
-    struct vwrapper
-    {
-        std::vector<Var> v;
-        Var &operator[](size_t idx)
-        {
-            if (idx >= v.size())
-            {
-                auto old_end = v.size();
-                v.resize(idx + 1);
-                std::generate(v.begin() + old_end, v.end(), [&]
-                              { return Var(old_end++); });
-            }
-            return v[idx];
-        }
-
-        size_t size()
-        {
-            return v.size();
-        }
-    };
-
-    vwrapper ccs;
+    std::vector<unsigned> parent;  // parent[v] == v for roots, index 0 is unused
+    std::vector<unsigned> size;    // number of variables in the component of a root
+    unsigned n_components = 0;
+
+    void grow(unsigned var);
+    unsigned root(unsigned var);
+    unsigned link(unsigned a, unsigned b);
 
 public:
-    UnionFind();
+    /**
+     * @param n_vars expected number of variables, only a hint to avoid reallocations
+     */
+    explicit UnionFind(unsigned n_vars = 0);
+    void reserve(unsigned n_vars);
     void insert(const Cl &cl);
+    bool unite(Var a, Var b);
     Var find(Var var);
-    unsigned count_components();
+    unsigned count_components() const;
+
+    void save(StateFile::Writer &out) const;
+    void load(StateFile::Reader &in);
+};
+
+/**
+ * Union-find over a fixed range of variables 1..n_vars which can be shared by threads,
+ * e.g., by the workers of a chunked parser. Roots are linked by compare-and-swap, the larger index
+ * below the smaller one, and finds use path halving, which only ever shortcuts to an ancestor.
+ */
+class ConcurrentUnionFind
+{
+private:
+    std::unique_ptr<std::atomic<unsigned>[]> parent;
+    const unsigned n_vars;
+    std::atomic<unsigned> n_unions { 0 };
+
+public:
+    explicit ConcurrentUnionFind(unsigned n_vars);
+
+    /**
+     * @brief union of the variables of the clause, all variables must be at most n_vars
+     */
+    void insert(const Cl &cl);
+    bool unite(unsigned a, unsigned b);
+    unsigned find(unsigned var);
+    unsigned count_components() const;
 };
 
-#endif // UNIONFIND_H
\ No newline at end of file
+#endif // UNIONFIND_H
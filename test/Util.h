@@ -8,10 +8,40 @@
 #include <cstdlib>
 #include <algorithm>
 #include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 
+// create a new empty file in the temp directory and open it for reading and writing, the caller removes the file
+// @param ext suffix of the name, e.g. ".cnf.xz" for output files which are compressed by their extension
+static std::string tempfile(FILE** file, const std::string& ext = "")
+{
+    std::string name = (std::filesystem::temp_directory_path() / "gbdc.test.XXXXXX").string() + ext;
+    const int fd = mkstemps(name.data(), ext.size());
+    *file = fd < 0 ? nullptr : fdopen(fd, "w+");
+    return name;
+}
+
+// name of a new empty file in the temp directory, e.g. for output files, the caller removes the file
+static std::string tempfile(const std::string& ext = "")
+{
+    FILE* file = nullptr;
+    const std::string name = tempfile(&file, ext);
+    if (file != nullptr) fclose(file);
+    return name;
+}
+
+// create a new empty directory in the temp directory, the caller removes it
+static std::filesystem::path tempdir()
+{
+    std::string name = (std::filesystem::temp_directory_path() / "gbdc.test.XXXXXX").string();
+    if (mkdtemp(name.data()) == nullptr) throw std::runtime_error("Could not create temporary directory");
+    return name;
+}
+
 static std::string tmp_filename(std::string dir, std::string ext, unsigned length = 32U)
 {
     const char hex_chars[] = "0123456789abcdef";
@@ -0,0 +1,251 @@
+/**
+ * Benchmarks of the hot paths of gbdc: tokenizer, hash functions, feature extraction and gate analysis
+ *
+ * Usage: gbdc_bench [--quick] [--repeat N] [--filter SUBSTRING] [--files DIRECTORY] [--output FILE]
+ * Results are written as JSON (to stdout by default), the time of each benchmark is the best of N runs.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "src/external/md5/md5.h"
+#include "src/identify/GBDHash.h"
+#include "src/identify/ISOHash.h"
+#include "src/identify/ISOHash2.h"
+#include "src/extract/CNFBaseFeatures.h"
+#include "src/extract/CNFApproxFeatures.h"
+#include "src/extract/gates/GateAnalyzer.h"
+#include "src/util/CaptureDistribution.h"
+#include "src/util/CNFFormula.h"
+#include "src/util/MultiMD5.h"
+#include "src/util/StreamBuffer.h"
+
+struct BenchResult {
+    std::string name;
+    std::string input;
+    double seconds;
+    uint64_t bytes;  // processed input bytes, 0 if throughput is not meaningful
+    unsigned repeat;
+};
+
+class Bench {
+    unsigned repeat_;
+    std::string filter_;
+    std::vector<BenchResult> results;
+
+ public:
+    size_t sink = 0;  // consumes results such that benchmarked code is not optimized away
+
+    Bench(unsigned repeat, std::string filter) : repeat_(repeat), filter_(filter) { }
+
+    /**
+     * @brief runs f repeatedly and records the best time, unless name does not match the filter
+     */
+    template <typename Function>
+    void run(const std::string& name, const std::string& input, uint64_t bytes, Function f) {
+        if (name.find(filter_) == std::string::npos) return;
+        double best = 0;
+        for (unsigned i = 0; i < repeat_; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            f();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (i == 0 || elapsed.count() < best) best = elapsed.count();
+        }
+        results.push_back({ name, input, best, bytes, repeat_ });
+        std::cerr << name << " " << input << ": " << best << " s" << std::endl;
+    }
+
+    void write_json(std::ostream& out) const {
+        out << "{\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& r = results[i];
+            out << (i > 0 ? ",\n" : "\n") << "    { \"name\": \"" << r.name << "\", \"input\": \"" << r.input
+                << "\", \"seconds\": " << r.seconds << ", \"repeat\": " << r.repeat << ", \"bytes\": " << r.bytes;
+            if (r.bytes > 0 && r.seconds > 0) out << ", \"mb_per_s\": " << r.bytes / r.seconds / 1e6;
+            out << " }";
+        }
+        out << "\n  ]\n}\n";
+    }
+};
+
+/**
+ * @brief random DIMACS file with clauses of 3 to 8 literals
+ * @return size of the file in bytes
+ */
+uint64_t generate_cnf(const std::string& filename, unsigned n_clauses, unsigned n_vars) {
+    std::mt19937 rng(42);
+    std::ofstream out(filename);
+    out << "c generated by gbdc_bench\np cnf " << n_vars << " " << n_clauses << "\n";
+    for (unsigned i = 0; i < n_clauses; ++i) {
+        const unsigned size = 3 + rng() % 6;
+        for (unsigned j = 0; j < size; ++j) {
+            out << (rng() % 2 ? "-" : "") << 1 + rng() % n_vars << " ";
+        }
+        out << "0\n";
+    }
+    out.close();
+    return std::filesystem::file_size(filename);
+}
+
+void micro_benchmarks(Bench& bench, bool quick) {
+    const std::string cnf = (std::filesystem::temp_directory_path() / "gbdc_bench.cnf").string();
+    const uint64_t cnf_bytes = generate_cnf(cnf, quick ? 20000 : 1000000, quick ? 5000 : 100000);
+    bench.run("tokenizer/readClause", "generated", cnf_bytes, [&] () {
+        StreamBuffer in(cnf.c_str());
+        Cl clause;
+        while (in.readClause(clause)) bench.sink += clause.size();
+    });
+    bench.run("hash/gbdhash", "generated", cnf_bytes, [&] () { bench.sink += CNF::gbdhash(cnf.c_str()).size(); });
+    const std::vector<std::string> copies(MultiMD5::Engine::lanes, cnf);
+    bench.run("hash/gbdhash_many", "generated", copies.size() * cnf_bytes, [&] () { bench.sink += CNF::gbdhash_many(copies).size(); });
+    bench.run("hash/gbdhash2", "generated", cnf_bytes, [&] () { bench.sink += CNF::gbdhash2(cnf.c_str()).size(); });
+    bench.run("hash/isohash", "generated", cnf_bytes, [&] () { bench.sink += CNF::isohash(cnf.c_str()).size(); });
+    std::remove(cnf.c_str());
+
+    std::vector<char> data(quick ? 1 << 23 : 1 << 27);
+    std::mt19937 rng(42);
+    for (char& c : data) c = static_cast<char>(rng());
+    bench.run("digest/md5", "random", data.size(), [&] () {
+        MD5 md5;
+        for (size_t pos = 0; pos < data.size(); pos += 1 << 16) {
+            md5.consume(data.data() + pos, std::min<size_t>(1 << 16, data.size() - pos));
+        }
+        bench.sink += md5.produce().size();
+    });
+    bench.run("digest/md5_multi", "random", data.size(), [&] () {
+        MultiMD5::Engine md5;
+        const size_t lane_size = data.size() / MultiMD5::Engine::lanes;
+        const char* chunk[MultiMD5::Engine::lanes];
+        size_t size[MultiMD5::Engine::lanes];
+        for (size_t pos = 0; pos < lane_size; pos += 1 << 13) {
+            for (unsigned lane = 0; lane < MultiMD5::Engine::lanes; ++lane) {
+                chunk[lane] = data.data() + lane * lane_size + pos;
+                size[lane] = std::min<size_t>(1 << 13, lane_size - pos);
+            }
+            md5.update(chunk, size);
+        }
+        for (unsigned lane = 0; lane < MultiMD5::Engine::lanes; ++lane) bench.sink += md5.finish(lane).size();
+    });
+    bench.run("digest/xxh3_128", "random", data.size(), [&] () {
+        bench.sink += XXH3_128bits(data.data(), data.size()).low64;
+    });
+
+    const size_t n = quick ? 100000 : 5000000;
+    std::vector<unsigned> degrees(n);
+    std::vector<double> ratios(n);
+    for (size_t i = 0; i < n; ++i) {
+        degrees[i] = rng() % 200;
+        ratios[i] = static_cast<double>(rng() % 7) / (rng() % 7 + 1);
+    }
+    bench.run("distribution/unsigned", "random", 0, [&] () {
+        std::vector<unsigned> copy(degrees);
+        std::vector<double> record;
+        push_distribution(record, copy);
+        bench.sink += record.size();
+    });
+    bench.run("distribution/double", "random", 0, [&] () {
+        std::vector<double> copy(ratios);
+        std::vector<double> record;
+        push_distribution(record, copy);
+        bench.sink += record.size();
+    });
+    bench.run("distribution/histogram_unsigned", "random", 0, [&] () {
+        Histogram<unsigned> histogram;
+        for (unsigned degree : degrees) histogram.add(degree);
+        std::vector<double> record;
+        push_histogram(record, histogram);
+        bench.sink += record.size();
+    });
+    bench.run("distribution/histogram_double", "random", 0, [&] () {
+        Histogram<double> histogram;
+        for (double ratio : ratios) histogram.add(ratio);
+        std::vector<double> record;
+        push_histogram(record, histogram);
+        bench.sink += record.size();
+    });
+}
+
+void macro_benchmarks(Bench& bench, const std::vector<std::string>& files) {
+    for (const std::string& file : files) {
+        const std::string input = std::filesystem::path(file).filename().string();
+        const uint64_t bytes = std::filesystem::file_size(file);
+        const char* filename = file.c_str();
+        bench.run("file/gbdhash", input, bytes, [&] () { bench.sink += CNF::gbdhash(filename).size(); });
+        bench.run("file/isohash", input, bytes, [&] () { bench.sink += CNF::isohash(filename).size(); });
+        bench.run("file/wlhash", input, bytes, [&] () {
+            bench.sink += CNF::weisfeiler_leman_hash(filename, 1, true, true, false, 13, true, true, true, 6, false, false, false).size();
+        });
+        bench.run("file/base_features", input, bytes, [&] () {
+            CNF::BaseFeatures stats(filename);
+            stats.extract();
+            bench.sink += stats.getFeatures().size();
+        });
+        bench.run("file/approx_features", input, bytes, [&] () {
+            CNF::ApproxFeatures stats(filename, 0.01);
+            stats.extract();
+            bench.sink += stats.getFeatures().size();
+        });
+        bench.run("file/gate_patterns", input, bytes, [&] () {
+            CNFFormula formula(filename);
+            GateAnalyzer analyzer(formula, true, false, formula.nVars() / 3, false);
+            analyzer.analyze();
+            bench.sink += analyzer.getGateFormula().nGates();
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    bool quick = false;
+    unsigned repeat = 3;
+    std::string filter, output;
+    std::string files = "test/resources/test_files";
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--quick") {
+            quick = true;
+            repeat = 1;
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(std::stoi(argv[++i]), 1);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--files" && i + 1 < argc) {
+            files = argv[++i];
+        } else if (arg == "--output" && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            std::cerr << "Usage: gbdc_bench [--quick] [--repeat N] [--filter SUBSTRING] [--files DIRECTORY] [--output FILE]" << std::endl;
+            return 1;
+        }
+    }
+
+    // quick mode is a smoke test on the smallest test file
+    std::vector<std::string> inputs;
+    if (quick) {
+        inputs.push_back(files + "/cnf_test.cnf.xz");
+    } else {
+        for (const auto& entry : std::filesystem::directory_iterator(files)) {
+            const std::string name = entry.path().filename().string();
+            if (name.find(".cnf") != std::string::npos) inputs.push_back(entry.path().string());
+        }
+        std::sort(inputs.begin(), inputs.end());
+    }
+
+    Bench bench(repeat, filter);
+    micro_benchmarks(bench, quick);
+    macro_benchmarks(bench, inputs);
+
+    if (output.empty()) {
+        bench.write_json(std::cout);
+    } else {
+        std::ofstream out(output);
+        bench.write_json(out);
+    }
+    return bench.sink == 0;  // sink is never zero, keeps results alive
+}
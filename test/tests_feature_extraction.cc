@@ -3,13 +3,22 @@
 #include <cstdio>
 #include <unordered_map>
 #include <filesystem>
+#include <fstream>
 #include <string>
+#include <random>
+#include <thread>
 
 #include "src/util/CaptureDistribution.h"
 #include "src/extract/CNFBaseFeatures.h"
+#include "src/extract/CNFApproxFeatures.h"
 #include "src/extract/OPBBaseFeatures.h"
 #include "src/extract/WCNFBaseFeatures.h"
 #include "src/extract/CNFGateFeatures.h"
+#include "src/util/UnionFind.h"
+#include "src/util/ResourceBudget.h"
+#include "src/identify/GBDHash.h"
+#include "src/identify/Incremental.h"
+#include "src/transform/Pack.h"
 
 #include "test/Util.h"
 
@@ -43,6 +52,239 @@ TEST_CASE("Feature extraction")
         extract<CNF::BaseFeatures>(test_file.c_str(), expected_record_file.c_str());
     }
 
+    SUBCASE("CNF base: clause degrees from second parse")
+    {
+        const auto test_file = test_dir + "cnf_test.cnf.xz";
+        CNF::BaseFeatures2 stored(test_file.c_str());
+        CNF::BaseFeatures2 reread(test_file.c_str(), false);
+        stored.extract();
+        reread.extract();
+        CHECK(stored.getFeatures() == reread.getFeatures());
+    }
+
+    SUBCASE("CNF base: clause degrees under a tight memory budget")
+    {
+        // the clause store does not fit into the budget, clauses are spilled to a temporary file
+        const auto test_file = test_dir + "1d1af993697599892804df5878d58979-brent_69_0.cnf.xz";
+        CNF::BaseFeatures2 unlimited(test_file.c_str());
+        unlimited.extract();
+        ResourceBudget budget(0, 12);
+        ResourceBudget::Scope scope(budget);
+        CNF::BaseFeatures2 limited(test_file.c_str());
+        CHECK_NOTHROW(limited.extract());
+        CHECK(limited.getFeatures() == unlimited.getFeatures());
+    }
+
+    SUBCASE("CNF base: pipeline of selected feature groups")
+    {
+        const auto test_file = test_dir + "cnf_test.cnf.xz";
+        const auto expected_record_file = records_dir + "cnf_base.txt";
+        auto expected_record = record_to_map<double>(expected_record_file.c_str());
+        CNF::Pipeline<CNF::Group::ClauseSizes, CNF::Group::Counts> stats(test_file.c_str());
+        stats.extract();
+        auto record = stats.getFeatures();
+        auto names = stats.getNames();
+        REQUIRE(record.size() == 13);
+        CHECK(names.front() == "cls1");
+        for (unsigned i = 0; i < record.size(); i++)
+        {
+            CHECK_MESSAGE(fequal(expected_record[names[i]], record[i]), ("\nUnexpected record for feature '" + names[i] + "'"));
+        }
+    }
+
+    SUBCASE("CNF base: histograms summarize like the vector of all values")
+    {
+        std::mt19937 rng(3);
+        std::vector<unsigned> sizes;
+        std::vector<double> balances;
+        Histogram<unsigned> size_histogram;
+        Histogram<double> balance_histogram;
+        for (unsigned i = 0; i < 20000; ++i) {
+            // dense and sparse integers, balance ratios with equal 3-digit snaps and a zero run
+            const unsigned size = i % 7 ? rng() % 40 : (1u << 20) + rng() % 3;
+            const unsigned pos = rng() % 4, neg = 1 + rng() % 3001;
+            const double balance = i % 5 ? (double)std::min(pos, neg) / (double)std::max(pos, neg) : 0;
+            sizes.push_back(size);
+            size_histogram.add(size);
+            balances.push_back(balance);
+            balance_histogram.add(balance);
+        }
+        std::vector<double> expected, actual;
+        push_distribution(expected, sizes);
+        push_distribution(expected, balances);
+        push_histogram(actual, size_histogram);
+        push_histogram(actual, balance_histogram);
+        CHECK(actual == expected);
+        // accumulators are stored as occurrence counts
+        const std::string state = tempfile();
+        {
+            StateFile::Writer out(state, "histogram", 1);
+            balance_histogram.save(out);
+            out.commit();
+        }
+        Histogram<double> loaded;
+        StateFile::Reader in(state, "histogram", 1);
+        loaded.load(in);
+        CHECK(loaded.runs() == balance_histogram.runs());
+        std::remove(state.c_str());
+        Histogram<unsigned> empty;
+        actual.clear();
+        push_histogram(actual, empty);
+        CHECK(actual == std::vector<double>(5, 0));
+    }
+
+    SUBCASE("CNF base: sequential and concurrent union-find")
+    {
+        // a chain over variables 1..n, variable n + 1 only occurs in a unit clause, n + 2 does not occur
+        const unsigned n = 100000;
+        std::vector<Cl> clauses;
+        for (unsigned v = 1; v < n; ++v) clauses.push_back(Cl({ Lit(v + 1, false), Lit(v, true) }));
+        clauses.push_back(Cl({ Lit(n + 1, false) }));
+        clauses.push_back(Cl({ Lit(n + 3, false), Lit(n + 3, true) }));
+        UnionFind uf;
+        ConcurrentUnionFind cuf(n + 3);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < 4; ++t) {
+            workers.emplace_back([&clauses, &cuf, t] () {
+                for (size_t i = t; i < clauses.size(); i += 4) cuf.insert(clauses[i]);
+            });
+        }
+        for (const Cl& clause : clauses) uf.insert(clause);
+        uf.insert(Cl());
+        for (std::thread& worker : workers) worker.join();
+        CHECK(uf.count_components() == 4);
+        CHECK(cuf.count_components() == 4);
+        CHECK(uf.find(Var(1)) == uf.find(Var(n)));
+        CHECK(cuf.find(1) == cuf.find(n));
+        CHECK(uf.find(Var(n + 1)) != uf.find(Var(n)));
+        CHECK(uf.unite(Var(n + 1), Var(n + 2)));
+        CHECK(!uf.unite(Var(n + 2), Var(n + 1)));
+        CHECK(uf.count_components() == 3);
+    }
+
+    SUBCASE("CNF base: incremental update of appended clauses")
+    {
+        std::vector<Cl> clauses;
+        StreamBuffer in((test_dir + "cnf_test.cnf.xz").c_str());
+        Cl clause;
+        while (in.readClause(clause)) clauses.push_back(clause);
+        const std::string file = tempfile();
+        const std::string state = file + ".gbdstate";
+        auto append = [&clauses, &file] (size_t begin, size_t end, const char* mode, bool terminate_last) {
+            std::FILE* out = std::fopen(file.c_str(), mode);
+            for (size_t i = begin; i < end; ++i) {
+                for (Lit lit : clauses[i]) std::fprintf(out, "%s%u ", lit.sign() ? "-" : "", static_cast<unsigned>(lit.var()));
+                std::fputs(i + 1 < end || terminate_last ? "0\n" : "", out);
+            }
+            std::fclose(out);
+        };
+        auto check = [&file] (const CNF::IncrementalResult& result) {
+            CNF::BaseFeatures1 reference(file.c_str());
+            reference.extract();
+            CHECK(result.gbdhash == CNF::gbdhash(file.c_str()));
+            CHECK(result.names == reference.getNames());
+            CHECK(result.features == reference.getFeatures());
+        };
+        std::remove(state.c_str());
+        append(0, clauses.size() / 2, "w", false);
+        const CNF::IncrementalResult first = CNF::incremental(file.c_str(), state);
+        CHECK(!first.resumed);
+        check(first);
+        // the unterminated last clause is continued by the appended text
+        append(clauses.size() / 2, clauses.size() / 2 + 1, "a", true);
+        append(clauses.size() / 2 + 1, clauses.size(), "a", false);
+        const CNF::IncrementalResult second = CNF::incremental(file.c_str(), state);
+        CHECK(second.resumed);
+        CHECK(second.bytes_parsed < std::filesystem::file_size(file));
+        check(second);
+        // other modifications are detected
+        append(1, clauses.size(), "w", true);
+        const CNF::IncrementalResult third = CNF::incremental(file.c_str(), state);
+        CHECK(!third.resumed);
+        check(third);
+        // edits in the middle of the parsed part are detected
+        {
+            std::fstream edit(file, std::ios::in | std::ios::out | std::ios::binary);
+            edit.seekg(std::filesystem::file_size(file) / 2);
+            char c = 0;
+            while (edit.get(c) && (c < '1' || c > '8')) { }
+            edit.seekp(-1, std::ios::cur);
+            edit.put(c + 1);
+        }
+        const CNF::IncrementalResult fourth = CNF::incremental(file.c_str(), state);
+        CHECK(!fourth.resumed);
+        check(fourth);
+        // hashed text keeps the tokens of the file, also of lines which are continued
+        {
+            std::ofstream out(file);
+            out << "c comment\np cnf 9 4\n+3 -007 0\n1\n  -2 0 4 +5\n";
+        }
+        std::remove(state.c_str());
+        check(CNF::incremental(file.c_str(), state));
+        {
+            std::ofstream out(file, std::ios::app);
+            out << "06 0\n+9 -01 0\n-08";
+        }
+        const CNF::IncrementalResult tokens = CNF::incremental(file.c_str(), state);
+        CHECK(tokens.resumed);
+        check(tokens);
+        std::remove(file.c_str());
+        std::remove(state.c_str());
+    }
+
+    SUBCASE("CNF base: approximate features from sampled blocks")
+    {
+        const std::string compressed = test_dir + "cnf_test.cnf.xz";
+        CNF::BaseFeatures1 exact(compressed.c_str());
+        exact.extract();
+        std::unordered_map<std::string, double> expected;
+        for (unsigned i = 0; i < exact.getNames().size(); ++i) expected[exact.getNames()[i]] = exact.getFeatures()[i];
+        const std::vector<std::string> counts = { "clauses", "cls1", "cls2", "cls3", "cls10p", "horn", "invhorn", "positive", "negative" };
+        auto approximate = [] (const std::string& file, double fraction, size_t block_size) {
+            CNF::ApproxFeatures approx(file.c_str(), fraction, 7, block_size);
+            approx.extract();
+            std::unordered_map<std::string, double> result;
+            for (unsigned i = 0; i < approx.getNames().size(); ++i) result[approx.getNames()[i]] = approx.getFeatures()[i];
+            return result;
+        };
+        const std::string plain = tempfile();
+        const std::string packed = plain + ".pack";
+        {
+            std::FILE* out = std::fopen(plain.c_str(), "w");
+            StreamBuffer in(compressed.c_str());
+            Cl clause;
+            std::fputs("c comment\np cnf 270 6663\n", out);
+            while (in.readClause(clause)) {
+                for (Lit lit : clause) std::fprintf(out, "%s%u ", lit.sign() ? "-" : "", static_cast<unsigned>(lit.var()));
+                std::fputs("0\n", out);
+            }
+            std::fclose(out);
+            pack(plain.c_str(), packed.c_str(), true, 64);
+        }
+        // complete samples of every kind of input are exact, block boundaries split no clause
+        for (const std::string& file : { compressed, plain, packed }) {
+            auto result = approximate(file, 1, 1000);
+            CHECK(result["sampled_fraction"] == 1);
+            CHECK(result["variables"] == expected["variables"]);
+            for (const std::string& name : counts) {
+                CHECK_MESSAGE(result[name] == expected[name], (file + ": " + name));
+                CHECK(result[name + "_se"] == 0);
+            }
+            CHECK(result["balancecls_mean"] == doctest::Approx(expected["balancecls_mean"]));
+        }
+        // estimates of partial samples are within a few standard errors
+        for (const std::string& file : { compressed, plain, packed }) {
+            auto result = approximate(file, 0.25, 1000);
+            CHECK(result["sampled_fraction"] == doctest::Approx(0.25).epsilon(0.05));
+            CHECK(result["sampled_clauses"] < expected["clauses"] / 2);
+            for (const std::string& name : counts) {
+                CHECK_MESSAGE(std::fabs(result[name] - expected[name]) <= 4 * result[name + "_se"] + 1e-9 * expected["clauses"], (file + ": " + name));
+            }
+        }
+        std::remove(plain.c_str());
+        std::remove(packed.c_str());
+    }
+
     SUBCASE("CNF gates")
     {
         const auto test_file = test_dir + "cnf_test.cnf.xz";
@@ -50,6 +292,41 @@ TEST_CASE("Feature extraction")
         extract<CNF::GateFeatures>(test_file.c_str(), expected_record_file.c_str());
     }
 
+    SUBCASE("CNF gates: parallel analysis of components equals serial analysis")
+    {
+        auto features = [] (const std::string& file, unsigned threads) {
+            CNF::GateFeatures stats(file.c_str(), threads);
+            stats.extract();
+            return stats.getFeatures();
+        };
+        // gates under units in several components, a component without units, and disjoint clauses
+        // which need more root selections than the budget of nVars/3 (serial fallback)
+        const std::string gates_file = tempfile();
+        const std::string budget_file = tempfile();
+        {
+            std::ofstream gates(gates_file);
+            std::ofstream budget(budget_file);
+            for (int i = 0; i < 8; ++i) {
+                const int o = 20 * i;
+                gates << o + 1 << " 0\n" << -(o + 1) << " " << o + 2 << " 0\n" << -(o + 1) << " " << o + 3 << " 0\n" << o + 1 << " " << -(o + 2) << " " << -(o + 3) << " 0\n";
+                gates << o + 2 << " " << -(o + 4) << " 0\n" << o + 2 << " " << -(o + 5) << " 0\n" << -(o + 2) << " " << o + 4 << " " << o + 5 << " 0\n";
+                gates << -(o + 3) << " " << -(o + 6) << " " << o + 7 << " 0\n" << -(o + 3) << " " << o + 6 << " " << -(o + 7) << " 0\n";
+                gates << o + 3 << " " << o + 6 << " " << o + 7 << " 0\n" << o + 3 << " " << -(o + 6) << " " << -(o + 7) << " 0\n";
+                gates << o + 10 << " " << o + 11 << " " << o + 12 << " 0\n" << -(o + 10) << " " << -(o + 11) << " 0\n" << -(o + 12) << " " << o + 13 << " 0\n";
+                budget << -(o + 2) << " " << -(o + 4) << " 0\n" << o + 2 << " " << o + 4 << " " << o + 5 << " 0\n";
+                for (int j = 6; j < 20; j += 2) budget << o + j << " " << -(o + j + 1) << " 0\n";
+            }
+        }
+        for (const std::string& file : { gates_file, budget_file, test_dir + "cnf_test.cnf.xz", test_dir + "ibm-2004-03-k70.cnf.xz" }) {
+            const std::vector<double> serial = features(file, 1);
+            for (unsigned threads : { 2, 3, 8 }) {
+                CHECK_MESSAGE(features(file, threads) == serial, (file + " with " + std::to_string(threads) + " threads"));
+            }
+        }
+        std::remove(gates_file.c_str());
+        std::remove(budget_file.c_str());
+    }
+
     SUBCASE("WCNF base")
     {
         const auto test_file = test_dir + "wcnf_test.wcnf.xz";
@@ -0,0 +1,155 @@
+/**
+ * Some tests for gbdc
+ * 
+ * @author Markus Iser 
+ */
+
+#include <stdio.h>
+#include <vector>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "src/util/OPBReader.h"
+#include "src/util/ExternalCNFFormula.h"
+#include "src/util/FormulaLoader.h"
+#include "src/util/IntervalCNFFormula.h"
+#include "src/util/NaiveCNFFormula.h"
+#include "src/util/SizeGroupedCNFFormula.h"
+#include "src/util/StreamBuffer.h"
+#include "src/util/ResourceBudget.h"
+#include "src/transform/Pack.h"
+#include "test/Util.h"
+
+TEST_CASE("OPB reader") {
+    std::FILE* file = nullptr;
+    std::string name;
+
+    SUBCASE("read opb: tokens, relations and big coefficients") {
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fputs("* comment\nmin: +3 x1 -02 ~ x2 ;\n+99999999999999999999 x2 +1 x3 <= - 1 ;\n", file);
+        std::fclose(file);
+        OPB::Reader reader(name.c_str());
+        CHECK(reader.next());
+        const OPB::Constraint& objective = reader.constraint();
+        CHECK(objective.objective);
+        REQUIRE(objective.terms.size() == 4);
+        CHECK(objective.terms[0].value == 3);
+        CHECK(objective.terms[1].kind == OPB::Token::POSITIVE);
+        CHECK(objective.terms[2].value == -2);
+        CHECK(reader.text(objective.terms[2].text) == "-02");
+        CHECK(objective.terms[3].kind == OPB::Token::NEGATIVE);
+        CHECK(objective.terms[3].value == 2);
+        CHECK(reader.next());
+        const OPB::Constraint& constraint = reader.constraint();
+        CHECK(!constraint.objective);
+        REQUIRE(constraint.terms.size() == 4);
+        CHECK(constraint.terms[0].big);
+        CHECK(reader.toDouble(constraint.terms[0]) == 1e20);
+        CHECK(constraint.rel == OPB::Constraint::LE);
+        CHECK(reader.text(constraint.relation) == "<=");
+        CHECK(constraint.bound.value == -1);
+        CHECK(!reader.next());
+        std::remove(name.c_str());
+    }
+}
+
+TEST_CASE("Formula loader") {
+    std::FILE* file = nullptr;
+    std::string name;
+
+    SUBCASE("read clauses: loader renames variables for all formula backends") {
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fputs("c gaps and empty clauses\np cnf 9 5\n7 -3 0\n0\n-9 3 0\n5 0\n0\n", file);
+        std::fclose(file);
+        const std::vector<Cl> expected({ { Lit(0, false), Lit(1, true) }, { Lit(2, true), Lit(1, false) }, { Lit(3, false) } });
+        auto collect = [] (const auto& formula) {
+            std::vector<Cl> clauses;
+            for (const auto clause : formula.clauses()) clauses.push_back(Cl(clause.begin(), clause.end()));
+            return clauses;
+        };
+        const FormulaHint hint = formula_hint(name.c_str());
+        CHECK(hint.vars == 9);
+        CHECK(hint.clauses == 5);
+        const std::string packed = tempfile();
+        pack(name.c_str(), packed.c_str(), false);
+        CHECK(formula_hint(packed.c_str()).literals == 5);
+        for (const char* filename : { name.c_str(), packed.c_str() }) {
+            for (unsigned threads : { 1, 3 }) {
+                IntervalCNFFormula interval(filename, false, threads);
+                CHECK(interval.nVars() == 4);
+                CHECK(interval.nClauses() == 3);
+                CHECK(interval.nLiterals() == 5);
+                CHECK(collect(interval) == expected);
+                NaiveCNFFormula naive(filename, false, threads);
+                CHECK(naive.nVars() == 4);
+                CHECK(collect(naive) == expected);
+                SizeGroupedCNFFormula grouped(filename, false, threads);
+                CHECK(grouped.nVars() == 4);
+                CHECK(grouped.nClauses() == 5);  // empty clauses are counted
+                CHECK(collect(grouped) == std::vector<Cl>({ expected[2], expected[0], expected[1] }));
+            }
+        }
+        // incremental construction keeps the original names until finalize()
+        IntervalCNFFormula incremental;
+        ClauseReader in(name.c_str());
+        Cl clause;
+        while (in.readClause(clause)) incremental.addClause(clause);
+        CHECK(incremental.nVars() == 9);
+        incremental.finalize(false);
+        CHECK(incremental.nVars() == 4);
+        CHECK(collect(incremental) == expected);
+        // bogus header counts do not allocate more than the file holds
+        std::remove(name.c_str());
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fputs("p cnf 100000000 100000000\n7 -3 0\n-9 3 0\n5 0\n", file);
+        std::fclose(file);
+        CHECK(formula_hint(name.c_str()).vars == 100000000);
+        CHECK(allocation_hint(name.c_str()).vars < 64);
+        pack(name.c_str(), packed.c_str(), false);
+        for (const char* filename : { name.c_str(), packed.c_str() }) {
+            ResourceBudget budget(0, 16);
+            ResourceBudget::Scope scope(budget);
+            CHECK(IntervalCNFFormula(filename, false).nVars() == 4);
+            CHECK(NaiveCNFFormula(filename, false).nVars() == 4);
+            CHECK(SizeGroupedCNFFormula(filename, false).nVars() == 4);
+        }
+        std::remove(packed.c_str());
+        std::remove(name.c_str());
+    }
+}
+
+TEST_CASE("External formula") {
+    SUBCASE("read clauses: external formula with tiny windows") {
+        const char* test_file = "test/resources/test_files/cnf_test.cnf.xz";
+        IntervalCNFFormula reference(test_file, false);
+        ExternalCNFFormula formula(test_file, false, 1, 4096);
+        CHECK(formula.nVars() == reference.nVars());
+        CHECK(formula.nClauses() == reference.nClauses());
+        CHECK(formula.nLiterals() == reference.nLiterals());
+        auto expected = reference.clauses().begin();
+        unsigned n_clauses = 0;
+        for (const auto clause : formula.clauses()) {
+            REQUIRE(n_clauses < reference.nClauses());
+            const auto other = *expected;
+            Cl literals;
+            for (Lit lit : clause) literals.push_back(lit);
+            CHECK(literals == Cl(other.begin(), other.end()));
+            ++expected;
+            ++n_clauses;
+        }
+        CHECK(n_clauses == reference.nClauses());
+        ClauseSpill spill(4096);
+        Cl big(5000, Lit(1u << 20, true));
+        spill.add(big);
+        spill.add(Cl());
+        spill.add(Cl({ Lit(3, false) }));
+        spill.finish();
+        std::vector<Cl> read;
+        spill.for_each([&read] (const Cl& clause) { read.push_back(clause); });
+        CHECK(read == std::vector<Cl>({ big, Cl(), Cl({ Lit(3, false) }) }));
+    }
+}
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/identify/Analyze.h"
+#include "src/identify/GBDHash.h"
+#include "src/identify/ISOHash.h"
+#include "src/identify/ISOHash2.h"
+#include "src/transform/Pack.h"
+#include "src/util/MultiMD5.h"
+#include "test/Util.h"
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+const std::string test_dir = "test/resources/test_files/";
+
+// isohash as specified: md5 of the sorted polarity-normalized degree pairs of all occurring variables
+std::string reference_isohash(const char* filename) {
+    std::vector<std::pair<unsigned, unsigned>> degrees;
+    StreamBuffer in(filename);
+    Cl clause;
+    while (in.readClause(clause)) {
+        for (Lit lit : clause) {
+            if (static_cast<size_t>(lit.var()) > degrees.size()) degrees.resize(lit.var());
+            if (lit.sign()) ++degrees[lit.var() - 1].first;
+            else ++degrees[lit.var() - 1].second;
+        }
+    }
+    for (auto& degree : degrees) {
+        if (degree.second < degree.first) std::swap(degree.first, degree.second);
+    }
+    std::sort(degrees.begin(), degrees.end());
+    MD5 md5;
+    char text[32];
+    for (const auto& [neg, pos] : degrees) {
+        if (neg == 0 && pos == 0) continue;
+        const int length = snprintf(text, sizeof(text), "%u %u ", neg, pos);
+        md5.consume(text, length);
+    }
+    return md5.produce();
+}
+
+TEST_CASE("Analyze") {
+    SUBCASE("analyze: hashes equal those of the single tools") {
+        const std::string name = tempfile();
+        for (const char* text : { "p cnf 3 2\n01 -02 0\n+3 2 0\n", "c comment\np cnf 4 3\n1 -0 2 0\n-3 +004 0\n0\n-1" }) {
+            {
+                std::ofstream out(name);
+                out << text;
+            }
+            const CNF::Analysis analysis = CNF::analyze(name.c_str());
+            CHECK(analysis.gbdhash == CNF::gbdhash(name.c_str()));
+            CHECK(analysis.isohash == CNF::isohash(name.c_str()));
+        }
+        std::remove(name.c_str());
+        const std::string packed = tempfile();
+        for (const char* file : { "cnf_test.cnf.xz", "ibm-2004-03-k70.cnf.xz" }) {
+            const std::string path = test_dir + file;
+            const CNF::Analysis analysis = CNF::analyze(path.c_str());
+            CHECK(analysis.gbdhash == CNF::gbdhash(path.c_str()));
+            CHECK(analysis.isohash == CNF::isohash(path.c_str()));
+            pack(path.c_str(), packed.c_str());
+            const CNF::Analysis from_packed = CNF::analyze(packed.c_str());
+            CHECK(from_packed.gbdhash == analysis.gbdhash);
+            CHECK(from_packed.isohash == analysis.isohash);
+            CHECK(from_packed.features == analysis.features);
+            CHECK(from_packed.wlhash == analysis.wlhash);
+        }
+        std::remove(packed.c_str());
+    }
+}
+
+TEST_CASE("Hash") {
+    std::FILE* file = nullptr;
+    std::string name;
+
+    SUBCASE("hash: multi-buffer md5 and gbdhash_many") {
+        MultiMD5::Engine engine;
+        std::vector<std::string> messages(MultiMD5::Engine::lanes);
+        for (unsigned round = 0; round < 4; ++round) {
+            const char* data[MultiMD5::Engine::lanes];
+            size_t size[MultiMD5::Engine::lanes];
+            for (unsigned lane = 0; lane < MultiMD5::Engine::lanes; ++lane) {
+                const size_t offset = messages[lane].size();
+                messages[lane].append((lane * 37 + round * 11) % 150, static_cast<char>('a' + lane + round));
+                data[lane] = messages[lane].data() + offset;
+                size[lane] = messages[lane].size() - offset;
+            }
+            engine.update(data, size);
+        }
+        for (unsigned lane = 0; lane < MultiMD5::Engine::lanes; ++lane) {
+            MD5 md5;
+            md5.consume(messages[lane].data(), messages[lane].size());
+            CHECK(engine.finish(lane) == md5.produce());
+        }
+
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fputs("c comment\np cnf 3 2\n1  -2 0\n-3 2", file);
+        std::fclose(file);
+        std::vector<std::string> paths { name, "test/resources/test_files/does_not_exist.cnf" };
+        for (const auto& entry : std::filesystem::directory_iterator("test/resources/test_files")) {
+            if (entry.path().string().find(".cnf") != std::string::npos) paths.push_back(entry.path().string());
+        }
+        const std::vector<std::string> hashes = CNF::gbdhash_many(paths);
+        REQUIRE(hashes.size() == paths.size());
+        CHECK(hashes[0] == CNF::gbdhash(name.c_str()));
+        CHECK(hashes[1].empty());
+        for (size_t i = 2; i < paths.size(); ++i) {
+            CHECK(hashes[i] == CNF::gbdhash(paths[i].c_str()));
+        }
+        std::remove(name.c_str());
+    }
+
+    SUBCASE("hash: gbdhash2 does not depend on threads, batches and formatting") {
+        const std::string path = test_dir + "cnf_test.cnf.xz";
+        CHECK(CNF::gbdhash2(path.c_str()) == "f15c03d5e73a4f30b91e58643617e21d");
+        CHECK(CNF::gbdhash2(path.c_str(), 4) == CNF::gbdhash2(path.c_str()));
+        // several batches of 4 * threads blocks of 2^14 clauses and a partial last block, in another formatting
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fputs("c generated\np cnf 1000 300001\n", file);
+        for (unsigned i = 0; i < 300001; ++i) std::fprintf(file, "%u  -%03u\n+%u 0\n", 1 + i % 1000, 1 + (7 * i) % 1000, 1 + (13 * i) % 1000);
+        std::fclose(file);
+        const std::string serial = CNF::gbdhash2(name.c_str());
+        for (unsigned threads : { 2, 3, 4 }) {
+            CAPTURE(threads);
+            CHECK(CNF::gbdhash2(name.c_str(), threads) == serial);
+        }
+        const std::string packed = tempfile();
+        pack(name.c_str(), packed.c_str());
+        CHECK(CNF::gbdhash2(packed.c_str(), 4) == serial);
+        std::remove(packed.c_str());
+        std::remove(name.c_str());
+        // empty file, the root digest of no leaves is XXH3-128 of the empty string
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fclose(file);
+        CHECK(CNF::gbdhash2(name.c_str()) == "99aa06d3014798d86001c324468d497f");
+        CHECK(CNF::gbdhash2(name.c_str(), 4) == CNF::gbdhash2(name.c_str()));
+        std::remove(name.c_str());
+    }
+}
+
+TEST_CASE("ISOHash") {
+    SUBCASE("isohash: degree histogram equals the sorted degree sequence") {
+        CHECK(CNF::isohash((test_dir + "cnf_test.cnf.xz").c_str()) == "1f596209495c583a3f7930760c99bf76");
+        CHECK(CNF::isohash((test_dir + "ibm-2004-03-k70.cnf.xz").c_str()) == "622daec0bc128aa45b15a6fbff728dce");
+        for (const char* file : { "cnf_test.cnf.xz", "ibm-2004-03-k70.cnf.xz" }) {
+            const std::string path = test_dir + file;
+            CHECK(CNF::isohash(path.c_str()) == reference_isohash(path.c_str()));
+        }
+        // degrees beyond the dense table, variable gaps and a header which is too small
+        const std::string name = tempfile();
+        {
+            std::ofstream out(name);
+            out << "p cnf 2 3\n";
+            for (unsigned i = 0; i < 600; ++i) out << "1 -" << 2 + i % 40 << " 0\n";
+            for (unsigned i = 0; i < 40; ++i) out << "-1 " << 100 + i << " 0\n";
+            out << "-7000 0\n";
+        }
+        CHECK(CNF::isohash(name.c_str()) == reference_isohash(name.c_str()));
+        std::remove(name.c_str());
+    }
+
+    SUBCASE("isohash: invariant under renaming, polarity flips and clause order") {
+        const std::string path = test_dir + "cnf_test.cnf.xz";
+        std::vector<Cl> clauses;
+        StreamBuffer in(path.c_str());
+        unsigned n_vars = 0;
+        for (Cl clause; in.readClause(clause); clauses.push_back(clause)) {
+            for (Lit lit : clause) n_vars = std::max<unsigned>(n_vars, lit.var());
+        }
+        std::mt19937 rng(42);
+        std::vector<unsigned> names(n_vars + 1);
+        for (unsigned i = 0; i <= n_vars; ++i) names[i] = i;
+        std::shuffle(names.begin() + 1, names.end(), rng);
+        std::vector<bool> flip(n_vars + 1);
+        for (unsigned i = 0; i <= n_vars; ++i) flip[i] = rng() % 2;
+        std::shuffle(clauses.begin(), clauses.end(), rng);
+        const std::string name = tempfile();
+        {
+            std::ofstream out(name);
+            for (const Cl& clause : clauses) {
+                for (Lit lit : clause) out << (lit.sign() != flip[lit.var()] ? "-" : "") << names[lit.var()] << " ";
+                out << "0\n";
+            }
+        }
+        CHECK(CNF::isohash(name.c_str()) == CNF::isohash(path.c_str()));
+        std::remove(name.c_str());
+    }
+}
+
+TEST_CASE("WLHash") {
+    SUBCASE("wlhash: same hash for all formula levels and thread counts") {
+        const std::vector<std::pair<const char*, const char*>> expected = {
+            { "cnf_test.cnf.xz", "1823865096" },
+            { "ibm-2004-03-k70.cnf.xz", "289246782" },
+            { "0297c2a35f116ffd5382aea5b421e6df-Urquhart-s3-b3.shuffled-as.sat03-1556.cnf.xz", "2392601620" },
+        };
+        for (const auto& [file, hash] : expected) {
+            const std::string path = test_dir + file;
+            for (unsigned level = 0; level <= 4; ++level) {
+                for (unsigned threads : { 1, 4 }) {
+                    CAPTURE(level);
+                    CAPTURE(threads);
+                    CHECK(CNF::weisfeiler_leman_hash(path.c_str(), level, true, true, false, 13, true, true, true, 6, false, false, false, threads) == hash);
+                }
+            }
+        }
+        CHECK_THROWS_AS(CNF::weisfeiler_leman_hash((test_dir + "cnf_test.cnf.xz").c_str(), 5), std::runtime_error);
+    }
+}
@@ -0,0 +1,74 @@
+/**
+ * Some tests for gbdc
+ * 
+ * @author Markus Iser 
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "src/util/Server.h"
+#include "test/Util.h"
+
+TEST_CASE("Server") {
+    SUBCASE("serve: json lines requests, ids and errors") {
+        const auto fields = Server::parse_object(R"({"id": "a\"b", "n": -1.5e1, "flag": true, "skip": null})");
+        REQUIRE(fields.size() == 3);
+        CHECK(fields[0].raw == R"("a\"b")");
+        CHECK(std::get<std::string>(fields[0].value) == "a\"b");
+        CHECK(std::get<double>(fields[1].value) == -15);
+        CHECK(std::get<double>(fields[2].value) == 1);
+        CHECK_THROWS_AS(Server::parse_object(R"({"id": 1)"), std::runtime_error);
+        CHECK_THROWS_AS(Server::parse_object(R"({"id": 1} x)"), std::runtime_error);
+
+        const Server::Handler handler = [] (const std::string& task, const std::string& file) {
+            if (task == "fail") throw std::runtime_error("failed");
+            return BatchRecord { { "task", task }, { "size", static_cast<double>(file.size()) } };
+        };
+        std::istringstream in("{\"id\": 1, \"task\": \"len\", \"file\": \"abc\"}\n\n"
+                              "{\"id\": 2, \"task\": \"fail\"}\n"
+                              "{\"id\": 3\n"
+                              "{\"id\": 4, \"memout\": -1}\n"
+                              "{\"id\": 5, \"timeout\": nan}\n"
+                              "{\"id\": 6, \"memout\": 1e300}\n"
+                              "{\"id\": 7, \"file\": \"" + std::string(Server::max_request, 'x') + "\"}\n");
+        std::ostringstream out;
+        Server::serve_stream(in, out, 1, handler, 0, 0);
+        std::istringstream lines(out.str());
+        std::vector<std::string> responses;
+        for (std::string line; std::getline(lines, line); ) responses.push_back(line);
+        REQUIRE(responses.size() == 7);
+        std::sort(responses.begin(), responses.end());  // responses arrive in completion order
+        CHECK(responses[0].rfind(R"({"error": "Request longer than )", 0) == 0);
+        CHECK(responses[1].rfind(R"({"error": )", 0) == 0);
+        CHECK(responses[2].rfind(R"({"id": 1, "file": "abc", "task": "len", "size": 3, "runtime": )", 0) == 0);
+        CHECK(responses[3].rfind(R"({"id": 2, "file": "", "runtime": "error", "error": "failed"})", 0) == 0);
+        CHECK(responses[4] == R"({"id": 4, "error": "Invalid memout: -1"})");
+        CHECK(responses[5] == R"({"id": 5, "error": "Invalid timeout: nan"})");
+        CHECK(responses[6] == R"({"id": 6, "error": "Invalid memout: 1e300"})");
+    }
+
+    SUBCASE("serve: lines longer than the read buffer, overlong lines and the last line") {
+        const Server::Handler handler = [] (const std::string&, const std::string& file) {
+            return BatchRecord { { "size", static_cast<double>(file.size()) } };
+        };
+        std::istringstream in("{\"id\": 1, \"file\": \"" + std::string(6000, 'y') + "\"}\n"
+                              "{\"id\": 2, \"file\": \"" + std::string(3 * Server::max_request, 'z') + "\"}\n"
+                              "{\"id\": 3, \"file\": \"ab\"}");
+        std::ostringstream out;
+        Server::serve_stream(in, out, 2, handler, 0, 0);
+        std::istringstream lines(out.str());
+        std::vector<std::string> responses;
+        for (std::string line; std::getline(lines, line); ) responses.push_back(line);
+        REQUIRE(responses.size() == 3);  // the overlong line is answered once
+        std::sort(responses.begin(), responses.end());
+        CHECK(responses[0].rfind(R"({"error": "Request longer than )", 0) == 0);
+        CHECK(responses[1].rfind(R"({"id": 1, "file": ")" + std::string(6000, 'y') + R"(", "size": 6000, "runtime": )", 0) == 0);
+        CHECK(responses[2].rfind(R"({"id": 3, "file": "ab", "size": 2, "runtime": )", 0) == 0);
+    }
+}
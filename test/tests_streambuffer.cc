@@ -5,38 +5,36 @@
  */
 
 #include <stdio.h>
-#include <filesystem>
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 
 #include "src/util/StreamBuffer.h"
-
-bool tempfile(FILE** file, char** name) {
-    *name = tempnam("/tmp", "gbdc.test");
-    *file = fopen(*name, "w+");
-    return *file != nullptr;
-}
+#include "src/util/ParallelDimacs.h"
+#include "test/Util.h"
 
 TEST_CASE("StreamBuffer") {
-    std::FILE* file;
-    char* name;
+    std::FILE* file = nullptr;
+    std::string name;
 
     SUBCASE("read hello world") {
-        CHECK(tempfile(&file, &name));
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
         std::fputs("Hello World!", file);
         std::fclose(file);
-        StreamBuffer reader(name);
+        StreamBuffer reader(name.c_str());
         CHECK(reader.skipString("Hello"));
         CHECK(reader.skipWhitespace());
         CHECK(!reader.skipString("World!"));
+        std::remove(name.c_str());
     }
 
     SUBCASE("read mixed: integers, strings, whitespace, linebreaks") {
-        CHECK(tempfile(&file, &name));
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
         std::fputs("123 137 no   -7 mer\n ci\n", file);
         std::fclose(file);
-        StreamBuffer reader(name);
+        StreamBuffer reader(name.c_str());
         int num;
         CHECK(reader.readInteger(&num));
         CHECK(num == 123);
@@ -53,6 +51,130 @@ TEST_CASE("StreamBuffer") {
         CHECK(!reader.eof());
         CHECK(!reader.skipWhitespace());
         CHECK(reader.eof());
+        std::remove(name.c_str());
+    }
+
+    SUBCASE("read integers: signs and int32 range") {
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fputs("+5 -2147483647 2147483647 2147483648 - 3", file);
+        std::fclose(file);
+        StreamBuffer reader(name.c_str());
+        int num;
+        CHECK(reader.readInteger(&num));
+        CHECK(num == 5);
+        CHECK(reader.readInteger(&num));
+        CHECK(num == -2147483647);
+        CHECK(reader.readInteger(&num));
+        CHECK(num == 2147483647);
+        CHECK_THROWS_AS(reader.readInteger(&num), ParserException);
+        CHECK(reader.skipNumber());
+        CHECK_THROWS_AS(reader.readInteger(&num), ParserException);
+        std::remove(name.c_str());
+
+        // signs are only appended together with digits
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fputs("+5 - 3 -0 -", file);
+        std::fclose(file);
+        StreamBuffer text(name.c_str());
+        std::string out;
+        CHECK(text.appendNumber(out));
+        CHECK(text.appendNumber(out));
+        CHECK(text.appendNumber(out));
+        CHECK(out == "5-3-0");
+        CHECK(!text.appendNumber(out));
+        CHECK(out == "5-3-0");
+        std::remove(name.c_str());
+    }
+
+    SUBCASE("read clauses: comment lines, no trailing newline") {
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fputs("c comment\np cnf 3 2\n1 -2 0\nc comment\n-3 2 0", file);
+        std::fclose(file);
+        StreamBuffer reader(name.c_str());
+        Cl clause;
+        CHECK(reader.readClause(clause));
+        CHECK(clause == Cl({ Lit(1, false), Lit(2, true) }));
+        CHECK(reader.readClause(clause));
+        CHECK(clause == Cl({ Lit(3, true), Lit(2, false) }));
+        CHECK(!reader.readClause(clause));
+        std::remove(name.c_str());
+    }
+
+    SUBCASE("read header: valid and malformed problem lines") {
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fputs("p cnf 3 2\np cnf 3\n1 -2 0\np wcnf 3 2 7\n-3 2 0", file);
+        std::fclose(file);
+        StreamBuffer reader(name.c_str());
+        uint64_t vars = 0, clauses = 0;
+        CHECK(reader.readHeader("cnf", &vars, &clauses));
+        CHECK(vars == 3);
+        CHECK(clauses == 2);
+        CHECK(!reader.readHeader("cnf", &vars, &clauses));
+        Cl clause;
+        CHECK(reader.readClause(clause));
+        CHECK(clause == Cl({ Lit(1, false), Lit(2, true) }));
+        CHECK(!reader.readHeader("cnf", &vars, &clauses));
+        CHECK(reader.readClause(clause));
+        CHECK(clause == Cl({ Lit(3, true), Lit(2, false) }));
+        std::remove(name.c_str());
+    }
+
+    SUBCASE("read clauses: tiny adaptive buffer") {
+        const char* test_file = "test/resources/test_files/cnf_test.cnf.xz";
+        StreamBuffer reference(test_file);
+        StreamBuffer reader(test_file, 4, true);
+        Cl expected, clause;
+        while (reference.readClause(expected)) {
+            CHECK(reader.readClause(clause));
+            CHECK(clause == expected);
+        }
+        CHECK(!reader.readClause(clause));
+    }
+
+    SUBCASE("read clauses: decoder thread") {
+        const char* test_file = "test/resources/test_files/cnf_test.cnf.xz";
+        StreamBuffer reference(test_file);
+        StreamBuffer reader(test_file, 64, true, true);
+        Cl expected, clause;
+        while (reference.readClause(expected)) {
+            CHECK(reader.readClause(clause));
+            CHECK(clause == expected);
+        }
+        CHECK(!reader.readClause(clause));
+    }
+
+    SUBCASE("read clauses: parallel chunks") {
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fputs("c comment\np cnf 5 6\n1 -2\n 3 0 c trailing\n-4 0 0\n5 -1 2 3 4 -5\n0\n2\n3 0 -1", file);
+        std::fclose(file);
+        Cl expected;
+        std::vector<Cl> reference;
+        StreamBuffer in(name.c_str());
+        while (in.readClause(expected)) reference.push_back(expected);
+        CHECK(ParallelDimacs::supported(name.c_str()));
+        for (size_t chunk_size : { 1, 5, 13, 1024 }) {
+            std::vector<Cl> clauses;
+            ParallelDimacs::read(name.c_str(), 3, [&clauses] (const Cl& clause) { clauses.push_back(clause); }, chunk_size);
+            CHECK(clauses == reference);
+        }
+        std::remove(name.c_str());
+        // comment lines inside of a clause are rejected wherever the chunks start
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fputs("1 -2\nc inside\n3 0\n", file);
+        std::fclose(file);
+        StreamBuffer serial(name.c_str());
+        CHECK_THROWS_AS(serial.readClause(expected), ParserException);
+        for (size_t chunk_size : { 1, 5, 1024 }) {
+            CHECK_THROWS_AS(ParallelDimacs::read(name.c_str(), 3, [] (const Cl&) { }, chunk_size), ParserException);
+        }
+        std::remove(name.c_str());
+        CHECK(!ParallelDimacs::supported("test/resources/test_files/cnf_test.cnf.xz"));
     }
 }
 
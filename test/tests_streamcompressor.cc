@@ -35,6 +35,86 @@ TEST_CASE("StreamCompressor")
         remove(tmp_file.c_str());
     }
 
+    SUBCASE("Write unannounced data spanning several blocks")
+    {
+        auto tmp_file = tmp_filename("test/resources", ".cnf.xz");
+        const unsigned n_clauses = 300000;
+        {
+            StreamCompressor c(tmp_file.c_str());
+            for (unsigned i = 1; i <= n_clauses; ++i)
+            {
+                c.buffer().writeInt(i);
+                c.buffer().write(" -1 0\n", 6);
+            }
+            c.close();
+        }
+        StreamBuffer b(tmp_file.c_str());
+        Cl clause;
+        unsigned i = 0;
+        bool expected = true;
+        while (b.readClause(clause))
+        {
+            ++i;
+            expected = expected && clause == Cl({Lit(i, false), Lit(1, true)});
+        }
+        CHECK(expected);
+        CHECK(i == n_clauses);
+        remove(tmp_file.c_str());
+    }
+
+    SUBCASE("Write zstd archive")
+    {
+        auto tmp_file = tmp_filename("test/resources", ".cnf.zst");
+        {
+            StreamCompressor c(tmp_file.c_str());
+            const char *data = "p cnf 3 3\n1 2 0\n1 0\n-2 3 0\n";
+            c.write(data, strlen(data));
+            c.close();
+        }
+        std::vector<Cl> clauses{{Lit(1, false), Lit(2, false)}, {Lit(1, false)}, {Lit(2, true), Lit(3, false)}};
+        StreamBuffer b(tmp_file.c_str());
+        Cl clause;
+        unsigned i = 0;
+        for (; b.readClause(clause); ++i)
+        {
+            REQUIRE(i < clauses.size());
+            CHECK(clause == clauses[i]);
+        }
+        CHECK(i == clauses.size());
+        remove(tmp_file.c_str());
+    }
+
+    SUBCASE("Write with threads and compression level")
+    {
+        for (const char *ext : {".cnf.xz", ".cnf.zst"})
+        {
+            CAPTURE(ext);
+            auto tmp_file = tmp_filename("test/resources", ext);
+            const unsigned n_clauses = 100000;
+            {
+                StreamCompressor c(tmp_file.c_str(), 0, 2, 3);
+                for (unsigned i = 1; i <= n_clauses; ++i)
+                {
+                    c.buffer().writeInt(i);
+                    c.buffer().write(" -1 0\n", 6);
+                }
+                c.close();
+            }
+            StreamBuffer b(tmp_file.c_str());
+            Cl clause;
+            unsigned i = 0;
+            bool expected = true;
+            while (b.readClause(clause))
+            {
+                ++i;
+                expected = expected && clause == Cl({Lit(i, false), Lit(1, true)});
+            }
+            CHECK(expected);
+            CHECK(i == n_clauses);
+            remove(tmp_file.c_str());
+        }
+    }
+
     SUBCASE("Write from istream to archive")
     {
         auto tmp_file = tmp_filename("test/resources", ".cnf.xz");
@@ -0,0 +1,301 @@
+/**
+ * Some tests for gbdc
+ * 
+ * @author Markus Iser 
+ */
+
+#include <stdio.h>
+#include <fstream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "src/util/StreamBuffer.h"
+#include "src/util/BinaryCNF.h"
+#include "src/identify/ISOHash.h"
+#include "src/transform/Pack.h"
+#include "src/transform/Normalize.h"
+#include "src/transform/IndependentSet.h"
+#include "src/transform/cnf2bip.h"
+#include "test/Util.h"
+
+TEST_CASE("Sanitize") {
+    std::FILE* file = nullptr;
+    std::string name;
+
+    SUBCASE("sanitize: tautologies, duplicates and parallel chunks") {
+        auto read_file = [] (const char* path) {
+            std::ifstream in(path);
+            return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        };
+        const std::string output = tempfile();
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fputs("c comment\np cnf 5 4\n1 -1 2 0\n3 -2 3 0\n-4 1 -1 0\n2\n5 0", file);
+        std::fclose(file);
+        CHECK(!check_sanitized(name.c_str()));
+        sanitize(name.c_str(), output.c_str());
+        CHECK(read_file(output.c_str()) == "p cnf 5 2\n3 -2 0\n2 5 0\n");
+        CHECK(check_sanitized(output.c_str()));
+        std::remove(name.c_str());
+
+        // several chunks of ParallelDimacs
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::mt19937 rng(7);
+        for (unsigned i = 0; i < 400000; ++i) {
+            for (unsigned k = rng() % 4; k < 4; ++k) std::fprintf(file, "%d ", static_cast<int>(rng() % 200) - 100);
+            std::fputs(i % 3 ? "0\n" : "\n", file);
+        }
+        std::fclose(file);
+        const std::string parallel = tempfile();
+        sanitize(name.c_str(), output.c_str());
+        sanitize(name.c_str(), parallel.c_str(), 4);
+        CHECK(read_file(output.c_str()) == read_file(parallel.c_str()));
+        CHECK(!check_sanitized(name.c_str(), 4));
+        CHECK(check_sanitized(parallel.c_str(), 4));
+        std::remove(name.c_str());
+        std::remove(output.c_str());
+        std::remove(parallel.c_str());
+    }
+}
+
+TEST_CASE("Normalize") {
+    std::FILE* file = nullptr;
+    std::string name;
+
+    SUBCASE("normalize: exact output and compressed round trip") {
+        auto read_file = [] (const char* path) {
+            std::ifstream in(path);
+            return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        };
+        name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        std::fputs("c comment\np cnf 9 9\n+1 -002 0\nc inbetween\n3 0010\n -4 0\n\n-5 +6", file);
+        std::fclose(file);
+        const std::string output = tempfile();
+        normalize(name.c_str(), output.c_str());
+        const std::string expected = "p cnf 10 3\n1 -2 0\n3 10 -4 0\n-5 6 0\n";
+        CHECK(read_file(output.c_str()) == expected);
+        // normalized output is a fixpoint, also through a compressed file
+        const std::string compressed = tempfile(".cnf.zst");
+        normalize(name.c_str(), compressed.c_str());
+        normalize(compressed.c_str(), output.c_str());
+        CHECK(read_file(output.c_str()) == expected);
+        std::remove(compressed.c_str());
+        std::remove(output.c_str());
+        std::remove(name.c_str());
+    }
+}
+
+TEST_CASE("Pack") {
+    std::string name;
+
+    SUBCASE("read clauses: packed file") {
+        const char* test_file = "test/resources/test_files/cnf_test.cnf.xz";
+        name = tempfile();
+        BinaryCNF::Header header = pack(test_file, name.c_str(), true, 16);
+        StreamBuffer reference(test_file);
+        ClauseReader reader(name.c_str());
+        REQUIRE(reader.header() != nullptr);
+        CHECK(reader.header()->gbdhash == header.gbdhash);
+        Cl expected, clause;
+        uint64_t n_clauses = 0;
+        while (reference.readClause(expected)) {
+            CHECK(reader.readClause(clause));
+            CHECK(clause == expected);
+            ++n_clauses;
+        }
+        CHECK(!reader.readClause(clause));
+        CHECK(reader.header()->n_clauses == n_clauses);
+        // corrupt clause lengths and variables are rejected
+        header.flags = 0;
+        for (const std::string& clauses : { std::string("\xff\xff\xff\xff\x0f\x02", 6), std::string("\x01\xff\xff\xff\x07", 5), std::string("\x01\x01", 2) }) {
+            {
+                std::ofstream out(name, std::ios::binary);
+                header.write(out);
+                out << clauses;
+            }
+            ClauseReader corrupt(name.c_str());
+            CHECK_THROWS_AS(corrupt.readClause(clause), ParserException);
+            CHECK_THROWS_AS(CNF::isohash(name.c_str()), ParserException);
+        }
+        std::remove(name.c_str());
+    }
+}
+
+// k-independent set problem as generated from the in-memory CNFFormula before streaming
+static std::string reference_kis(const char* filename) {
+    CNFFormula formula;
+    formula.readDimacsFromFile(filename);
+    std::vector<std::vector<unsigned>> literal2nodes(2 * formula.nVars() + 2);
+    uint64_t n_nodes = 0, n_edges = 0;
+    std::string edges;
+    unsigned nodeId = 1;
+    for (const Clause* clause : formula) {
+        n_nodes += clause->size();
+        n_edges += (static_cast<uint64_t>(clause->size()) * (clause->size() - 1)) / 2;
+        for (unsigned i = 0; i < clause->size(); i++) {
+            literal2nodes[(*clause)[i]].push_back(nodeId + i);
+            for (unsigned j = i + 1; j < clause->size(); j++) {
+                edges += std::to_string(nodeId + i) + " " + std::to_string(nodeId + j) + " 0\n";
+                edges += std::to_string(nodeId + j) + " " + std::to_string(nodeId + i) + " 0\n";
+            }
+        }
+        nodeId += clause->size();
+    }
+    for (unsigned i = 1; i <= formula.nVars(); i++) {
+        n_edges += static_cast<uint64_t>(literal2nodes[Lit(Var(i), false)].size()) * literal2nodes[Lit(Var(i), true)].size();
+        for (unsigned node1 : literal2nodes[Lit(Var(i), false)]) {
+            for (unsigned node2 : literal2nodes[Lit(Var(i), true)]) {
+                edges += std::to_string(node1) + " " + std::to_string(node2) + " 0\n";
+                edges += std::to_string(node2) + " " + std::to_string(node1) + " 0\n";
+            }
+        }
+    }
+    const std::string k = std::to_string(formula.nClauses());
+    return "c satisfiable iff maximum independent set size is " + k + "\nc kis nNodes nEdges k\n"
+        + "p kis " + std::to_string(n_nodes) + " " + std::to_string(2 * n_edges) + " " + k + "\n" + edges;
+}
+
+TEST_CASE("Graphs") {
+    using Edges = std::vector<std::pair<unsigned, unsigned>>;
+    auto read_file = [] (const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    // edges of the text output, lines "<prefix>a b<suffix>" after comment and problem lines
+    auto text_edges = [&read_file] (const std::string& path, const char* prefix) {
+        std::istringstream in(read_file(path));
+        Edges edges;
+        for (std::string line; std::getline(in, line); ) {
+            if (line[0] == 'c' || line[0] == 'p') continue;
+            std::istringstream fields(line.substr(std::char_traits<char>::length(prefix)));
+            unsigned a, b;
+            fields >> a >> b;
+            edges.emplace_back(a, b);
+        }
+        return edges;
+    };
+    // edges of the CSR output in order of their source nodes
+    auto csr_edges = [&read_file] (const std::string& path, uint64_t n_nodes) {
+        const std::string bytes = read_file(path);
+        auto get = [&bytes] (size_t pos, unsigned size) {
+            uint64_t value = 0;
+            for (unsigned i = 0; i < size; ++i) value |= static_cast<uint64_t>(static_cast<unsigned char>(bytes[pos + i])) << (8 * i);
+            return value;
+        };
+        REQUIRE(bytes.size() >= 24);
+        CHECK(bytes.compare(0, 8, EdgeWriter::csr_magic, 8) == 0);
+        CHECK(get(8, 8) == n_nodes);
+        const uint64_t n_edges = get(16, 8);
+        const size_t targets = 24 + 8 * (n_nodes + 1);
+        REQUIRE(bytes.size() == targets + 4 * n_edges);
+        CHECK(get(24, 8) == 0);
+        CHECK(get(24 + 8 * n_nodes, 8) == n_edges);
+        Edges edges;
+        for (uint64_t node = 1; node <= n_nodes; ++node) {
+            for (uint64_t e = get(24 + 8 * (node - 1), 8); e < get(24 + 8 * node, 8); ++e) {
+                edges.emplace_back(node, get(targets + 4 * e, 4));
+            }
+        }
+        return edges;
+    };
+    const std::string text = tempfile();
+    const std::string csr = tempfile();
+
+    SUBCASE("cnf2bip: CSR output equals the text edge list for any window size") {
+        const char* test_file = "test/resources/test_files/cnf_test.cnf.xz";
+        CNFFormula formula;
+        formula.readDimacsFromFile(test_file);
+        const uint64_t n_nodes = formula.nVars() + formula.nClauses();
+        BipartiteGraphFromCNF(test_file).generate_bipartite_graph(text.c_str());
+        Edges expected = text_edges(text, "e ");
+        std::sort(expected.begin(), expected.end());
+        BipartiteGraphFromCNF(test_file).generate_bipartite_graph(csr.c_str(), true);
+        const std::string reference = read_file(csr);
+        Edges edges = csr_edges(csr, n_nodes);
+        CHECK(edges.size() == expected.size());
+        std::sort(edges.begin(), edges.end());
+        CHECK(edges == expected);
+        // several passes over the formula with small windows
+        for (uint64_t window : { 1, 7, 100 }) {
+            CAPTURE(window);
+            BipartiteGraphFromCNF(test_file, window).generate_bipartite_graph(csr.c_str(), true);
+            CHECK(read_file(csr) == reference);
+        }
+    }
+
+    SUBCASE("cnf2kis: CSR output equals the text edge list") {
+        const char* test_file = "test/resources/test_files/cnf_test.cnf.xz";
+        IndependentSetFromCNF gen(test_file);
+        gen.generate_independent_set_problem(text.c_str());
+        Edges expected = text_edges(text, "");
+        CHECK(expected.size() == gen.numEdges());
+        std::sort(expected.begin(), expected.end());
+        gen.generate_independent_set_problem(csr.c_str(), true);
+        Edges edges = csr_edges(csr, gen.numNodes());
+        std::sort(edges.begin(), edges.end());
+        CHECK(edges == expected);
+    }
+
+    SUBCASE("cnf2kis: streaming and external generation equal the in-memory formula") {
+        std::FILE* file = nullptr;
+        const std::string name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        // tautology, duplicate literals and an unterminated last clause
+        std::fputs("c comment\np cnf 3 4\n1 -1 2 0\n2 2 -3 0\n-2 3 1 0\n3 -1", file);
+        std::fclose(file);
+        const std::string expected =
+            "c satisfiable iff maximum independent set size is 3\n"
+            "c kis nNodes nEdges k\n"
+            "p kis 7 18 3\n"
+            "1 2 0\n2 1 0\n3 4 0\n4 3 0\n3 5 0\n5 3 0\n4 5 0\n5 4 0\n6 7 0\n7 6 0\n"
+            "3 6 0\n6 3 0\n1 4 0\n4 1 0\n5 2 0\n2 5 0\n7 2 0\n2 7 0\n";
+        CHECK(reference_kis(name.c_str()) == expected);
+        for (const std::string& path : { name, std::string("test/resources/test_files/cnf_test.cnf.xz") }) {
+            CAPTURE(path);
+            const std::string reference = reference_kis(path.c_str());
+            for (bool external : { false, true }) {
+                CAPTURE(external);
+                IndependentSetFromCNF gen(path.c_str(), external);
+                gen.generate_independent_set_problem(text.c_str());
+                CHECK(read_file(text) == reference);
+                CHECK(reference.find("p kis " + std::to_string(gen.numNodes()) + " " + std::to_string(gen.numEdges()) + " " + std::to_string(gen.minK()) + "\n") != std::string::npos);
+            }
+        }
+        std::remove(name.c_str());
+    }
+
+    SUBCASE("cnf2kis: threaded opposite-literal edges equal the sequential ones") {
+        std::FILE* file = nullptr;
+        const std::string name = tempfile(&file);
+        REQUIRE(file != nullptr);
+        // 600 * 300 opposite-literal edges of variable 1 are split over several chunks of 2^15 edges
+        std::mt19937 rng(11);
+        for (unsigned i = 0; i < 600; ++i) std::fprintf(file, "1 %u 0\n", 2 + static_cast<unsigned>(rng() % 50));
+        for (unsigned i = 0; i < 300; ++i) std::fprintf(file, "-1 -%u 0\n", 2 + static_cast<unsigned>(rng() % 50));
+        for (unsigned i = 0; i < 2000; ++i) std::fprintf(file, "%d %d 0\n", static_cast<int>(2 * (rng() % 50)) - 49, static_cast<int>(2 * (rng() % 50)) - 49);
+        std::fclose(file);
+        IndependentSetFromCNF gen(name.c_str());
+        gen.generate_independent_set_problem(text.c_str());
+        const std::string serial = read_file(text);
+        for (unsigned threads : { 2, 4 }) {
+            CAPTURE(threads);
+            gen.generate_independent_set_problem(text.c_str(), false, threads);
+            CHECK(read_file(text) == serial);
+        }
+        // write errors in the ordered writer stop the workers
+        if (std::filesystem::exists("/dev/full")) {
+            CHECK_THROWS_AS(gen.generate_independent_set_problem("/dev/full", false, 4), std::runtime_error);
+        }
+        std::remove(name.c_str());
+    }
+
+    std::remove(text.c_str());
+    std::remove(csr.c_str());
+}
@@ -0,0 +1,199 @@
+/**
+ * Some tests for gbdc
+ * 
+ * @author Markus Iser 
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "src/util/StreamBuffer.h"
+#include "src/util/Profile.h"
+#include "src/util/ResourceBudget.h"
+#include "src/util/Batch.h"
+#include "src/util/ResultCache.h"
+#include "test/Util.h"
+
+TEST_CASE("Profile") {
+    SUBCASE("profile: decompression phase and bytes read") {
+        Profile::reset();
+        Profile::enable();
+        StreamBuffer reader("test/resources/test_files/cnf_test.cnf.xz");
+        Cl clause;
+        while (reader.readClause(clause)) { }
+        Profile::enable(false);
+        uint64_t calls = 0, bytes = 0;
+        for (const auto& [name, value] : Profile::report()) {
+            if (name == "decompress.calls") calls = value;
+            if (name == "bytes_read") bytes = value;
+        }
+        CHECK(calls > 0);
+        CHECK(bytes > 0);
+        Profile::reset();
+        CHECK(Profile::report().empty());
+        // scopes that are open across a reset are recorded afterwards
+        Profile::enable();
+        {
+            Profile::Scope scope("outer");
+            Profile::reset();
+        }
+        Profile::enable(false);
+        const auto report = Profile::report();
+        REQUIRE(!report.empty());
+        CHECK(report[0] == std::make_pair(std::string("outer.calls"), uint64_t(1)));
+        Profile::reset();
+    }
+}
+
+TEST_CASE("ResourceBudget") {
+    SUBCASE("budget: aligned, nothrow and foreign blocks") {
+        struct alignas(64) Line { char bytes[64]; };
+        void* foreign = ::operator new(2 << 20);  // allocated without budget
+        ResourceBudget budget(0, 4);
+        {
+            ResourceBudget::Scope scope(budget);
+            std::unique_ptr<Line[]> lines(new Line[1 << 14]);  // 1 MB
+            CHECK(reinterpret_cast<uintptr_t>(lines.get()) % alignof(Line) == 0);
+            CHECK(budget.get_memory() >= 1);
+            CHECK_THROWS_AS(std::make_unique<Line[]>(1 << 16), MemoryLimitExceeded);
+            CHECK(new (std::nothrow) char[8 << 20] == nullptr);
+            ::operator delete(foreign);  // credited to the budget, which does not drop below zero
+            CHECK_THROWS_AS(std::make_unique<char[]>(9 << 19), MemoryLimitExceeded);
+        }
+    }
+}
+
+TEST_CASE("Batch") {
+    namespace fs = std::filesystem;
+    const fs::path dir = tempdir();
+    fs::create_directories(dir / "sub");
+    const std::vector<std::string> files { (dir / "a.cnf").string(), (dir / "sub" / "b.cnf").string(), (dir / "c.cnf").string() };
+    for (unsigned i = 0; i < files.size(); ++i) {
+        std::ofstream out(files[i]);
+        out << std::string(10 * (i + 1), ' ');
+    }
+
+    SUBCASE("batch: inputs from directories and manifests, largest first") {
+        CHECK(batch_inputs(dir.string()) == std::vector<std::string>({ files[2], files[1], files[0] }));
+        const std::string manifest = (dir / "manifest.txt").string();
+        {
+            std::ofstream out(manifest);
+            out << "# comment\n  " << files[0] << " \n\n" << files[2] << "\r\n";
+        }
+        CHECK(batch_inputs(manifest) == std::vector<std::string>({ files[2], files[0] }));
+        CHECK_THROWS_AS(batch_inputs((dir / "missing.txt").string()), std::runtime_error);
+    }
+
+    SUBCASE("batch: failed tasks are reported in the runtime column") {
+        const BatchTask task = [] (const std::string& file) -> BatchRecord {
+            if (file == "error") throw std::runtime_error("failed");
+            if (file == "memout") std::vector<char> block(8 << 20);
+            if (file == "timeout") for (;;) ResourceBudget::check();
+            return { { "size", static_cast<double>(file.size()) } };
+        };
+        const BatchRecord ok = run_task(task, "abc", 0, 0);
+        REQUIRE(ok.size() == 3);
+        CHECK(ok[0] == BatchRecord::value_type("file", "abc"));
+        CHECK(ok[1] == BatchRecord::value_type("size", 3.0));
+        CHECK(ok[2].first == "runtime");
+        CHECK(std::holds_alternative<double>(ok[2].second));
+        std::string error;
+        CHECK(run_task(task, "error", 0, 0, &error).back().second == BatchValue("error"));
+        CHECK(error == "failed");
+        CHECK(run_task(task, "memout", 0, 4).back().second == BatchValue("memout"));
+        CHECK(run_task(task, "timeout", 0.05, 0).back().second == BatchValue("timeout"));
+    }
+
+    SUBCASE("batch: every input is processed exactly once") {
+        std::vector<std::string> inputs;
+        for (unsigned i = 0; i < 100; ++i) inputs.push_back(std::to_string(i));
+        std::ostringstream out;
+        BatchWriter writer(out, true);
+        run_batch(inputs, [] (const std::string& file) { return BatchRecord { { "square", std::stod(file) * std::stod(file) } }; }, writer, 4, 0, 0);
+        std::istringstream lines(out.str());
+        std::set<std::string> seen;
+        for (std::string line; std::getline(lines, line); ) {
+            const size_t begin = line.find('"', line.find(':')) + 1;
+            const std::string file = line.substr(begin, line.find('"', begin) - begin);
+            CHECK(seen.insert(file).second);
+            CHECK(line.find("\"square\": " + std::to_string(std::stoi(file) * std::stoi(file)) + ",") != std::string::npos);
+        }
+        CHECK(seen.size() == inputs.size());
+    }
+
+    SUBCASE("batch: csv columns of the first record") {
+        std::ostringstream out;
+        BatchWriter writer(out, false);
+        writer.write({ { "file", "a,b" }, { "x", 1.0 } });
+        writer.write({ { "x", 2.0 }, { "file", "c\"d" }, { "y", "ignored" } });
+        CHECK(out.str() == "file,x\n\"a,b\",1\n\"c\"\"d\",2\n");
+    }
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("ResultCache") {
+    namespace fs = std::filesystem;
+    const fs::path dir = tempdir();
+    const std::string file = (dir / "input.cnf").string();
+    {
+        std::ofstream out(file);
+        out << "p cnf 1 1\n1 0\n";
+    }
+    ResultCache cache((dir / "cache").string());
+    unsigned computed = 0;
+    const std::function<BatchRecord()> compute = [&computed] () {
+        ++computed;
+        return BatchRecord { { "hash", "abc def" }, { "value", 0.1 + computed } };
+    };
+
+    SUBCASE("cache: miss computes, hit returns the stored record") {
+        BatchRecord record;
+        CHECK(!cache.lookup(file, "task", record));
+        const BatchRecord first = cache.get_or_compute(file, "task", compute);
+        const BatchRecord second = cache.get_or_compute(file, "task", compute);
+        CHECK(computed == 1);
+        CHECK(second == first);
+        CHECK(cache.lookup(file, "task", record));
+        CHECK(record == first);
+        // results of other tasks and files are not mixed up
+        CHECK(!cache.lookup(file, "other", record));
+        CHECK(!cache.lookup((dir / "missing.cnf").string(), "task", record));
+        CHECK(!cache.store((dir / "missing.cnf").string(), "task", first));
+    }
+
+    SUBCASE("cache: modified files are not served from the cache") {
+        const BatchRecord first = cache.get_or_compute(file, "task", compute);
+        {  // same size, later modification time
+            std::ofstream out(file);
+            out << "p cnf 1 1\n2 0\n";
+        }
+        fs::last_write_time(file, fs::last_write_time(file) + std::chrono::seconds(10));
+        const BatchRecord second = cache.get_or_compute(file, "task", compute);
+        CHECK(computed == 2);
+        CHECK(second != first);
+        {  // other size, same modification time
+            const auto mtime = fs::last_write_time(file);
+            std::ofstream(file, std::ios::app) << "c appended\n";
+            fs::last_write_time(file, mtime);
+        }
+        const BatchRecord third = cache.get_or_compute(file, "task", compute);
+        CHECK(computed == 3);
+        CHECK(third != second);
+        CHECK(cache.get_or_compute(file, "task", compute) == third);
+        CHECK(computed == 3);
+    }
+
+    fs::remove_all(dir);
+}